@@ -0,0 +1,365 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "buffer_allocator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+
+// @@ TLSF
+// plain loops, the same on every compiler, and at most 64 steps
+static int highest_bit(uint64_t value) {
+   int bit = -1;
+   while(value) {
+      value >>= 1;
+      bit += 1;
+   }
+   return bit;
+}
+
+static int lowest_bit(uint64_t value) {
+   int bit = 0;
+   while(!(value & 1)) {
+      value >>= 1;
+      bit += 1;
+   }
+   return bit;
+}
+
+// sizes in granularity units, below TLSF_SECOND_LEVELS units every size has a list of its own
+static void size_class(uint64_t units, int *first_level, int *second_level) {
+   if(units < (uint64_t)TLSF_SECOND_LEVELS) {
+      *first_level = 0;
+      *second_level = (int)units;
+      return;
+   }
+   int top = highest_bit(units);
+   *first_level = top - TLSF_SECOND_LEVEL_BITS + 1;
+   *second_level = (int)((units >> (top - TLSF_SECOND_LEVEL_BITS)) - TLSF_SECOND_LEVELS);
+}
+
+static uint32_t new_block(TlsfAllocator *tlsf) {
+   if(!tlsf->unused_blocks.empty()) {
+      uint32_t block = tlsf->unused_blocks.back();
+      tlsf->unused_blocks.pop_back();
+      return block;
+   }
+   tlsf->blocks.push_back(TlsfBlock{});
+   return (uint32_t)tlsf->blocks.size() - 1;
+}
+
+static void insert_free(TlsfAllocator *tlsf, uint32_t index) {
+   TlsfBlock &block = tlsf->blocks[index];
+   int first_level, second_level;
+   size_class(block.size / tlsf->granularity, &first_level, &second_level);
+
+   uint32_t &head = tlsf->free_lists[first_level][second_level];
+   block.free = true;
+   block.prev_free = TLSF_INVALID;
+   block.next_free = head;
+   if(head != TLSF_INVALID) {
+      tlsf->blocks[head].prev_free = index;
+   }
+   head = index;
+   tlsf->first_level_bitmap |= (uint64_t)1 << first_level;
+   tlsf->second_level_bitmap[first_level] |= 1u << second_level;
+}
+
+static void remove_free(TlsfAllocator *tlsf, uint32_t index) {
+   TlsfBlock &block = tlsf->blocks[index];
+   int first_level, second_level;
+   size_class(block.size / tlsf->granularity, &first_level, &second_level);
+
+   if(block.prev_free != TLSF_INVALID) {
+      tlsf->blocks[block.prev_free].next_free = block.next_free;
+   } else {
+      tlsf->free_lists[first_level][second_level] = block.next_free;
+   }
+   if(block.next_free != TLSF_INVALID) {
+      tlsf->blocks[block.next_free].prev_free = block.prev_free;
+   }
+   if(tlsf->free_lists[first_level][second_level] == TLSF_INVALID) {
+      tlsf->second_level_bitmap[first_level] &= ~(1u << second_level);
+      if(!tlsf->second_level_bitmap[first_level]) {
+	 tlsf->first_level_bitmap &= ~((uint64_t)1 << first_level);
+      }
+   }
+   block.free = false;
+}
+
+static void reset_free_lists(TlsfAllocator *tlsf) {
+   tlsf->first_level_bitmap = 0;
+   for(int first_level = 0; first_level < TLSF_FIRST_LEVELS; ++first_level) {
+      tlsf->second_level_bitmap[first_level] = 0;
+      for(int second_level = 0; second_level < TLSF_SECOND_LEVELS; ++second_level) {
+	 tlsf->free_lists[first_level][second_level] = TLSF_INVALID;
+      }
+   }
+}
+
+static uint32_t add_tail_block(TlsfAllocator *tlsf, uint64_t offset, uint32_t prev_physical) {
+   uint32_t tail = new_block(tlsf);
+   tlsf->blocks[tail] = TlsfBlock{offset, tlsf->capacity - offset, prev_physical, TLSF_INVALID,
+				  TLSF_INVALID, TLSF_INVALID, false};
+   insert_free(tlsf, tail);
+   return tail;
+}
+
+
+void tlsf_init(TlsfAllocator *tlsf, uint64_t capacity, uint64_t granularity) {
+   tlsf->granularity = granularity;
+   tlsf->capacity = capacity / granularity * granularity;
+   tlsf->blocks.clear();
+   tlsf->unused_blocks.clear();
+   tlsf->used_bytes = 0;
+   tlsf->allocation_count = 0;
+   reset_free_lists(tlsf);
+   tlsf->first_physical = add_tail_block(tlsf, 0, TLSF_INVALID);
+}
+
+
+uint32_t tlsf_allocate(TlsfAllocator *tlsf, uint64_t size) {
+   uint64_t units = std::max<uint64_t>(1, (size + tlsf->granularity - 1) / tlsf->granularity);
+
+   // round up to the next class boundary, so whatever list the search lands on fits without walking it
+   uint64_t search_units = units;
+   if(units >= (uint64_t)TLSF_SECOND_LEVELS) {
+      search_units += ((uint64_t)1 << (highest_bit(units) - TLSF_SECOND_LEVEL_BITS)) - 1;
+   }
+   int first_level, second_level;
+   size_class(search_units, &first_level, &second_level);
+   if(first_level >= TLSF_FIRST_LEVELS) {
+      return TLSF_INVALID;
+   }
+
+   // @@ first non empty list at or above the class
+   uint32_t second_level_map = tlsf->second_level_bitmap[first_level] & (~0u << second_level);
+   if(!second_level_map) {
+      uint64_t first_level_map = first_level + 1 < TLSF_FIRST_LEVELS ?
+	 tlsf->first_level_bitmap & (~(uint64_t)0 << (first_level + 1)) : 0;
+      if(!first_level_map) {
+	 return TLSF_INVALID;
+      }
+      first_level = lowest_bit(first_level_map);
+      second_level_map = tlsf->second_level_bitmap[first_level];
+   }
+   second_level = lowest_bit(second_level_map);
+   uint32_t index = tlsf->free_lists[first_level][second_level];
+   remove_free(tlsf, index);
+   // @!
+
+   // @@ give the rest back as a block of its own
+   uint64_t size_bytes = units * tlsf->granularity;
+   if(tlsf->blocks[index].size > size_bytes) {
+      uint32_t rest = new_block(tlsf);
+      // new_block may have grown the vector, index the block again afterwards
+      TlsfBlock &block = tlsf->blocks[index];
+      tlsf->blocks[rest] = TlsfBlock{block.offset + size_bytes, block.size - size_bytes, index, block.next_physical,
+				     TLSF_INVALID, TLSF_INVALID, false};
+      if(block.next_physical != TLSF_INVALID) {
+	 tlsf->blocks[block.next_physical].prev_physical = rest;
+      }
+      block.next_physical = rest;
+      block.size = size_bytes;
+      insert_free(tlsf, rest);
+   }
+   // @!
+
+   tlsf->used_bytes += tlsf->blocks[index].size;
+   tlsf->allocation_count += 1;
+   return index;
+}
+
+
+void tlsf_free(TlsfAllocator *tlsf, uint32_t allocation) {
+   uint32_t index = allocation;
+   tlsf->used_bytes -= tlsf->blocks[index].size;
+   tlsf->allocation_count -= 1;
+
+   // @@ merge with free neighbours, the absorbed block records go back on the unused list
+   uint32_t next = tlsf->blocks[index].next_physical;
+   if(next != TLSF_INVALID && tlsf->blocks[next].free) {
+      remove_free(tlsf, next);
+      TlsfBlock &block = tlsf->blocks[index];
+      block.size += tlsf->blocks[next].size;
+      block.next_physical = tlsf->blocks[next].next_physical;
+      if(block.next_physical != TLSF_INVALID) {
+	 tlsf->blocks[block.next_physical].prev_physical = index;
+      }
+      tlsf->unused_blocks.push_back(next);
+   }
+   uint32_t prev = tlsf->blocks[index].prev_physical;
+   if(prev != TLSF_INVALID && tlsf->blocks[prev].free) {
+      remove_free(tlsf, prev);
+      TlsfBlock &block = tlsf->blocks[prev];
+      block.size += tlsf->blocks[index].size;
+      block.next_physical = tlsf->blocks[index].next_physical;
+      if(block.next_physical != TLSF_INVALID) {
+	 tlsf->blocks[block.next_physical].prev_physical = prev;
+      }
+      tlsf->unused_blocks.push_back(index);
+      index = prev;
+   }
+   // @!
+
+   insert_free(tlsf, index);
+}
+
+
+void tlsf_compact(TlsfAllocator *tlsf, std::vector<TlsfMove> *moves) {
+   moves->clear();
+   reset_free_lists(tlsf);
+
+   uint64_t cursor = 0;
+   uint32_t last_used = TLSF_INVALID;
+   uint32_t index = tlsf->first_physical;
+   tlsf->first_physical = TLSF_INVALID;
+   while(index != TLSF_INVALID) {
+      uint32_t next = tlsf->blocks[index].next_physical;
+      TlsfBlock &block = tlsf->blocks[index];
+      if(block.free) {
+	 tlsf->unused_blocks.push_back(index);
+      } else {
+	 if(block.offset != cursor) {
+	    moves->push_back(TlsfMove{block.offset, cursor, block.size});
+	    block.offset = cursor;
+	 }
+	 block.prev_physical = last_used;
+	 block.next_physical = TLSF_INVALID;
+	 if(last_used != TLSF_INVALID) {
+	    tlsf->blocks[last_used].next_physical = index;
+	 } else {
+	    tlsf->first_physical = index;
+	 }
+	 last_used = index;
+	 cursor += block.size;
+      }
+      index = next;
+   }
+
+   if(cursor < tlsf->capacity) {
+      uint32_t tail = add_tail_block(tlsf, cursor, last_used);
+      if(last_used != TLSF_INVALID) {
+	 tlsf->blocks[last_used].next_physical = tail;
+      } else {
+	 tlsf->first_physical = tail;
+      }
+   }
+}
+
+
+void tlsf_stats(const TlsfAllocator *tlsf, TlsfStats *stats) {
+   *stats = TlsfStats{tlsf->used_bytes, 0, 0, 0, tlsf->allocation_count, 0.0f};
+   for(uint32_t index = tlsf->first_physical; index != TLSF_INVALID; index = tlsf->blocks[index].next_physical) {
+      const TlsfBlock &block = tlsf->blocks[index];
+      if(block.free) {
+	 stats->free_bytes += block.size;
+	 stats->largest_free = std::max(stats->largest_free, block.size);
+	 stats->free_blocks += 1;
+      }
+   }
+   if(stats->free_bytes > 0) {
+      stats->fragmentation = 1.0f - (float)((double)stats->largest_free / stats->free_bytes);
+   }
+}
+// @!
+
+
+// @@ buffer arena
+void buffer_arena_init(BufferArena *arena, const char *name, GLsizeiptr capacity, GLsizeiptr granularity) {
+   arena->name = name;
+   glCreateBuffers(1, &arena->buffer);
+   glNamedBufferStorage(arena->buffer, capacity, NULL, GL_DYNAMIC_STORAGE_BIT);
+   tlsf_init(&arena->tlsf, capacity, granularity);
+   arena->scratch_buffer = 0;
+   arena->scratch_size = 0;
+   arena->defragment_count = 0;
+   arena->bytes_moved = 0;
+   arena->failed_allocations = 0;
+}
+
+
+uint32_t buffer_arena_allocate(BufferArena *arena, GLsizeiptr size, const void *data) {
+   uint32_t allocation = tlsf_allocate(&arena->tlsf, size);
+   if(allocation == TLSF_INVALID && arena->tlsf.capacity - arena->tlsf.used_bytes >= (uint64_t)size) {
+      buffer_arena_defragment(arena);
+      allocation = tlsf_allocate(&arena->tlsf, size);
+   }
+   if(allocation == TLSF_INVALID) {
+      std::cerr << "ERROR: " << arena->name << " arena has no room for " << size << " bytes\n";
+      arena->failed_allocations += 1;
+      return TLSF_INVALID;
+   }
+
+   if(data) {
+      glNamedBufferSubData(arena->buffer, buffer_arena_offset(arena, allocation), size, data);
+   }
+   return allocation;
+}
+
+
+void buffer_arena_free(BufferArena *arena, uint32_t allocation) {
+   tlsf_free(&arena->tlsf, allocation);
+}
+
+
+void buffer_arena_defragment(BufferArena *arena) {
+   std::vector<TlsfMove> moves;
+   tlsf_compact(&arena->tlsf, &moves);
+   if(moves.empty()) {
+      return;
+   }
+
+   // moves only go down and come in offset order, so no move overwrites data a later one still needs.
+   // a block sliding by less than its own size overlaps itself, which a copy within one buffer may not
+   for(const TlsfMove &move : moves) {
+      if(move.to + move.size <= move.from) {
+	 glCopyNamedBufferSubData(arena->buffer, arena->buffer, move.from, move.to, move.size);
+      } else {
+	 if((GLsizeiptr)move.size > arena->scratch_size) {
+	    glDeleteBuffers(1, &arena->scratch_buffer);
+	    arena->scratch_size = move.size;
+	    glCreateBuffers(1, &arena->scratch_buffer);
+	    glNamedBufferStorage(arena->scratch_buffer, arena->scratch_size, NULL, 0);
+	 }
+	 glCopyNamedBufferSubData(arena->buffer, arena->scratch_buffer, move.from, 0, move.size);
+	 glCopyNamedBufferSubData(arena->scratch_buffer, arena->buffer, 0, move.to, move.size);
+      }
+      arena->bytes_moved += move.size;
+   }
+   arena->defragment_count += 1;
+}
+
+
+void buffer_arena_print(BufferArena *arena) {
+   TlsfStats stats;
+   tlsf_stats(&arena->tlsf, &stats);
+   printf("%s arena: %u allocations, %.2f of %.2f MB used (%.1f%%)\n", arena->name, stats.allocation_count,
+	  stats.used_bytes / (1024.0 * 1024.0), arena->tlsf.capacity / (1024.0 * 1024.0),
+	  100.0 * stats.used_bytes / arena->tlsf.capacity);
+   printf("   %u free blocks, largest %.2f MB, fragmentation %.1f%%\n", stats.free_blocks,
+	  stats.largest_free / (1024.0 * 1024.0), 100.0f * stats.fragmentation);
+   printf("   %u defragments moved %.2f MB, %u failed allocations\n", arena->defragment_count,
+	  arena->bytes_moved / (1024.0 * 1024.0), arena->failed_allocations);
+}
+
+
+void buffer_arena_destroy(BufferArena *arena) {
+   glDeleteBuffers(1, &arena->buffer);
+   glDeleteBuffers(1, &arena->scratch_buffer);
+   arena->buffer = 0;
+   arena->scratch_buffer = 0;
+}
+// @!
@@ -0,0 +1,120 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+
+// @@ TLSF (two level segregated fit) over a byte range, no memory of its own, only offsets
+// free blocks sit in one list per size class, a power of two split into TLSF_SECOND_LEVELS linear
+// steps, and two bitmaps find the first non empty list that is large enough in constant time. any
+// block handed out is at most 1/TLSF_SECOND_LEVELS larger than asked for (plus granularity rounding)
+const int TLSF_SECOND_LEVEL_BITS = 4;
+const int TLSF_SECOND_LEVELS = 1 << TLSF_SECOND_LEVEL_BITS;
+const int TLSF_FIRST_LEVELS = 48;
+const uint32_t TLSF_INVALID = 0xffffffff;
+// @!
+
+// allocations are handles to these, stable for as long as the allocation lives, even across compaction
+struct TlsfBlock {
+   uint64_t offset;
+   uint64_t size;
+   uint32_t prev_physical;
+   uint32_t next_physical;
+   uint32_t prev_free;
+   uint32_t next_free;
+   bool free;
+};
+
+struct TlsfAllocator {
+   uint64_t capacity;
+   uint64_t granularity;
+   std::vector<TlsfBlock> blocks;
+   std::vector<uint32_t> unused_blocks;
+   uint32_t first_physical;
+
+   uint64_t first_level_bitmap;
+   uint32_t second_level_bitmap[TLSF_FIRST_LEVELS];
+   uint32_t free_lists[TLSF_FIRST_LEVELS][TLSF_SECOND_LEVELS];
+
+   uint64_t used_bytes;
+   uint32_t allocation_count;
+};
+
+// where compaction moved an allocation, in ascending offset order
+struct TlsfMove {
+   uint64_t from;
+   uint64_t to;
+   uint64_t size;
+};
+
+// fragmentation is 1 - largest_free / free_bytes, 0 while all free space is one block
+struct TlsfStats {
+   uint64_t used_bytes;
+   uint64_t free_bytes;
+   uint64_t largest_free;
+   uint32_t free_blocks;
+   uint32_t allocation_count;
+   float fragmentation;
+};
+
+
+// granularity is a power of two, every offset and size is a multiple of it
+void tlsf_init(TlsfAllocator *tlsf, uint64_t capacity, uint64_t granularity);
+// TLSF_INVALID when no free block is large enough
+uint32_t tlsf_allocate(TlsfAllocator *tlsf, uint64_t size);
+void tlsf_free(TlsfAllocator *tlsf, uint32_t allocation);
+inline uint64_t tlsf_offset(const TlsfAllocator *tlsf, uint32_t allocation) {
+   return tlsf->blocks[allocation].offset;
+}
+// slides every allocation down to the start, leaving one free block at the end. the data has to
+// be moved to match, in the order the moves come back
+void tlsf_compact(TlsfAllocator *tlsf, std::vector<TlsfMove> *moves);
+void tlsf_stats(const TlsfAllocator *tlsf, TlsfStats *stats);
+
+
+// @@ GPU buffer arena, one immutable buffer carved up by a TlsfAllocator
+// the buffer never changes name, so vertex arrays made over it stay valid through defragmentation,
+// only offsets of allocations move. uploads and moves all happen on the GL thread, in command order
+// with the draws around them
+struct BufferArena {
+   const char *name;
+   GLuint buffer;
+   TlsfAllocator tlsf;
+   // staging for moves whose source and destination overlap
+   GLuint scratch_buffer;
+   GLsizeiptr scratch_size;
+
+   uint32_t defragment_count;
+   uint64_t bytes_moved;
+   uint32_t failed_allocations;
+};
+
+void buffer_arena_init(BufferArena *arena, const char *name, GLsizeiptr capacity, GLsizeiptr granularity);
+// allocates and uploads data (may be NULL), defragments first if the space is there but split up
+// TLSF_INVALID when it does not fit at all
+uint32_t buffer_arena_allocate(BufferArena *arena, GLsizeiptr size, const void *data);
+void buffer_arena_free(BufferArena *arena, uint32_t allocation);
+inline GLintptr buffer_arena_offset(const BufferArena *arena, uint32_t allocation) {
+   return (GLintptr)tlsf_offset(&arena->tlsf, allocation);
+}
+// compacts with glCopyNamedBufferSubData, a no op while there is no free space between allocations
+void buffer_arena_defragment(BufferArena *arena);
+
+void buffer_arena_print(BufferArena *arena);
+void buffer_arena_destroy(BufferArena *arena);
+// @!
@@ -12,13 +12,13 @@
 :: change this ROOT_DIR and everything else should fix itself
 set ROOT_DIR="X:\Projects\learnopenGL\LearnOpenGL"
 
-set OPTS=/EHsc /I"%ROOT_DIR%\includes"
+set OPTS=/EHsc /std:c++17 /I"%ROOT_DIR%\includes"
 set LIBS=opengl32.lib msvcrt.lib vcruntime.lib libcmt.lib user32.lib gdi32.lib shell32.lib "%ROOT_DIR%\glfw3.lib"
 :::
 
 
 pushd "%ROOT_DIR%\builds\windows_10-x64"
 
-cl /DROOT_DIR=%ROOT_DIR% %OPTS% %LIBS% ../../main.cpp ../../glad.c
+cl /DROOT_DIR=%ROOT_DIR% %OPTS% %LIBS% ../../main.cpp ../../thread_pool.cpp ../../texture_loader.cpp ../../file_map.cpp ../../texture_cache.cpp ../../texture_cooker.cpp ../../texture_array.cpp ../../virtual_texture.cpp ../../texture_budget.cpp ../../texture_streaming.cpp ../../shader.cpp ../../camera_uniforms.cpp ../../shader_watch.cpp ../../gl_state.cpp ../../gl_resources.cpp ../../mesh.cpp ../../vertex_layout.cpp ../../mesh_import.cpp ../../instancing.cpp ../../mesh_batch.cpp ../../stream_ring.cpp ../../buffer_allocator.cpp ../../mesh_arena.cpp ../../gpu_cull.cpp ../../glad.c
 
 popd
@@ -6,7 +6,7 @@
 
 ROOT_DIR="/run/media/james/extra_space/EXTRA_STORAGE/Projects/learnopenGL/LearnOpenGL"
 
-CFLAGS="-std=c++17 -Wall"
+CFLAGS="-std=c++17 -Wall -pthread"
 LDFLAGS="`pkg-config --static --libs glfw3`"
 LCFLAGS="`pkg-config --cflags glfw3`"
 ##
@@ -14,4 +14,4 @@ LCFLAGS="`pkg-config --cflags glfw3`"
 THESE_FLAGS="$LCFLAGS $LDFLAGS $CFLAGS"
 OUTPUT="$ROOT_DIR/builds/linux-x64/main"
 INCLUDES_FLAG="-isystem $ROOT_DIR/includes"
-g++ $THESE_FLAGS main.cpp glad.c -o $OUTPUT $INCLUDES_FLAG
+g++ $THESE_FLAGS main.cpp thread_pool.cpp texture_loader.cpp file_map.cpp texture_cache.cpp texture_cooker.cpp texture_array.cpp virtual_texture.cpp texture_budget.cpp texture_streaming.cpp shader.cpp camera_uniforms.cpp shader_watch.cpp gl_state.cpp gl_resources.cpp mesh.cpp vertex_layout.cpp mesh_import.cpp instancing.cpp mesh_batch.cpp stream_ring.cpp buffer_allocator.cpp mesh_arena.cpp gpu_cull.cpp glad.c -o $OUTPUT $INCLUDES_FLAG
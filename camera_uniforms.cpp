@@ -0,0 +1,36 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "camera_uniforms.h"
+
+
+void camera_uniforms_init(CameraUniforms *camera) {
+   camera->block = CameraBlock{glm::mat4(1.0f), glm::mat4(1.0f), glm::mat4(1.0f), glm::vec4(0.0f), glm::vec4(0.0f)};
+}
+
+
+void camera_uniforms_update(CameraUniforms *camera, StreamRing *ring, const glm::mat4 &view,
+			    const glm::mat4 &projection, glm::vec3 camera_position, float time, float delta_time) {
+   camera->block.view = view;
+   camera->block.projection = projection;
+   camera->block.view_projection = projection * view;
+   camera->block.camera_position = glm::vec4(camera_position, 1.0f);
+   camera->block.time = glm::vec4(time, delta_time, 0.0f, 0.0f);
+
+   // a plain store into mapped memory. a full ring keeps last frame's binding, stale by a frame at worst
+   GLintptr offset = stream_ring_write(ring, &camera->block, sizeof(CameraBlock));
+   if(offset >= 0) {
+      GLsizeiptr size = sizeof(CameraBlock);
+      glBindBuffersRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, 1, &ring->buffer, &offset, &size);
+   }
+}
@@ -0,0 +1,45 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "shader.h"
+#include "stream_ring.h"
+
+
+// std140 mirror of the Camera block in the shaders, only vec4 and mat4 members so the C++ layout
+// matches without explicit padding. keep both sides in the same order
+struct CameraBlock {
+   glm::mat4 view;
+   glm::mat4 projection;
+   glm::mat4 view_projection;
+   glm::vec4 camera_position;   // w unused
+   glm::vec4 time;              // x seconds since start, y delta time, zw unused
+};
+
+// the block has no buffer of its own, every frame streams a fresh copy through the ring
+struct CameraUniforms {
+   CameraBlock block;
+};
+
+
+void camera_uniforms_init(CameraUniforms *camera);
+
+// once per frame before the first draw, after stream_ring_begin_frame. binds this frame's copy to
+// CAMERA_BLOCK_BINDING, programs then only need their per draw model data
+void camera_uniforms_update(CameraUniforms *camera, StreamRing *ring, const glm::mat4 &view,
+			    const glm::mat4 &projection, glm::vec3 camera_position, float time, float delta_time);
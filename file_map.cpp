@@ -0,0 +1,164 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "file_map.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+bool file_map_open(std::string path, FileMapping *mapping) {
+   mapping->data = NULL;
+   mapping->size = 0;
+   mapping->file_handle = INVALID_HANDLE_VALUE;
+   mapping->mapping_handle = NULL;
+
+   HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			     FILE_ATTRIBUTE_NORMAL, NULL);
+   if(file == INVALID_HANDLE_VALUE) {
+      return false;
+   }
+
+   LARGE_INTEGER file_size;
+   if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+      CloseHandle(file);
+      return false;
+   }
+
+   HANDLE file_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+   if(!file_mapping) {
+      CloseHandle(file);
+      return false;
+   }
+
+   void *view = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+   if(!view) {
+      CloseHandle(file_mapping);
+      CloseHandle(file);
+      return false;
+   }
+
+   mapping->data = (const unsigned char *)view;
+   mapping->size = (size_t)file_size.QuadPart;
+   mapping->file_handle = file;
+   mapping->mapping_handle = file_mapping;
+   return true;
+}
+
+
+void file_map_close(FileMapping *mapping) {
+   if(mapping->data) {
+      UnmapViewOfFile(mapping->data);
+      CloseHandle(mapping->mapping_handle);
+      CloseHandle(mapping->file_handle);
+   }
+   mapping->data = NULL;
+   mapping->size = 0;
+}
+#else
+bool file_map_open(std::string path, FileMapping *mapping) {
+   mapping->data = NULL;
+   mapping->size = 0;
+   mapping->file_descriptor = -1;
+
+   int fd = open(path.c_str(), O_RDONLY);
+   if(fd < 0) {
+      return false;
+   }
+
+   struct stat file_stat;
+   if(fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+      close(fd);
+      return false;
+   }
+
+   void *view = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   if(view == MAP_FAILED) {
+      close(fd);
+      return false;
+   }
+
+   mapping->data = (const unsigned char *)view;
+   mapping->size = (size_t)file_stat.st_size;
+   mapping->file_descriptor = fd;
+   return true;
+}
+
+
+void file_map_close(FileMapping *mapping) {
+   if(mapping->data) {
+      munmap((void *)mapping->data, mapping->size);
+      close(mapping->file_descriptor);
+   }
+   mapping->data = NULL;
+   mapping->size = 0;
+}
+#endif
+
+
+static unsigned long process_id() {
+#ifdef _WIN32
+   return (unsigned long)GetCurrentProcessId();
+#else
+   return (unsigned long)getpid();
+#endif
+}
+
+bool file_write_atomic(std::string path, const void *data, size_t size) {
+   // workers or other instances may be writing the same path, each writer needs a temp file of its own
+   static std::atomic<unsigned long> temp_counter{0};
+   std::string temp_path = path + "." + std::to_string(process_id()) + "." + std::to_string(temp_counter++) + ".tmp";
+   FILE *file = fopen(temp_path.c_str(), "wb");
+   if(!file) {
+      return false;
+   }
+
+   bool written = fwrite(data, 1, size, file) == size;
+   written = (fclose(file) == 0) && written;
+   if(!written) {
+      remove(temp_path.c_str());
+      return false;
+   }
+
+   std::error_code error;
+   std::filesystem::rename(temp_path, path, error);
+   if(error) {
+      remove(temp_path.c_str());
+      return false;
+   }
+   return true;
+}
+
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed) {
+   const unsigned char *bytes = (const unsigned char *)data;
+   uint64_t hash = seed;
+   for(size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+   }
+   return hash;
+}
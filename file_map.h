@@ -0,0 +1,41 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+// read only view of a whole file, pages come in lazily on first touch
+struct FileMapping {
+   const unsigned char *data;
+   size_t size;
+#ifdef _WIN32
+   void *file_handle;
+   void *mapping_handle;
+#else
+   int file_descriptor;
+#endif
+};
+
+
+bool file_map_open(std::string path, FileMapping *mapping);
+void file_map_close(FileMapping *mapping);
+
+// writes to a temporary next to path and renames over it, so readers never see a partial file
+bool file_write_atomic(std::string path, const void *data, size_t size);
+
+// FNV-1a, good enough to key caches on file contents
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ull);
@@ -0,0 +1,169 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "gl_resources.h"
+
+#include <cstdio>
+
+
+GLuint gl_create_buffer(GLsizeiptr size, const void *data, GLbitfield storage_flags) {
+   GLuint buffer;
+   glCreateBuffers(1, &buffer);
+   glNamedBufferStorage(buffer, size, data, storage_flags);
+   return buffer;
+}
+
+
+GLuint gl_create_texture(GLenum target, GLenum internal_format, GLsizei width, GLsizei height, GLsizei layers,
+			 GLsizei level_count) {
+   GLuint texture;
+   glCreateTextures(target, 1, &texture);
+   if(target == GL_TEXTURE_2D_ARRAY) {
+      glTextureStorage3D(texture, level_count, internal_format, width, height, layers);
+   } else {
+      glTextureStorage2D(texture, level_count, internal_format, width, height);
+   }
+   glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, level_count - 1);
+   return texture;
+}
+
+
+void gl_texture_sampling(GLuint texture, GLenum wrap, GLenum min_filter, GLenum mag_filter) {
+   glTextureParameteri(texture, GL_TEXTURE_WRAP_S, wrap);
+   glTextureParameteri(texture, GL_TEXTURE_WRAP_T, wrap);
+   glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, min_filter);
+   glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, mag_filter);
+}
+
+
+GLuint gl_create_vertex_array(GLuint vertex_buffer, GLsizei stride, const VertexAttributeFormat *attributes,
+			      int attribute_count, GLuint index_buffer) {
+   GLuint vertex_array;
+   glCreateVertexArrays(1, &vertex_array);
+   gl_vertex_array_add_buffer(vertex_array, 0, vertex_buffer, stride, attributes, attribute_count, 0);
+   if(index_buffer) {
+      glVertexArrayElementBuffer(vertex_array, index_buffer);
+   }
+   return vertex_array;
+}
+
+
+void gl_vertex_array_add_buffer(GLuint vertex_array, GLuint binding, GLuint buffer, GLsizei stride,
+				const VertexAttributeFormat *attributes, int attribute_count, GLuint divisor) {
+   glVertexArrayVertexBuffer(vertex_array, binding, buffer, 0, stride);
+   glVertexArrayBindingDivisor(vertex_array, binding, divisor);
+   for(int i = 0; i < attribute_count; ++i) {
+      const VertexAttributeFormat &attribute = attributes[i];
+      glEnableVertexArrayAttrib(vertex_array, attribute.location);
+      glVertexArrayAttribFormat(vertex_array, attribute.location, attribute.size, attribute.type,
+				attribute.normalized, attribute.offset);
+      glVertexArrayAttribBinding(vertex_array, attribute.location, binding);
+   }
+}
+
+
+// @@ resource thread
+static void resource_thread_main(GLResourceThread *resources) {
+   glfwMakeContextCurrent(resources->context);
+   while(true) {
+      GLResourceJob job;
+      {
+	 std::unique_lock<std::mutex> lock{resources->mutex};
+	 resources->wake.wait(lock, [resources]() { return resources->quit || !resources->queued.empty(); });
+	 if(resources->quit) {
+	    break;
+	 }
+	 job = std::move(resources->queued.front());
+	 resources->queued.pop_front();
+      }
+
+      job.create();
+      // the flush makes sure the fence actually reaches the GPU for the other context to wait on
+      job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      glFlush();
+
+      std::lock_guard<std::mutex> lock{resources->mutex};
+      resources->fenced.push_back(std::move(job));
+   }
+   glfwMakeContextCurrent(NULL);
+}
+
+
+bool gl_resource_thread_start(GLResourceThread *resources, GLFWwindow *main_window) {
+   resources->quit = false;
+   // every other hint is still the main window's, so the version and profile match
+   glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+   resources->context = glfwCreateWindow(1, 1, "resources", NULL, main_window);
+   glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+   if(!resources->context) {
+      printf("@DEV_WARNING: no shared context, resources are created on the GL thread.\n");
+      return false;
+   }
+   resources->thread = std::thread(resource_thread_main, resources);
+   return true;
+}
+
+
+void gl_resource_thread_submit(GLResourceThread *resources, std::function<void()> create,
+			       std::function<void()> ready) {
+   if(!resources->context) {
+      create();
+      ready();
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock{resources->mutex};
+      resources->queued.push_back(GLResourceJob{create, ready, 0});
+   }
+   resources->wake.notify_one();
+}
+
+
+void gl_resource_thread_update(GLResourceThread *resources) {
+   std::deque<GLResourceJob> landed;
+   {
+      std::lock_guard<std::mutex> lock{resources->mutex};
+      while(!resources->fenced.empty()) {
+	 GLenum wait_result = glClientWaitSync(resources->fenced.front().fence, 0, 0);
+	 if(wait_result != GL_ALREADY_SIGNALED && wait_result != GL_CONDITION_SATISFIED) {
+	    break;
+	 }
+	 landed.push_back(std::move(resources->fenced.front()));
+	 resources->fenced.pop_front();
+      }
+   }
+   // callbacks run unlocked, they are free to submit more work
+   for(GLResourceJob &job : landed) {
+      glDeleteSync(job.fence);
+      job.ready();
+   }
+}
+
+
+void gl_resource_thread_stop(GLResourceThread *resources) {
+   if(!resources->context) {
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock{resources->mutex};
+      resources->quit = true;
+   }
+   resources->wake.notify_one();
+   resources->thread.join();
+   for(GLResourceJob &job : resources->fenced) {
+      glDeleteSync(job.fence);
+   }
+   resources->fenced.clear();
+   glfwDestroyWindow(resources->context);
+}
+// @!
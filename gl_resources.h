@@ -0,0 +1,82 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+// @@ direct state access creation, everything comes back with immutable storage and nothing is bound
+// loader textures stay mutable since budget drops and streaming respecify their levels. glTexImage* has
+// no DSA form, so those calls are the only texture edits left that bind
+// storage flags are the glBufferStorage ones, 0 for data only the GPU touches after creation
+GLuint gl_create_buffer(GLsizeiptr size, const void *data, GLbitfield storage_flags);
+
+// GL_TEXTURE_2D ignores layers, GL_TEXTURE_2D_ARRAY uses it as the layer count
+GLuint gl_create_texture(GLenum target, GLenum internal_format, GLsizei width, GLsizei height, GLsizei layers,
+			 GLsizei level_count);
+void gl_texture_sampling(GLuint texture, GLenum wrap, GLenum min_filter, GLenum mag_filter);
+
+struct VertexAttributeFormat {
+   GLuint location;
+   GLint size;
+   GLenum type;
+   GLboolean normalized;
+   GLuint offset;
+};
+
+// one interleaved vertex buffer on binding 0, index_buffer may be 0
+GLuint gl_create_vertex_array(GLuint vertex_buffer, GLsizei stride, const VertexAttributeFormat *attributes,
+			      int attribute_count, GLuint index_buffer);
+// another interleaved buffer on binding, a divisor of 1 advances it once per instance instead of per vertex
+void gl_vertex_array_add_buffer(GLuint vertex_array, GLuint binding, GLuint buffer, GLsizei stride,
+				const VertexAttributeFormat *attributes, int attribute_count, GLuint divisor);
+// @!
+
+
+// @@ resource thread, a hidden window whose context shares objects with the main one
+// create jobs run there and are fenced, their ready callback runs on the GL thread once the fence has
+// passed. container objects (VAOs, framebuffers) are not shared between contexts, make those in ready
+struct GLResourceJob {
+   std::function<void()> create;
+   std::function<void()> ready;
+   GLsync fence;
+};
+
+struct GLResourceThread {
+   GLFWwindow *context;
+   std::thread thread;
+   std::mutex mutex;
+   std::condition_variable wake;
+   std::deque<GLResourceJob> queued;
+   std::deque<GLResourceJob> fenced;
+   bool quit;
+};
+
+
+// GL thread, after the main context is current. false means no shared context, submit then runs
+// both halves of a job immediately on the calling thread
+bool gl_resource_thread_start(GLResourceThread *resources, GLFWwindow *main_window);
+void gl_resource_thread_submit(GLResourceThread *resources, std::function<void()> create,
+			       std::function<void()> ready);
+// GL thread, once per frame: runs ready callbacks of jobs whose fence has passed
+void gl_resource_thread_update(GLResourceThread *resources);
+void gl_resource_thread_stop(GLResourceThread *resources);
+// @!
@@ -0,0 +1,208 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "gl_state.h"
+
+#include <cstdio>
+
+
+// never a real name or enum, so nothing compares equal to it
+const GLuint UNKNOWN_NAME = 0xFFFFFFFF;
+
+
+static int texture_target_index(GLenum target) {
+   switch(target) {
+   case GL_TEXTURE_2D: return 0;
+   case GL_TEXTURE_2D_ARRAY: return 1;
+   case GL_TEXTURE_3D: return 2;
+   case GL_TEXTURE_CUBE_MAP: return 3;
+   default: return -1;
+   }
+}
+
+static int buffer_target_index(GLenum target) {
+   switch(target) {
+   case GL_ARRAY_BUFFER: return 0;
+   case GL_UNIFORM_BUFFER: return 1;
+   case GL_SHADER_STORAGE_BUFFER: return 2;
+   case GL_DRAW_INDIRECT_BUFFER: return 3;
+   case GL_PARAMETER_BUFFER: return 4;
+   default: return -1;
+   }
+}
+
+static int *enable_slot(GLStateCache *state, GLenum capability) {
+   switch(capability) {
+   case GL_DEPTH_TEST: return &state->depth_test;
+   case GL_BLEND: return &state->blend;
+   case GL_CULL_FACE: return &state->cull_face;
+   default: return NULL;
+   }
+}
+
+// true when the call has to go to GL, and the shadow is already updated to value
+template<typename T>
+static bool changes(GLStateCache *state, T *shadow, T value) {
+   if(*shadow == value) {
+      state->calls_elided += 1;
+      return false;
+   }
+   *shadow = value;
+   state->calls_issued += 1;
+   return true;
+}
+
+
+void gl_state_init(GLStateCache *state) {
+   state->calls_issued = 0;
+   state->calls_elided = 0;
+   gl_state_invalidate(state);
+}
+
+
+void gl_state_invalidate(GLStateCache *state) {
+   state->program = UNKNOWN_NAME;
+   state->vertex_array = UNKNOWN_NAME;
+   state->framebuffer = UNKNOWN_NAME;
+   state->active_texture_unit = UNKNOWN_NAME;
+   for(int unit = 0; unit < GL_STATE_TEXTURE_UNITS; ++unit) {
+      for(int target = 0; target < GL_STATE_TEXTURE_TARGETS; ++target) {
+	 state->textures[unit][target] = UNKNOWN_NAME;
+      }
+   }
+   for(int target = 0; target < GL_STATE_BUFFER_TARGETS; ++target) {
+      state->buffers[target] = UNKNOWN_NAME;
+   }
+   state->depth_test = -1;
+   state->blend = -1;
+   state->cull_face = -1;
+   state->depth_func = UNKNOWN_NAME;
+   state->depth_mask = -1;
+   state->blend_src = UNKNOWN_NAME;
+   state->blend_dst = UNKNOWN_NAME;
+   state->viewport[0] = state->viewport[1] = state->viewport[2] = state->viewport[3] = -1;
+}
+
+
+void gl_state_print(GLStateCache *state, uint64_t frames) {
+   uint64_t total = state->calls_issued + state->calls_elided;
+   printf("gl state: %llu calls issued, %llu elided (%.1f%%), %.1f issued per frame\n",
+	  (unsigned long long)state->calls_issued, (unsigned long long)state->calls_elided,
+	  total ? 100.0 * state->calls_elided / total : 0.0,
+	  frames ? (double)state->calls_issued / frames : 0.0);
+}
+
+
+void gl_state_use_program(GLStateCache *state, GLuint program) {
+   if(changes(state, &state->program, program)) {
+      glUseProgram(program);
+   }
+}
+
+void gl_state_bind_vertex_array(GLStateCache *state, GLuint vertex_array) {
+   if(changes(state, &state->vertex_array, vertex_array)) {
+      glBindVertexArray(vertex_array);
+   }
+}
+
+void gl_state_bind_framebuffer(GLStateCache *state, GLuint framebuffer) {
+   if(changes(state, &state->framebuffer, framebuffer)) {
+      glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+   }
+}
+
+void gl_state_bind_texture(GLStateCache *state, int unit, GLenum target, GLuint texture) {
+   int target_index = texture_target_index(target);
+   if(unit >= GL_STATE_TEXTURE_UNITS || target_index < 0) {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      glBindTexture(target, texture);
+      state->active_texture_unit = GL_TEXTURE0 + unit;
+      state->calls_issued += 2;
+      return;
+   }
+   // a bind that is already in place needs no unit switch either, both calls are saved
+   if(state->textures[unit][target_index] == texture) {
+      state->calls_elided += 2;
+      return;
+   }
+   if(changes(state, &state->active_texture_unit, (GLenum)(GL_TEXTURE0 + unit))) {
+      glActiveTexture(GL_TEXTURE0 + unit);
+   }
+   state->textures[unit][target_index] = texture;
+   state->calls_issued += 1;
+   glBindTexture(target, texture);
+}
+
+void gl_state_bind_buffer(GLStateCache *state, GLenum target, GLuint buffer) {
+   int target_index = buffer_target_index(target);
+   if(target_index < 0) {
+      state->calls_issued += 1;
+      glBindBuffer(target, buffer);
+      return;
+   }
+   if(changes(state, &state->buffers[target_index], buffer)) {
+      glBindBuffer(target, buffer);
+   }
+}
+
+
+void gl_state_enable(GLStateCache *state, GLenum capability, bool enabled) {
+   int *slot = enable_slot(state, capability);
+   if(!slot || changes(state, slot, (int)enabled)) {
+      if(!slot) {
+	 state->calls_issued += 1;
+      }
+      if(enabled) {
+	 glEnable(capability);
+      } else {
+	 glDisable(capability);
+      }
+   }
+}
+
+void gl_state_depth_func(GLStateCache *state, GLenum func) {
+   if(changes(state, &state->depth_func, func)) {
+      glDepthFunc(func);
+   }
+}
+
+void gl_state_depth_mask(GLStateCache *state, bool write) {
+   if(changes(state, &state->depth_mask, (int)write)) {
+      glDepthMask(write ? GL_TRUE : GL_FALSE);
+   }
+}
+
+void gl_state_blend_func(GLStateCache *state, GLenum src, GLenum dst) {
+   if(state->blend_src == src && state->blend_dst == dst) {
+      state->calls_elided += 1;
+      return;
+   }
+   state->blend_src = src;
+   state->blend_dst = dst;
+   state->calls_issued += 1;
+   glBlendFunc(src, dst);
+}
+
+void gl_state_viewport(GLStateCache *state, GLint x, GLint y, GLsizei width, GLsizei height) {
+   GLint *viewport = state->viewport;
+   if(viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height) {
+      state->calls_elided += 1;
+      return;
+   }
+   viewport[0] = x;
+   viewport[1] = y;
+   viewport[2] = width;
+   viewport[3] = height;
+   state->calls_issued += 1;
+   glViewport(x, y, width, height);
+}
@@ -0,0 +1,73 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <cstdint>
+
+
+// @@ shadowed state, anything not in here goes straight to GL
+// element array bindings belong to the VAO and pixel pack/unpack buffers are upload plumbing, so
+// neither is shadowed. code that binds behind the cache's back has to put things back the way it
+// found them, or call gl_state_invalidate
+const int GL_STATE_TEXTURE_UNITS = 16;
+const int GL_STATE_TEXTURE_TARGETS = 4;  // 2D, 2D array, 3D, cube map
+// indexed uniform and storage bindings go through the plural glBindBuffersBase/Range. the singular
+// forms also move the generic binding of the target behind the cache's back, the plural ones leave it be
+const int GL_STATE_BUFFER_TARGETS = 5;   // array, uniform, shader storage, draw indirect, parameter
+// @!
+
+struct GLStateCache {
+   GLuint program;
+   GLuint vertex_array;
+   GLuint framebuffer;
+   GLenum active_texture_unit;
+   GLuint textures[GL_STATE_TEXTURE_UNITS][GL_STATE_TEXTURE_TARGETS];
+   GLuint buffers[GL_STATE_BUFFER_TARGETS];
+
+   // enables are -1 while unknown
+   int depth_test;
+   int blend;
+   int cull_face;
+   GLenum depth_func;
+   int depth_mask;
+   GLenum blend_src;
+   GLenum blend_dst;
+   GLint viewport[4];
+
+   uint64_t calls_issued;
+   uint64_t calls_elided;
+};
+
+
+// starts with everything unknown, so the first call of each kind is always issued
+void gl_state_init(GLStateCache *state);
+// forget the shadow, for after code that changed state directly (or deleted a bound object)
+void gl_state_invalidate(GLStateCache *state);
+void gl_state_print(GLStateCache *state, uint64_t frames);
+
+void gl_state_use_program(GLStateCache *state, GLuint program);
+void gl_state_bind_vertex_array(GLStateCache *state, GLuint vertex_array);
+void gl_state_bind_framebuffer(GLStateCache *state, GLuint framebuffer);
+// switches units only when the bind actually changes, an elided bind leaves the active unit wherever
+// the last real one put it. code binding raw afterwards has to call glActiveTexture itself
+void gl_state_bind_texture(GLStateCache *state, int unit, GLenum target, GLuint texture);
+void gl_state_bind_buffer(GLStateCache *state, GLenum target, GLuint buffer);
+
+void gl_state_enable(GLStateCache *state, GLenum capability, bool enabled);
+void gl_state_depth_func(GLStateCache *state, GLenum func);
+void gl_state_depth_mask(GLStateCache *state, bool write);
+void gl_state_blend_func(GLStateCache *state, GLenum src, GLenum dst);
+void gl_state_viewport(GLStateCache *state, GLint x, GLint y, GLsizei width, GLsizei height);
@@ -0,0 +1,254 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "gpu_cull.h"
+
+#include "gl_resources.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+
+const GLuint GPU_CULL_GROUP_SIZE = 64;
+const GLuint GPU_CULL_HIZ_GROUP_SIZE = 8;
+
+
+// the blit out of the default framebuffer only works into the exact same depth format
+static GLenum default_depth_format(bool *has_stencil) {
+   GLint depth_bits = 0;
+   GLint stencil_bits = 0;
+   GLint depth_type = GL_NONE;
+   glGetNamedFramebufferAttachmentParameteriv(0, GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depth_bits);
+   glGetNamedFramebufferAttachmentParameteriv(0, GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &depth_type);
+   glGetNamedFramebufferAttachmentParameteriv(0, GL_STENCIL, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencil_bits);
+   *has_stencil = stencil_bits > 0;
+   if(depth_type == GL_FLOAT && depth_bits == 32) {
+      return *has_stencil ? GL_DEPTH32F_STENCIL8 : GL_DEPTH_COMPONENT32F;
+   }
+   if(depth_bits == 24) {
+      return *has_stencil ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24;
+   }
+   if(depth_bits == 16 && !*has_stencil) {
+      return GL_DEPTH_COMPONENT16;
+   }
+   return GL_NONE;
+}
+
+
+void gpu_cull_init(GpuCull *cull, MeshBatch *batch, ShaderProgram *cull_program, ShaderProgram *hiz_program,
+		   int width, int height, bool occlusion, bool indirect_count) {
+   *cull = GpuCull{};
+   cull->batch = batch;
+   cull->cull_program = cull_program;
+   cull->hiz_program = hiz_program;
+   cull->indirect_count = indirect_count;
+   cull->width = width;
+   cull->height = height;
+   cull->hiz_view_projection = glm::mat4(1.0f);
+
+   // @@ bounds never change after mesh_batch_create, only the visible set is written per frame
+   size_t object_count = batch->object_spheres.size();
+   std::vector<GLuint> object_meshes(object_count);
+   for(size_t i = 0; i < object_count; ++i) {
+      object_meshes[i] = (GLuint)batch->objects[i].mesh;
+   }
+   cull->sphere_buffer = gl_create_buffer(object_count * sizeof(glm::vec4), batch->object_spheres.data(), 0);
+   cull->mesh_buffer = gl_create_buffer(object_count * sizeof(GLuint), object_meshes.data(), 0);
+   cull->command_buffer = gl_create_buffer(object_count * sizeof(DrawElementsIndirectCommand), NULL, 0);
+   cull->draw_object_buffer = gl_create_buffer(object_count * sizeof(GLuint), NULL, 0);
+   cull->counter_buffer = gl_create_buffer(sizeof(GLuint), NULL, 0);
+   // @!
+
+   // @@ pyramid level 0 is full resolution, every level after it half the one before
+   bool has_stencil = false;
+   GLenum depth_format = occlusion ? default_depth_format(&has_stencil) : GL_NONE;
+   if(occlusion && depth_format == GL_NONE) {
+      printf("@DEV_WARNING: no copyable default framebuffer depth, culling against the frustum only.\n");
+   }
+   cull->occlusion = depth_format != GL_NONE;
+   if(cull->occlusion) {
+      cull->levels = 1;
+      while(std::max(width, height) >> cull->levels) {
+	 cull->levels += 1;
+      }
+      cull->depth_texture = gl_create_texture(GL_TEXTURE_2D, depth_format, width, height, 1, 1);
+      gl_texture_sampling(cull->depth_texture, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+      glCreateFramebuffers(1, &cull->depth_framebuffer);
+      glNamedFramebufferTexture(cull->depth_framebuffer, has_stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+				cull->depth_texture, 0);
+      cull->hiz_texture = gl_create_texture(GL_TEXTURE_2D, GL_R32F, width, height, 1, cull->levels);
+      gl_texture_sampling(cull->hiz_texture, GL_CLAMP_TO_EDGE, GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST);
+   }
+   // @!
+}
+
+
+void gpu_cull_set_uniforms(GpuCull *cull, GLStateCache *state) {
+   gl_state_use_program(state, cull->cull_program->id);
+   set_uniform(shader_uniform_sampler(cull->cull_program, "hiz_pyramid"), GPU_CULL_HIZ_UNIT);
+
+   gl_state_use_program(state, cull->hiz_program->id);
+   set_uniform(shader_uniform_sampler(cull->hiz_program, "depth_texture"), GPU_CULL_HIZ_UNIT);
+   cull->hiz_from_depth = shader_uniform_int(cull->hiz_program, "from_depth");
+}
+
+
+void gpu_cull_dispatch(GpuCull *cull, GLStateCache *state, StreamRing *ring, const glm::mat4 &view_projection) {
+   MeshBatch *batch = cull->batch;
+   GLuint object_count = (GLuint)batch->object_spheres.size();
+
+   // @@ per frame inputs, a full ring skips the dispatch and the draw repeats last frame's set
+   GpuCullBlock block;
+   block.hiz_view_projection = cull->hiz_view_projection;
+   mesh_batch_frustum_planes(view_projection, block.frustum_planes);
+   block.hiz_size = glm::vec4((float)cull->width, (float)cull->height, (float)cull->levels,
+			      cull->occlusion && cull->hiz_valid ? 1.0f : 0.0f);
+   block.counts = glm::uvec4(object_count, 0, 0, 0);
+   mesh_batch_draw_ranges(batch, &cull->ranges);
+
+   GLsizeiptr block_size = sizeof(GpuCullBlock);
+   GLsizeiptr range_size = cull->ranges.size() * sizeof(MeshDrawRange);
+   GLintptr block_offset = stream_ring_write(ring, &block, block_size);
+   GLintptr range_offset = stream_ring_write(ring, cull->ranges.data(), range_size);
+   if(block_offset < 0 || range_offset < 0) {
+      return;
+   }
+   glBindBuffersRange(GL_UNIFORM_BUFFER, GPU_CULL_BLOCK_BINDING, 1, &ring->buffer, &block_offset, &block_size);
+   glBindBuffersRange(GL_SHADER_STORAGE_BUFFER, GPU_CULL_RANGE_BINDING, 1, &ring->buffer, &range_offset,
+		      &range_size);
+   // @!
+
+   // @@ the counter restarts at zero, without a GPU side draw count every slot must read as an empty draw
+   GLuint zero = 0;
+   glClearNamedBufferSubData(cull->counter_buffer, GL_R32UI, 0, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+   if(!cull->indirect_count) {
+      glClearNamedBufferData(cull->command_buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+   }
+   // @!
+
+   GLuint inputs[2] = {cull->sphere_buffer, cull->mesh_buffer};
+   glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_SPHERE_BINDING, 2, inputs);
+   glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_COMMAND_BINDING, 1, &cull->command_buffer);
+   glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, MESH_BATCH_DRAW_BINDING, 1, &cull->draw_object_buffer);
+   glBindBuffersBase(GL_ATOMIC_COUNTER_BUFFER, GPU_CULL_COUNTER_BINDING, 1, &cull->counter_buffer);
+   if(cull->occlusion) {
+      gl_state_bind_texture(state, GPU_CULL_HIZ_UNIT, GL_TEXTURE_2D, cull->hiz_texture);
+   }
+   gl_state_use_program(state, cull->cull_program->id);
+   glDispatchCompute((object_count + GPU_CULL_GROUP_SIZE - 1) / GPU_CULL_GROUP_SIZE, 1, 1);
+
+   // commands and count are read as draw parameters, the draw objects by the vertex shader, and the
+   // counter by gpu_cull_check's readback and both by next frame's clears
+   glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+
+void gpu_cull_draw(GpuCull *cull, GLStateCache *state) {
+   GLsizei max_draw_count = (GLsizei)cull->batch->object_spheres.size();
+   gl_state_bind_vertex_array(state, cull->batch->vertex_array);
+   gl_state_bind_buffer(state, GL_DRAW_INDIRECT_BUFFER, cull->command_buffer);
+   if(cull->indirect_count) {
+      gl_state_bind_buffer(state, GL_PARAMETER_BUFFER, cull->counter_buffer);
+      glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, 0, max_draw_count, 0);
+   } else {
+      glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, max_draw_count, 0);
+   }
+}
+
+
+void gpu_cull_build_hiz(GpuCull *cull, GLStateCache *state, const glm::mat4 &view_projection) {
+   if(!cull->occlusion) {
+      return;
+   }
+   glBlitNamedFramebuffer(0, cull->depth_framebuffer, 0, 0, cull->width, cull->height, 0, 0, cull->width,
+			  cull->height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+   // @@ level 0 copies the depth, each level after it reduces the one before to its farthest depth
+   gl_state_use_program(state, cull->hiz_program->id);
+   gl_state_bind_texture(state, GPU_CULL_HIZ_UNIT, GL_TEXTURE_2D, cull->depth_texture);
+   for(int level = 0; level < cull->levels; ++level) {
+      GLuint level_width = (GLuint)std::max(1, cull->width >> level);
+      GLuint level_height = (GLuint)std::max(1, cull->height >> level);
+      set_uniform(cull->hiz_from_depth, level == 0);
+      if(level > 0) {
+	 glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	 glBindImageTexture(0, cull->hiz_texture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+      }
+      glBindImageTexture(1, cull->hiz_texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+      glDispatchCompute((level_width + GPU_CULL_HIZ_GROUP_SIZE - 1) / GPU_CULL_HIZ_GROUP_SIZE,
+			(level_height + GPU_CULL_HIZ_GROUP_SIZE - 1) / GPU_CULL_HIZ_GROUP_SIZE, 1);
+   }
+   glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+   // @!
+
+   cull->hiz_view_projection = view_projection;
+   cull->hiz_valid = true;
+}
+
+
+bool gpu_cull_check(GpuCull *cull, const glm::mat4 &view_projection) {
+   GLuint gpu_visible = 0;
+   glGetNamedBufferSubData(cull->counter_buffer, 0, sizeof(GLuint), &gpu_visible);
+   mesh_batch_cull(cull->batch, view_projection);
+   size_t cpu_visible = cull->batch->commands.size();
+
+   // a sphere that just touches a plane can round either way between the two
+   glm::vec4 planes[6];
+   mesh_batch_frustum_planes(view_projection, planes);
+   size_t borderline = 0;
+   for(const glm::vec4 &sphere : cull->batch->object_spheres) {
+      for(const glm::vec4 &plane : planes) {
+	 if(std::abs(glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w + sphere.w) < 1e-3f) {
+	    borderline += 1;
+	    break;
+	 }
+      }
+   }
+
+   cull->check_frames += 1;
+   size_t difference = gpu_visible > cpu_visible ? gpu_visible - cpu_visible : cpu_visible - gpu_visible;
+   if(difference > borderline) {
+      cull->check_failures += 1;
+      std::cerr << "ERROR: GPU culling kept " << gpu_visible << " objects, the CPU reference " << cpu_visible
+		<< " (" << borderline << " on a plane)" << '\n';
+      return false;
+   }
+   return true;
+}
+
+
+void gpu_cull_print(GpuCull *cull) {
+   printf("gpu culling: %zu objects against the frustum%s, draw count from %s\n",
+	  cull->batch->object_spheres.size(), cull->occlusion ? " and the hi-z pyramid" : "",
+	  cull->indirect_count ? "the atomic counter" : "every slot, culled ones empty");
+   if(cull->occlusion) {
+      printf("   hi-z pyramid %dx%d in %d levels\n", cull->width, cull->height, cull->levels);
+   }
+   if(cull->check_frames > 0) {
+      printf("   %llu of %llu checked frames matched the CPU reference\n",
+	     (unsigned long long)(cull->check_frames - cull->check_failures), (unsigned long long)cull->check_frames);
+   }
+}
+
+
+void gpu_cull_destroy(GpuCull *cull) {
+   GLuint buffers[5] = {cull->sphere_buffer, cull->mesh_buffer, cull->command_buffer, cull->draw_object_buffer,
+			cull->counter_buffer};
+   glDeleteBuffers(5, buffers);
+   GLuint textures[2] = {cull->depth_texture, cull->hiz_texture};
+   glDeleteTextures(2, textures);
+   glDeleteFramebuffers(1, &cull->depth_framebuffer);
+   *cull = GpuCull{};
+}
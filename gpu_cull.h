@@ -0,0 +1,109 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "gl_state.h"
+#include "mesh_batch.h"
+#include "shader.h"
+#include "stream_ring.h"
+
+
+// @@ bindings, shaders/gpu_cull.comp declares the same numbers. the visible objects go to
+// MESH_BATCH_DRAW_BINDING, where shaders/batched.vert already reads them
+const GLuint GPU_CULL_SPHERE_BINDING = 4;
+const GLuint GPU_CULL_MESH_BINDING = 5;
+const GLuint GPU_CULL_RANGE_BINDING = 6;
+const GLuint GPU_CULL_COMMAND_BINDING = 7;
+const GLuint GPU_CULL_COUNTER_BINDING = 0;
+const int GPU_CULL_HIZ_UNIT = 3;
+// @!
+
+// std140 mirror of the GpuCull block in shaders/gpu_cull.comp, streamed once per frame
+struct GpuCullBlock {
+   glm::mat4 hiz_view_projection;
+   glm::vec4 frustum_planes[6];
+   glm::vec4 hiz_size;          // width, height, level count, w 1 while the pyramid holds a usable frame
+   glm::uvec4 counts;           // x objects, yzw unused
+};
+
+// culls a MeshBatch on the GPU, one compute invocation per object. survivors of the frustum and the
+// hierarchical z test append their command and draw object through an atomic counter, and the counter
+// itself is the draw count of the multi draw, so the CPU never looks at a single object
+// the pyramid is the previous frame's depth, an object coming out from behind something that moved
+// away shows up one frame late
+struct GpuCull {
+   MeshBatch *batch;
+   ShaderProgram *cull_program;
+   ShaderProgram *hiz_program;
+
+   // @@ GPU side, commands and draw objects are sized for every object being visible
+   GLuint sphere_buffer;
+   GLuint mesh_buffer;
+   GLuint command_buffer;
+   GLuint draw_object_buffer;
+   GLuint counter_buffer;
+   UniformInt hiz_from_depth;
+   // without GL 4.6 or GL_ARB_indirect_parameters the draw covers every slot, culled ones zeroed
+   bool indirect_count;
+   // @!
+
+   // @@ hierarchical z, depth is blitted out of the default framebuffer and reduced to farthest depth
+   bool occlusion;
+   GLuint depth_texture;
+   GLuint depth_framebuffer;
+   GLuint hiz_texture;
+   int width;
+   int height;
+   int levels;
+   bool hiz_valid;
+   glm::mat4 hiz_view_projection;
+   // @!
+
+   std::vector<MeshDrawRange> ranges;
+
+   uint64_t check_frames;
+   uint64_t check_failures;
+};
+
+
+// after mesh_batch_create, uploads the object bounds right away. width and height are the default
+// framebuffer's, occlusion false leaves the pyramid out and culls against the frustum only
+// indirect_count says glMultiDrawElementsIndirectCount is loaded
+void gpu_cull_init(GpuCull *cull, MeshBatch *batch, ShaderProgram *cull_program, ShaderProgram *hiz_program,
+		   int width, int height, bool occlusion, bool indirect_count);
+
+// program setup, again after every hot reload swap
+void gpu_cull_set_uniforms(GpuCull *cull, GLStateCache *state);
+
+// after stream_ring_begin_frame, replaces mesh_batch_cull
+void gpu_cull_dispatch(GpuCull *cull, GLStateCache *state, StreamRing *ring, const glm::mat4 &view_projection);
+// the batched program and its textures must already be bound, one multi draw with the GPU's count
+void gpu_cull_draw(GpuCull *cull, GLStateCache *state);
+// after the frame's last depth write, next frame's dispatch tests against it
+void gpu_cull_build_hiz(GpuCull *cull, GLStateCache *state, const glm::mat4 &view_projection);
+
+// blocking readback of the frame's visible count checked against mesh_batch_cull, which this
+// overwrites the batch's commands with. only meaningful without occlusion, objects within a hair
+// of a plane may land either way on the GPU
+bool gpu_cull_check(GpuCull *cull, const glm::mat4 &view_projection);
+
+void gpu_cull_print(GpuCull *cull);
+void gpu_cull_destroy(GpuCull *cull);
@@ -0,0 +1,110 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "instancing.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+
+void instance_field_generate(int count, glm::vec3 center, float spacing, uint32_t seed,
+			     std::vector<float> *instances) {
+   std::mt19937 random{seed};
+   std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+   int side = (int)ceilf(sqrtf((float)count));
+   float half_width = (side - 1) * spacing * 0.5f;
+
+   instances->resize((size_t)count * INSTANCE_FLOATS);
+   for(int i = 0; i < count; ++i) {
+      float *instance = &(*instances)[(size_t)i * INSTANCE_FLOATS];
+      instance[0] = center.x + (i % side) * spacing - half_width;
+      instance[1] = center.y;
+      instance[2] = center.z + (i / side) * spacing - half_width;
+      instance[3] = 0.5f + 0.25f * unit(random);
+
+      glm::vec3 axis(unit(random), unit(random), unit(random));
+      if(glm::length(axis) < 1e-3f) {
+	 axis = glm::vec3(0.0f, 1.0f, 0.0f);
+      }
+      glm::quat rotation = glm::angleAxis(3.14159265f * unit(random), glm::normalize(axis));
+      instance[4] = rotation.x;
+      instance[5] = rotation.y;
+      instance[6] = rotation.z;
+      instance[7] = rotation.w;
+   }
+}
+
+
+glm::mat4 instance_model_matrix(const float *instance) {
+   glm::quat rotation(instance[7], instance[4], instance[5], instance[6]);
+   glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(instance[0], instance[1], instance[2]));
+   model = model * glm::mat4_cast(glm::normalize(rotation));
+   return glm::scale(model, glm::vec3(instance[3]));
+}
+
+
+// @@ benchmark
+void instance_benchmark_init(InstanceBenchmark *benchmark, const std::vector<int> &counts) {
+   benchmark->steps.clear();
+   for(int count : counts) {
+      benchmark->steps.push_back({count, false});
+      benchmark->steps.push_back({count, true});
+   }
+   benchmark->step = 0;
+   benchmark->frame = 0;
+   benchmark->warmup_frames = 10;
+   benchmark->measured_frames = 60;
+   benchmark->cpu_seconds = 0.0;
+   benchmark->draw_calls = 0;
+   printf("instance benchmark: %d counts, %d frames each after %d to warm up\n", (int)counts.size(),
+	  benchmark->measured_frames, benchmark->warmup_frames);
+}
+
+
+InstanceBenchmarkStep instance_benchmark_current(const InstanceBenchmark *benchmark) {
+   if(benchmark->step >= (int)benchmark->steps.size()) {
+      return InstanceBenchmarkStep{0, true};
+   }
+   return benchmark->steps[benchmark->step];
+}
+
+
+bool instance_benchmark_frame(InstanceBenchmark *benchmark, double cpu_seconds, int draw_calls) {
+   if(benchmark->step >= (int)benchmark->steps.size()) {
+      return false;
+   }
+   benchmark->frame += 1;
+   if(benchmark->frame <= benchmark->warmup_frames) {
+      return true;
+   }
+   benchmark->cpu_seconds += cpu_seconds;
+   benchmark->draw_calls += draw_calls;
+   if(benchmark->frame < benchmark->warmup_frames + benchmark->measured_frames) {
+      return true;
+   }
+
+   const InstanceBenchmarkStep &step = benchmark->steps[benchmark->step];
+   printf("   %7d instances  %-9s  %7lld draws  %8.3f ms cpu per frame\n", step.count,
+	  step.instanced ? "instanced" : "per draw", benchmark->draw_calls / benchmark->measured_frames,
+	  benchmark->cpu_seconds * 1000.0 / benchmark->measured_frames);
+   benchmark->step += 1;
+   benchmark->frame = 0;
+   benchmark->cpu_seconds = 0.0;
+   benchmark->draw_calls = 0;
+   return benchmark->step < (int)benchmark->steps.size();
+}
+// @!
@@ -0,0 +1,55 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+// @@ instance fields, 8 floats per instance: position, uniform scale, rotation quaternion (x, y, z, w)
+// the layout InstanceLayout encodes, and that object.vert composes under INSTANCED
+const int INSTANCE_FLOATS = 8;
+
+// count instances on a square grid in the xz plane around center, spacing apart, with random spins
+void instance_field_generate(int count, glm::vec3 center, float spacing, uint32_t seed,
+			     std::vector<float> *instances);
+// the same transform the instanced shader builds, for drawing an instance on its own
+glm::mat4 instance_model_matrix(const float *instance);
+// @!
+
+
+// @@ benchmark, every count is drawn for a while with one draw per instance and then with one
+// instanced draw. cpu time is from the start of the frame up to the swap
+struct InstanceBenchmarkStep {
+   int count;
+   bool instanced;
+};
+
+struct InstanceBenchmark {
+   std::vector<InstanceBenchmarkStep> steps;
+   int step;
+   int frame;
+   int warmup_frames;
+   int measured_frames;
+   double cpu_seconds;
+   long long draw_calls;
+};
+
+void instance_benchmark_init(InstanceBenchmark *benchmark, const std::vector<int> &counts);
+InstanceBenchmarkStep instance_benchmark_current(const InstanceBenchmark *benchmark);
+// records one frame and prints a line whenever a step finishes, false once the last one has
+bool instance_benchmark_frame(InstanceBenchmark *benchmark, double cpu_seconds, int draw_calls);
+// @!
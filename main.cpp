@@ -18,19 +18,40 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
 #include <iostream>
 #include <fstream>
 #include <string>
 
+#include "camera_uniforms.h"
+#include "gl_resources.h"
+#include "gl_state.h"
+#include "gpu_cull.h"
+#include "instancing.h"
+#include "mesh.h"
+#include "mesh_arena.h"
+#include "mesh_batch.h"
+#include "mesh_import.h"
+#include "shader.h"
+#include "shader_watch.h"
+#include "stream_ring.h"
+#include "thread_pool.h"
+#include "texture_loader.h"
+#include "texture_cooker.h"
+#include "texture_array.h"
+#include "texture_budget.h"
+#include "texture_streaming.h"
+#include "vertex_layout.h"
+#include "virtual_texture.h"
+
 
 GLint WINDOW_WIDTH = 1280;
 GLint WINDOW_HEIGHT = 720;
 // const GLint WINDOW_WIDTH = 800;
 // const GLint WINDOW_HEIGHT = 600;
 
+// frames --cull-check compares before it quits
+const int CULL_CHECK_FRAMES = 240;
+
 
 struct InputData {
    bool w_key_press;
@@ -50,16 +71,57 @@ struct ConfigData {
    float move_speed;
 
    float texture_scale;
+   // video memory the textures may hold before the least recently used ones lose mip levels
+   size_t texture_budget_bytes;
+   // start material arrays at their small levels and stream finer ones in as objects get close
+   bool texture_streaming;
+   int texture_stream_start_size;
 
    float ambient_light_strength;
-};
 
+   // submit every program before asking the driver about any, false compiles them one at a time
+   bool batch_shader_compile;
+   // recompile programs whose files under shaders/ change while running
+   bool shader_hot_reload;
+
+   // tile file from --build-vt, empty keeps the toy box on the material array
+   std::string virtual_texture_path;
+
+   // .obj, .gltf or .glb shown next to the toy box, empty for none
+   std::string mesh_path;
+
+   // extra toy boxes on a grid below the scene, all in one instanced draw
+   int instanced_box_count;
+   // object.vert and light.vert fetch their vertices from shader storage, one VAO draws every layout
+   bool vertex_pulling;
+   // --instance-bench: times one draw per box against one instanced draw over a range of counts, then quits
+   bool instance_benchmark;
+
+   // fixed size shared vertex and index buffers every mesh is carved out of
+   size_t mesh_vertex_bytes;
+   size_t mesh_index_bytes;
+
+   // boxes and spheres scattered above the scene, culled and drawn with one multi draw
+   int batched_object_count;
+   // cull them in a compute pass instead of on the CPU, occlusion adds the previous frame's depth
+   bool gpu_culling;
+   bool occlusion_culling;
+   // --cull-check: turns the camera once with frustum only GPU culling, checks every frame's visible
+   // count against the CPU cull and exits 1 on any mismatch
+   bool cull_check;
+};
 
-void read_shader_source(std::string file_path, std::string &output_source);
-void compile_shader_program(std::string vert_path, std::string frag_path, GLuint *shader_program);
 
+int main(int argc, char **argv) {
+   // @@ headless tools
+   if(argc > 1 && std::string{argv[1]} == "--cook") {
+      return cook_command(argc, argv);
+   }
+   if(argc > 1 && std::string{argv[1]} == "--build-vt") {
+      return vt_build_command(argc, argv);
+   }
+   // @!
 
-int main() {
    printf("Program Begin!!!");
 
    
@@ -69,7 +131,37 @@ int main() {
    config_data.fov_degrees = 70.0f;
    config_data.move_speed = 0.6f;
    config_data.texture_scale = 1.0f;
+   config_data.texture_budget_bytes = 256 * 1024 * 1024;
+   config_data.texture_streaming = true;
+   config_data.texture_stream_start_size = 64;
    config_data.ambient_light_strength = 0.1f;
+   config_data.batch_shader_compile = true;
+   config_data.shader_hot_reload = true;
+   config_data.virtual_texture_path = "";
+   config_data.mesh_path = "";
+   config_data.instanced_box_count = 0;
+   config_data.instance_benchmark = false;
+   config_data.mesh_vertex_bytes = 64 * 1024 * 1024;
+   config_data.mesh_index_bytes = 32 * 1024 * 1024;
+   config_data.batched_object_count = 0;
+   config_data.vertex_pulling = false;
+   config_data.gpu_culling = true;
+   config_data.occlusion_culling = true;
+   config_data.cull_check = false;
+   for(int i = 1; i < argc; ++i) {
+      if(std::string{argv[i]} == "--instance-bench") {
+	 config_data.instance_benchmark = true;
+      }
+      if(std::string{argv[i]} == "--cull-check") {
+	 config_data.cull_check = true;
+      }
+   }
+   if(config_data.cull_check) {
+      // the CPU reference has no depth to test against
+      config_data.gpu_culling = true;
+      config_data.occlusion_culling = false;
+      config_data.batched_object_count = std::max(config_data.batched_object_count, 10000);
+   }
    // @!
 
 
@@ -77,9 +169,11 @@ int main() {
    GLFWwindow* window;
    {
       glfwInit();
-      glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-      glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+      // 4.5 for direct state access and immutable storage
+      glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+      glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
       glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+      glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
       GLFWmonitor* primary_monitor = glfwGetPrimaryMonitor();
       const GLFWvidmode* video_mode = glfwGetVideoMode(primary_monitor);
       WINDOW_WIDTH = video_mode->width;
@@ -98,117 +192,212 @@ int main() {
 
    
    // @@ GLAD loading procedures
+   bool parallel_shader_compile = false;
+   bool shader_draw_parameters = false;
+   bool indirect_count = false;
    {
       gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+
+      // gl_DrawIDARB for the batched draws, otherwise they carry the draw index in a vertex attribute
+      shader_draw_parameters = glfwExtensionSupported("GL_ARB_shader_draw_parameters");
+
+      // the GPU culled draw takes its count from a buffer, core in 4.6 and the same entry point as ARB
+      if(!GLAD_GL_VERSION_4_6 && glfwExtensionSupported("GL_ARB_indirect_parameters")) {
+	 glad_glMultiDrawElementsIndirectCount =
+	    (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)glfwGetProcAddress("glMultiDrawElementsIndirectCountARB");
+      }
+      indirect_count = glad_glMultiDrawElementsIndirectCount != NULL;
+
+      // glad only loads core entry points up to the context version, program binaries predate 4.1 as ARB
+      if(!GLAD_GL_VERSION_4_1 && glfwExtensionSupported("GL_ARB_get_program_binary")) {
+	 glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+	 glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+	 glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+      }
+
+      // not in the glad build at all, the ARB version has the same enums and only one entry point
+      typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+      MaxShaderCompilerThreadsProc max_shader_compiler_threads = NULL;
+      if(glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+	 max_shader_compiler_threads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+      } else if(glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+	 max_shader_compiler_threads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+      }
+      if(max_shader_compiler_threads) {
+	 // 0xFFFFFFFF lets the driver pick
+	 max_shader_compiler_threads(0xFFFFFFFF);
+	 parallel_shader_compile = true;
+      }
    }
    // @!
 
 
    // @@ GL setup
+   // the render loop goes through gl_state so calls that change nothing never reach the driver
+   GLStateCache gl_state;
    {
-      glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-      glEnable(GL_DEPTH_TEST);
+      gl_state_init(&gl_state);
+      gl_state_viewport(&gl_state, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+      gl_state_enable(&gl_state, GL_DEPTH_TEST, true);
+      // colour textures are sRGB formats so shaders work in linear, encode again on the way out
+      glEnable(GL_FRAMEBUFFER_SRGB);
    }
    // @!
 
 
    // @@ loading textures and creating them
-   GLuint texture_1_id;
-   GLuint texture_2_id;
+   // decoding runs on the pool, texture names are valid immediately and fill in as uploads land
+   // same sized images share one GL_TEXTURE_2D_ARRAY so a single bind serves every material
+   ThreadPool thread_pool;
+   TextureBudget texture_budget;
+   TextureLoader texture_loader;
+   TextureStreamer texture_streamer;
+   TexturePack material_pack;
+   TexturePackEntry container_texture;
+   TexturePackEntry face_texture;
+   GLuint material_array_id;
    {
-      stbi_set_flip_vertically_on_load(true);
-   
-      int texture_width = 0;
-      int texture_height = 0;
-      int no_channels = 0;
-      unsigned char *texture_data = stbi_load("container.jpg", &texture_width, &texture_height,
-					      &no_channels, 0);
-
-      if(!texture_data) {
-	 std::cerr << "Texture failed to  load" << '\n';
-	 exit(1);
-      }
-
-      glGenTextures(1, &texture_1_id);
-      glActiveTexture(GL_TEXTURE0);
-      glBindTexture(GL_TEXTURE_2D, texture_1_id);
+      thread_pool_init(&thread_pool, 0);
+      texture_budget_init(&texture_budget, config_data.texture_budget_bytes);
+      texture_loader_init(&texture_loader, &thread_pool, &texture_budget, "texture_cache", 4, 16 * 1024 * 1024);
 
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);	
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture_width, texture_height, 0, GL_RGB,
-		   GL_UNSIGNED_BYTE, texture_data);
-      glGenerateMipmap(GL_TEXTURE_2D);
-
-      stbi_image_free(texture_data);
-
-   
-      texture_data = stbi_load("awesomeface.png", &texture_width, &texture_height, &no_channels, 0);
-      if(!texture_data) {
-	 std::cerr << "Texture failed to  load" << '\n';
+      if(!texture_pack_plan({"container.jpg", "awesomeface.png"}, 2048, 8, &material_pack)) {
 	 exit(1);
       }
-
-      glGenTextures(1, &texture_2_id);
-      glActiveTexture(GL_TEXTURE1);
-      glBindTexture(GL_TEXTURE_2D, texture_2_id);
-
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture_width, texture_height, 0, GL_RGBA,
-		   GL_UNSIGNED_BYTE, texture_data);
-      glGenerateMipmap(GL_TEXTURE_2D);
-
-      stbi_image_free(texture_data);
+      texture_streamer_init(&texture_streamer, &texture_loader, &texture_budget,
+			    config_data.texture_stream_start_size, 120);
+      texture_pack_create(&material_pack, &texture_loader,
+			  config_data.texture_streaming ? &texture_streamer : NULL, true);
+
+      container_texture = material_pack.entries[0];
+      face_texture = material_pack.entries[1];
+      material_array_id = material_pack.arrays[container_texture.array_index].id;
+      if(face_texture.array_index != container_texture.array_index) {
+	 printf("@DEV_WARNING: material textures did not pack into one array.\n");
+      }
    }
    // @!
 
    
+   // @@ virtual texture, only pages the feedback pass asks for are ever resident
+   VirtualTexture virtual_texture;
+   bool virtual_texture_enabled = false;
+   if(!config_data.virtual_texture_path.empty()) {
+      virtual_texture_enabled = virtual_texture_open(&virtual_texture, config_data.virtual_texture_path,
+						     16, WINDOW_WIDTH, WINDOW_HEIGHT, 8);
+   }
+   if(virtual_texture_enabled) {
+      // fixed size caches, they count against the budget but already manage their own residency
+      texture_budget_track(&texture_budget, virtual_texture.physical_texture, GL_TEXTURE_2D,
+			   "virtual texture cache", false);
+      texture_budget_track(&texture_budget, virtual_texture.indirection_texture, GL_TEXTURE_2D,
+			   "virtual texture indirection", false);
+   }
+   // @!
+
+
    // @@ compiling shaders
-   GLuint toy_box_shader_program;
-   GLuint light_shader_program;
-   GLint toy_box_shader_MVP_id;
-   GLint light_shader_MVP_id;
+   ShaderCache shader_cache;
+   CameraUniforms camera_uniforms;
+   // owned by the shader cache, one per permutation
+   ShaderProgram *toy_box_shader = NULL;
+   ShaderProgram *light_shader = NULL;
+   ShaderProgram *vt_shader = NULL;
+   ShaderProgram *vt_feedback_shader = NULL;
+   ShaderProgram *instanced_box_shader = NULL;
+   ShaderProgram *batched_shader = NULL;
+   ShaderProgram *gpu_cull_shader = NULL;
+   ShaderProgram *hiz_shader = NULL;
+   UniformMat4 toy_box_model_uniform;
+   UniformMat4 light_model_uniform;
+   UniformMat4 vt_model_uniform = {-1};
+   UniformMat4 vt_feedback_model_uniform = {-1};
+   int max_box_instances = config_data.instance_benchmark ? 100000 : config_data.instanced_box_count;
    {
-      // @@ toy box shader
+      shader_cache_init(&shader_cache, "shader_cache", config_data.batch_shader_compile, parallel_shader_compile);
+      camera_uniforms_init(&camera_uniforms);
+
+      // @@ submit everything first, the driver can work on all of it while the rest is queued
+      // every object.vert and light.vert permutation gets its vertices the same way
+      ShaderDefines vertex_defines;
+      if(config_data.vertex_pulling) {
+	 vertex_defines.push_back({"VERTEX_PULLING", ""});
+      }
+      auto with_vertex_defines = [&vertex_defines](ShaderDefines defines) {
+	 defines.insert(defines.end(), vertex_defines.begin(), vertex_defines.end());
+	 return defines;
+      };
+
       std::string toy_box_vert_path{"shaders/object.vert"};
       std::string toy_box_frag_path{"shaders/object.frag"};
-      compile_shader_program(toy_box_vert_path, toy_box_frag_path, &toy_box_shader_program);
-      
-      glUseProgram(toy_box_shader_program);
-      toy_box_shader_MVP_id = glGetUniformLocation(toy_box_shader_program, "MVP");
-      glUniform1f(glGetUniformLocation(toy_box_shader_program, "ambient_light_strength"),
-		  config_data.ambient_light_strength);
+      toy_box_shader = shader_program_submit(&shader_cache, toy_box_vert_path, toy_box_frag_path, vertex_defines);
+      light_shader = shader_program_submit(&shader_cache, "shaders/light.vert", "shaders/light.frag", vertex_defines);
+      if(virtual_texture_enabled) {
+	 vt_shader = shader_program_submit(&shader_cache, toy_box_vert_path, toy_box_frag_path,
+					   with_vertex_defines({{"VIRTUAL_TEXTURE", ""}}));
+	 vt_feedback_shader = shader_program_submit(&shader_cache, toy_box_vert_path, "shaders/vt_feedback.frag",
+						    vertex_defines);
+      }
+      if(max_box_instances > 0) {
+	 instanced_box_shader = shader_program_submit(&shader_cache, toy_box_vert_path, toy_box_frag_path,
+						      with_vertex_defines({{"INSTANCED", ""}}));
+      }
+      if(config_data.batched_object_count > 0) {
+	 ShaderDefines batched_defines;
+	 if(!shader_draw_parameters) {
+	    batched_defines.push_back({"DRAW_ID_ATTRIBUTE", ""});
+	 }
+	 batched_shader = shader_program_submit(&shader_cache, "shaders/batched.vert", toy_box_frag_path,
+						batched_defines);
+	 if(config_data.gpu_culling) {
+	    gpu_cull_shader = shader_compute_submit(&shader_cache, "shaders/gpu_cull.comp");
+	    hiz_shader = shader_compute_submit(&shader_cache, "shaders/hiz.comp");
+	 }
+      }
+      shader_cache_finish(&shader_cache);
       // @!
 
+      shader_cache_print(&shader_cache);
+   }
+   // @!
 
-      // @@ light shader
-      std::string light_vert_path{"shaders/light.vert"};
-      std::string light_frag_path{"shaders/light.frag"};
-      compile_shader_program(light_vert_path, light_frag_path, &light_shader_program);
+   
+   // @@ other buffers are made on the resource thread, their VAOs on this one once the fence passes
+   GLResourceThread gl_resources;
+   gl_resource_thread_start(&gl_resources, window);
+   // @!
 
-      glUseProgram(light_shader_program);
-      light_shader_MVP_id = glGetUniformLocation(light_shader_program, "MVP");
-      // @!
+
+   // @@ mesh data, every mesh is a range of two shared buffers and each vertex layout has one VAO
+   // over them, so meshes of a layout only differ in their draw's first index and base vertex
+   // pulling shaders decode the layout themselves, then one VAO without attributes serves all of them
+   MeshArena mesh_arena;
+   mesh_arena_init(&mesh_arena, config_data.mesh_vertex_bytes, config_data.mesh_index_bytes);
+   GLuint object_VAO;
+   GLuint light_VAO;
+   if(config_data.vertex_pulling) {
+      object_VAO = mesh_arena_create_pull_vertex_array(&mesh_arena);
+      light_VAO = object_VAO;
+   } else {
+      object_VAO = ObjectVertexLayout::create_vertex_array(mesh_arena.vertices.buffer, mesh_arena.indices.buffer);
+      light_VAO = LightVertexLayout::create_vertex_array(mesh_arena.vertices.buffer, mesh_arena.indices.buffer);
    }
    // @!
 
-   
+
+   // @@ per frame data streams through a persistently mapped ring, sized for the largest frame
+   StreamRing stream_ring;
+   stream_ring_init(&stream_ring, 64 * 1024 + (GLsizeiptr)config_data.batched_object_count *
+		    (sizeof(DrawElementsIndirectCommand) + sizeof(GLuint)));
+   // @!
+
+
    // @@ creating light source
-   GLuint light_VAO;
+   MeshAllocation light_allocation = {};
    glm::mat4 light_model_matrix;
-   glm::mat4 light_MVP;
+   glm::mat4 light_dequantize;
    glm::vec3 light_color;
    {
-      glGenVertexArrays(1, &light_VAO);
-      glBindVertexArray(light_VAO);
-   
-      GLuint light_VBO;
       {
 	 float vertices[] = {
 	    -0.5f, -0.5f, -0.5f,
@@ -254,40 +443,34 @@ int main() {
 	    -0.5f,  0.5f, -0.5f,
 	 };
 
-	 glGenBuffers(1, &light_VBO);
-	 glBindBuffer(GL_ARRAY_BUFFER, light_VBO);
-	 glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	 Mesh mesh;
+	 mesh_build(vertices, 36, 3, &mesh);
+	 mesh_print_stats("light", &mesh);
+	 VertexQuantization quantization = vertex_quantization_from_mesh(&mesh);
+	 light_dequantize = vertex_dequantize_matrix(quantization);
+	 std::vector<LightVertexLayout::Vertex> packed;
+	 LightVertexLayout::encode(&mesh, quantization, &packed);
+	 mesh_arena_add(&mesh_arena, packed.data(), (uint32_t)packed.size(), LightVertexLayout::stride,
+			mesh.indices.data(), (GLsizei)mesh.indices.size(), &light_allocation);
       }
-
-      // @@ vertex attributes
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
-      glEnableVertexAttribArray(0);
-      // @!
       
       // @@ model matrix setup
       light_model_matrix = glm::mat4(1.0f);
       light_model_matrix = glm::translate(light_model_matrix, glm::vec3(4.0f, 1.0f, -2.0f));
       // @!
 
-      // @@ shader stuff
       light_color = glm::vec3(1.0f, 1.0f, 1.0f);
-      glUseProgram(light_shader_program);
-      glUniform3f(glGetUniformLocation(light_shader_program, "light_color"),
-		  light_color.r, light_color.g, light_color.b);
-      // @!
    }
    // @!
 
 
    // @@ loading and creating toy box
-   GLuint toy_box_VAO;
+   MeshAllocation toy_box_allocation = {};
    glm::mat4 toy_box_model_matrix;
-   glm::mat4 toy_box_MVP;
+   glm::mat4 toy_box_dequantize;
+   // kept for the batch, which packs it into its own shared buffers
+   Mesh toy_box_mesh;
    {
-      glGenVertexArrays(1, &toy_box_VAO);
-      glBindVertexArray(toy_box_VAO);
-   
-      GLuint toy_box_VBO;
       {
 	 float vertices[] = {
 	    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, 
@@ -334,39 +517,177 @@ int main() {
 	 };
 	 
 
-	 glGenBuffers(1, &toy_box_VBO);
-	 glBindBuffer(GL_ARRAY_BUFFER, toy_box_VBO);
-	 glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	 // the soup repeats every corner once per triangle that uses it, welded each is shaded once
+	 mesh_build(vertices, 36, 8, &toy_box_mesh);
+	 mesh_print_stats("toy box", &toy_box_mesh);
+	 VertexQuantization quantization = vertex_quantization_from_mesh(&toy_box_mesh);
+	 toy_box_dequantize = vertex_dequantize_matrix(quantization);
+	 std::vector<ObjectVertexLayout::Vertex> packed;
+	 ObjectVertexLayout::encode(&toy_box_mesh, quantization, &packed);
+	 mesh_arena_add(&mesh_arena, packed.data(), (uint32_t)packed.size(), ObjectVertexLayout::stride,
+			toy_box_mesh.indices.data(), (GLsizei)toy_box_mesh.indices.size(), &toy_box_allocation);
       }
 
-      // @@ vertex attributes
-      // positions
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), 0);
-      glEnableVertexAttribArray(0);
-
-      // normals
-      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat),
-			    (void *)(3 * sizeof(GLfloat)));
-      glEnableVertexAttribArray(1);
-
-      // tex coords
-      glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat),
-			    (void *)(6 * sizeof(GLfloat)));
-      glEnableVertexAttribArray(2);
-      // @!
-
       // @@ model matrix setup
       toy_box_model_matrix = glm::mat4(1.0f);
       // @!
+   }
+   // @!
 
-      // @@ shader stuff
-      glUseProgram(toy_box_shader_program);
-      glUniform1i(glGetUniformLocation(toy_box_shader_program, "container_texture"), 0);
-      glUniform1i(glGetUniformLocation(toy_box_shader_program, "face_texture"), 1);
-      glUniform3f(glGetUniformLocation(toy_box_shader_program, "light_color"),
-		  light_color.r, light_color.g, light_color.b);
-      // @!
+
+   // @@ box field, the toy box mesh once more with a per instance stream on binding 1
+   // the per draw path in the benchmark walks the same instances with a model matrix each
+   GLuint instanced_box_VAO = 0;
+   GLuint box_instance_buffer = 0;
+   std::vector<glm::mat4> box_model_matrices;
+   InstanceBenchmark instance_benchmark;
+   if(max_box_instances > 0) {
+      std::vector<float> instances;
+      instance_field_generate(max_box_instances, glm::vec3(0.0f, -3.0f, 0.0f), 1.5f, 1, &instances);
+      std::vector<InstanceLayout::Vertex> packed;
+      InstanceLayout::encode(instances.data(), max_box_instances, VertexQuantization{}, &packed);
+      box_model_matrices.resize(max_box_instances);
+      for(int i = 0; i < max_box_instances; ++i) {
+	 box_model_matrices[i] = instance_model_matrix(&instances[(size_t)i * INSTANCE_FLOATS]);
+      }
+
+      gl_resource_thread_submit(&gl_resources, [&box_instance_buffer, packed]() {
+	 box_instance_buffer = gl_create_buffer(packed.size() * InstanceLayout::stride, packed.data(), 0);
+      }, [&instanced_box_VAO, &box_instance_buffer, &mesh_arena, &config_data, object_VAO]() {
+	 if(config_data.vertex_pulling) {
+	    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, MESH_PULL_INSTANCE_BINDING, 1, &box_instance_buffer);
+	    instanced_box_VAO = object_VAO;
+	 } else {
+	    instanced_box_VAO = ObjectVertexLayout::create_vertex_array(mesh_arena.vertices.buffer,
+									mesh_arena.indices.buffer);
+	    InstanceLayout::add_to_vertex_array(instanced_box_VAO, 1, box_instance_buffer, 1);
+	 }
+      });
+      if(config_data.instance_benchmark) {
+	 instance_benchmark_init(&instance_benchmark, {100, 1000, 10000, 100000});
+      }
+   }
+   // @!
+
+
+   // @@ batched objects, every mesh in one set of buffers and every visible object in one multi draw
+   MeshBatch mesh_batch;
+   mesh_batch_init(&mesh_batch, &mesh_arena);
+   if(config_data.batched_object_count > 0) {
+      std::vector<float> sphere_soup;
+      mesh_generate_sphere(24, 12, &sphere_soup);
+      Mesh sphere_mesh;
+      mesh_build(sphere_soup.data(), (int)sphere_soup.size() / 8, 8, &sphere_mesh);
+      mesh_print_stats("sphere", &sphere_mesh);
+
+      int batch_meshes[2] = {mesh_batch_add_mesh(&mesh_batch, &toy_box_mesh),
+			     mesh_batch_add_mesh(&mesh_batch, &sphere_mesh)};
+      std::vector<float> instances;
+      instance_field_generate(config_data.batched_object_count, glm::vec3(0.0f, 4.0f, 0.0f), 1.5f, 2, &instances);
+      for(int i = 0; i < config_data.batched_object_count; ++i) {
+	 mesh_batch_add_object(&mesh_batch, batch_meshes[i % 2],
+			       instance_model_matrix(&instances[(size_t)i * INSTANCE_FLOATS]));
+      }
+      mesh_batch_create(&mesh_batch, &gl_resources, !shader_draw_parameters);
    }
+   GpuCull gpu_cull;
+   bool gpu_culling = config_data.gpu_culling && config_data.batched_object_count > 0;
+   if(gpu_culling) {
+      gpu_cull_init(&gpu_cull, &mesh_batch, gpu_cull_shader, hiz_shader, WINDOW_WIDTH, WINDOW_HEIGHT,
+		    config_data.occlusion_culling, indirect_count);
+   }
+   // @!
+
+
+   // @@ imported mesh, a warm start maps the cache file and hands it straight to buffer creation
+   MeshAllocation imported_allocation = {};
+   glm::mat4 imported_model_matrix;
+   if(!config_data.mesh_path.empty()) {
+      MeshFile mesh_file;
+      double load_start = glfwGetTime();
+      if(mesh_cache_load(&thread_pool, "mesh_cache", config_data.mesh_path, &mesh_file)) {
+	 printf("mesh %s: %u vertices, %zu triangles, %.2f ms %s\n", config_data.mesh_path.c_str(),
+		mesh_file.vertex_count, mesh_file.index_count / 3, (glfwGetTime() - load_start) * 1000.0,
+		mesh_file.imported ? "to import" : "from the cache");
+
+	 // whatever units the file uses, fit it into a unit box beside the toy box
+	 const VertexQuantization &quantization = mesh_file.quantization;
+	 float largest_extent = std::max(quantization.position_extent.x,
+					 std::max(quantization.position_extent.y, quantization.position_extent.z));
+	 imported_model_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(-2.0f, 0.0f, 0.0f));
+	 imported_model_matrix = glm::scale(imported_model_matrix, glm::vec3(0.5f / largest_extent));
+	 imported_model_matrix = glm::translate(imported_model_matrix, -quantization.position_center);
+	 imported_model_matrix = imported_model_matrix * vertex_dequantize_matrix(quantization);
+
+	 // straight from the mapping into the arena, which keeps a copy
+	 mesh_arena_add(&mesh_arena, mesh_file.vertex_data, mesh_file.vertex_count, ObjectVertexLayout::stride,
+			mesh_file.index_data, (GLsizei)mesh_file.index_count, &imported_allocation);
+	 mesh_file_close(&mesh_file);
+      }
+   }
+   // @!
+
+
+   // @@ uniform setup, a hot reloaded program comes back with fresh locations and default values
+   auto setup_shader_uniforms = [&]() {
+      gl_state_use_program(&gl_state, toy_box_shader->id);
+      toy_box_model_uniform = shader_uniform_mat4(toy_box_shader, "model");
+      set_uniform(shader_uniform_float(toy_box_shader, "ambient_light_strength"),
+		  config_data.ambient_light_strength);
+      set_uniform(shader_uniform_vec3(toy_box_shader, "light_color"), light_color);
+      set_uniform(shader_uniform_sampler(toy_box_shader, "material_textures"), 0);
+      set_uniform(shader_uniform_int(toy_box_shader, "container_layer"), container_texture.layer);
+      set_uniform(shader_uniform_vec4(toy_box_shader, "container_uv_rect"), container_texture.uv_rect);
+      set_uniform(shader_uniform_int(toy_box_shader, "face_layer"), face_texture.layer);
+      set_uniform(shader_uniform_vec4(toy_box_shader, "face_uv_rect"), face_texture.uv_rect);
+
+      // the programs sharing object.frag, their models come from elsewhere
+      for(ShaderProgram *program : {instanced_box_shader, batched_shader}) {
+	 if(!program) {
+	    continue;
+	 }
+	 gl_state_use_program(&gl_state, program->id);
+	 set_uniform(shader_uniform_float(program, "ambient_light_strength"), config_data.ambient_light_strength);
+	 set_uniform(shader_uniform_vec3(program, "light_color"), light_color);
+	 set_uniform(shader_uniform_sampler(program, "material_textures"), 0);
+	 set_uniform(shader_uniform_int(program, "container_layer"), container_texture.layer);
+	 set_uniform(shader_uniform_vec4(program, "container_uv_rect"), container_texture.uv_rect);
+	 set_uniform(shader_uniform_int(program, "face_layer"), face_texture.layer);
+	 set_uniform(shader_uniform_vec4(program, "face_uv_rect"), face_texture.uv_rect);
+      }
+      if(instanced_box_shader) {
+	 gl_state_use_program(&gl_state, instanced_box_shader->id);
+	 set_uniform(shader_uniform_mat4(instanced_box_shader, "model"), toy_box_dequantize);
+      }
+
+      if(gpu_culling) {
+	 gpu_cull_set_uniforms(&gpu_cull, &gl_state);
+      }
+
+      gl_state_use_program(&gl_state, light_shader->id);
+      light_model_uniform = shader_uniform_mat4(light_shader, "model");
+      set_uniform(shader_uniform_vec3(light_shader, "light_color"), light_color);
+
+      if(virtual_texture_enabled) {
+	 gl_state_use_program(&gl_state, vt_shader->id);
+	 vt_model_uniform = shader_uniform_mat4(vt_shader, "model");
+	 set_uniform(shader_uniform_float(vt_shader, "ambient_light_strength"),
+		     config_data.ambient_light_strength);
+	 set_uniform(shader_uniform_vec3(vt_shader, "light_color"), light_color);
+	 virtual_texture_set_uniforms(&virtual_texture, vt_shader, 1, 2);
+
+	 gl_state_use_program(&gl_state, vt_feedback_shader->id);
+	 vt_feedback_model_uniform = shader_uniform_mat4(vt_feedback_shader, "model");
+	 virtual_texture_set_uniforms(&virtual_texture, vt_feedback_shader, 1, 2);
+      }
+   };
+   setup_shader_uniforms();
+   // the texture setup above talked to GL directly
+   gl_state_invalidate(&gl_state);
+
+   ShaderWatcher shader_watcher;
+   bool shader_watcher_running = config_data.shader_hot_reload && shader_watcher_start(&shader_watcher, "shaders");
+   std::vector<std::string> changed_shader_files;
    // @!
 
    
@@ -404,16 +725,32 @@ int main() {
    while(!glfwWindowShouldClose(window))
    {
       // @@ delta time calculations, must be done at BEGINNING OF FRAME!
+      double frame_cpu_start = glfwGetTime();
       float current_frame_time = glfwGetTime();
       delta_time = current_frame_time - last_frame_time;
       last_frame_time = current_frame_time;
       // @!
 
+
+      // @@ shader hot reload, programs only ever change here between two frames
+      if(shader_watcher_running) {
+	 shader_watcher_take(&shader_watcher, &changed_shader_files);
+	 if(!changed_shader_files.empty()) {
+	    shader_cache_reload(&shader_cache, changed_shader_files);
+	 }
+	 if(shader_cache_swap_reloads(&shader_cache) > 0) {
+	    // the old program names are gone and may come back as new ones
+	    gl_state_invalidate(&gl_state);
+	    setup_shader_uniforms();
+	 }
+      }
+      // @!
+
       
       // @@ input
       {
 	 if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-	    exit(0);
+	    glfwSetWindowShouldClose(window, GLFW_TRUE);
 	 }
 	 
 	 input_data.w_key_press = false;
@@ -448,6 +785,11 @@ int main() {
       pitch += config_data.mouse_sensitivity * (input_data.mouse_ypos - input_data.last_mouse_ypos);
       if(pitch > 1.5533) { pitch = 1.5533; }
       else if(pitch < -1.5533) { pitch = -1.5533; }
+      if(config_data.cull_check) {
+	 // one full turn looking up at the batched objects, so they cross every side of the frustum
+	 yaw = 6.2832f * (float)gpu_cull.check_frames / CULL_CHECK_FRAMES;
+	 pitch = -0.3f;
+      }
 
       input_data.last_mouse_xpos = input_data.mouse_xpos;
       input_data.last_mouse_ypos = input_data.mouse_ypos;
@@ -479,6 +821,16 @@ int main() {
       // @!
 
       
+      // @@ streaming
+      gl_resource_thread_update(&gl_resources);
+      texture_loader_update(&texture_loader);
+      texture_streamer_update(&texture_streamer);
+      if(virtual_texture_enabled) {
+	 virtual_texture_update(&virtual_texture);
+      }
+      // @!
+
+      
       // @@ rendering
       glm::mat4 view;
       view = glm::lookAt(camera_pos,
@@ -490,106 +842,165 @@ int main() {
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
       
-      glActiveTexture(GL_TEXTURE0);
-      glBindTexture(GL_TEXTURE_2D, texture_1_id);
-      glActiveTexture(GL_TEXTURE1);
-      glBindTexture(GL_TEXTURE_2D, texture_2_id);
+      // the only camera upload of the frame, every program reads it from the shared block
+      stream_ring_begin_frame(&stream_ring);
+      camera_uniforms_update(&camera_uniforms, &stream_ring, view, projection, camera_pos, current_frame_time,
+			     delta_time);
+
+      if(toy_box_allocation.index_count) {
+	 if(virtual_texture_enabled) {
+	    // feedback first at low resolution, its readback is consumed a few frames later
+	    virtual_texture_begin_feedback(&virtual_texture, &gl_state);
+	    gl_state_use_program(&gl_state, vt_feedback_shader->id);
+	    set_uniform(vt_feedback_model_uniform, toy_box_model_matrix * toy_box_dequantize);
+	    gl_state_bind_vertex_array(&gl_state, object_VAO);
+	    mesh_arena_draw(&mesh_arena, toy_box_allocation);
+	    virtual_texture_end_feedback(&virtual_texture, &gl_state, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	    virtual_texture_bind(&virtual_texture, &gl_state, 1, 2);
+	    gl_state_use_program(&gl_state, vt_shader->id);
+	    set_uniform(vt_model_uniform, toy_box_model_matrix * toy_box_dequantize);
+	 } else {
+	    gl_state_bind_texture(&gl_state, 0, GL_TEXTURE_2D_ARRAY, material_array_id);
+	    texture_budget_touch(&texture_budget, material_array_id);
+	    const PackedTextureArray &material_array = material_pack.arrays[container_texture.array_index];
+	    texture_streamer_want(&texture_streamer, material_array_id,
+				  texture_streamer_estimate_lod(projection, view, toy_box_model_matrix, 0.87f, 1.0f,
+								std::max(material_array.width, material_array.height),
+								WINDOW_HEIGHT));
+	    gl_state_use_program(&gl_state, toy_box_shader->id);
+	    set_uniform(toy_box_model_uniform, toy_box_model_matrix * toy_box_dequantize);
+	 }
+	 gl_state_bind_vertex_array(&gl_state, object_VAO);
+	 mesh_arena_draw(&mesh_arena, toy_box_allocation);
+      }
+
+      // @@ box field, one instanced draw, or for the benchmark one draw per box to compare against
+      int box_draw_calls = 0;
+      if(instanced_box_VAO) {
+	 InstanceBenchmarkStep boxes = {max_box_instances, true};
+	 if(config_data.instance_benchmark) {
+	    boxes = instance_benchmark_current(&instance_benchmark);
+	 }
+	 gl_state_bind_texture(&gl_state, 0, GL_TEXTURE_2D_ARRAY, material_array_id);
+	 texture_budget_touch(&texture_budget, material_array_id);
+	 if(boxes.instanced) {
+	    gl_state_use_program(&gl_state, instanced_box_shader->id);
+	    gl_state_bind_vertex_array(&gl_state, instanced_box_VAO);
+	    mesh_arena_draw(&mesh_arena, toy_box_allocation, boxes.count);
+	    box_draw_calls = 1;
+	 } else {
+	    gl_state_use_program(&gl_state, toy_box_shader->id);
+	    gl_state_bind_vertex_array(&gl_state, object_VAO);
+	    for(int i = 0; i < boxes.count; ++i) {
+	       set_uniform(toy_box_model_uniform, box_model_matrices[i] * toy_box_dequantize);
+	       mesh_arena_draw(&mesh_arena, toy_box_allocation);
+	    }
+	    box_draw_calls = boxes.count;
+	 }
+      }
+      // @!
+
+
+      // @@ batched objects, the whole visible set in one call
+      if(mesh_batch.vertex_array) {
+	 if(gpu_culling) {
+	    gpu_cull_dispatch(&gpu_cull, &gl_state, &stream_ring, projection * view);
+	 } else {
+	    mesh_batch_cull(&mesh_batch, projection * view);
+	 }
+	 gl_state_bind_texture(&gl_state, 0, GL_TEXTURE_2D_ARRAY, material_array_id);
+	 texture_budget_touch(&texture_budget, material_array_id);
+	 gl_state_use_program(&gl_state, batched_shader->id);
+	 if(gpu_culling) {
+	    gpu_cull_draw(&gpu_cull, &gl_state);
+	 } else {
+	    mesh_batch_draw(&mesh_batch, &gl_state, &stream_ring);
+	 }
+      }
+      // @!
+
       
-      glUseProgram(toy_box_shader_program);
-      toy_box_MVP = projection * view * toy_box_model_matrix;
-      glUniformMatrix4fv(toy_box_shader_MVP_id, 1, GL_FALSE, glm::value_ptr(toy_box_MVP));
-      glBindVertexArray(toy_box_VAO);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+      if(imported_allocation.index_count) {
+	 gl_state_bind_texture(&gl_state, 0, GL_TEXTURE_2D_ARRAY, material_array_id);
+	 texture_budget_touch(&texture_budget, material_array_id);
+	 gl_state_use_program(&gl_state, toy_box_shader->id);
+	 set_uniform(toy_box_model_uniform, imported_model_matrix);
+	 gl_state_bind_vertex_array(&gl_state, object_VAO);
+	 mesh_arena_draw(&mesh_arena, imported_allocation);
+      }
 
       
-      glUseProgram(light_shader_program);
-      light_MVP = projection * view * light_model_matrix;
-      glUniformMatrix4fv(light_shader_MVP_id, 1, GL_FALSE, glm::value_ptr(light_MVP));
-      glBindVertexArray(light_VAO);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+      if(light_allocation.index_count) {
+	 gl_state_use_program(&gl_state, light_shader->id);
+	 set_uniform(light_model_uniform, light_model_matrix * light_dequantize);
+	 gl_state_bind_vertex_array(&gl_state, light_VAO);
+	 mesh_arena_draw(&mesh_arena, light_allocation);
+      }
+
+      // every depth write of the frame is in, next frame's culling tests against it
+      if(gpu_culling && mesh_batch.vertex_array) {
+	 gpu_cull_build_hiz(&gpu_cull, &gl_state, projection * view);
+	 if(config_data.cull_check) {
+	    gpu_cull_check(&gpu_cull, projection * view);
+	    if(gpu_cull.check_frames >= CULL_CHECK_FRAMES) {
+	       glfwSetWindowShouldClose(window, GLFW_TRUE);
+	    }
+	 }
+      }
       // @!
       
 
-      // check and call events and swap the buffers
-      glfwPollEvents();
-      glfwSwapBuffers(window);
-   }
-   
+      stream_ring_end_frame(&stream_ring);
+      texture_budget_end_frame(&texture_budget);
 
-   return 0;
-}
 
+      // only count frames once the box field is up, the first few wait on the resource thread
+      if(config_data.instance_benchmark && instanced_box_VAO &&
+	 !instance_benchmark_frame(&instance_benchmark, glfwGetTime() - frame_cpu_start, box_draw_calls)) {
+	 glfwSetWindowShouldClose(window, GLFW_TRUE);
+      }
 
-// @@ read source of shader and store it in output_source
-void read_shader_source(std::string file_path, std::string &output_source) {
-   std::ifstream inf{file_path};
 
-   if(!inf) {
-      std::cerr << "ERROR" << '\n';
+      // check and call events and swap the buffers
+      glfwPollEvents();
+      glfwSwapBuffers(window);
    }
+   
 
-   std::string file_source{""};
-   while(inf) {
-      std::string temp_str;
-      std::getline(inf, temp_str);
-      file_source += temp_str += "\n";
+   // @@ shutdown
+   if(shader_watcher_running) {
+      shader_watcher_stop(&shader_watcher);
    }
-
-   output_source = file_source;
-}
-
-
-void compile_shader_program(std::string vert_path, std::string frag_path, GLuint *shader_program) {
-   int success;
-   char info_log[2048];
-   
-   std::string vert_source{};
-   std::string frag_source{};
-
-   read_shader_source(vert_path, vert_source);
-   read_shader_source(frag_path, frag_source);
-
-   GLuint vert_shader;
-   GLuint frag_shader;
-   vert_shader = glCreateShader(GL_VERTEX_SHADER);
-   frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-
-   const GLchar *char_vert_source = vert_source.c_str();
-   glShaderSource(vert_shader, 1, &char_vert_source, NULL);
-   glCompileShader(vert_shader);
-   glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &success);
-   if(!success) {
-      glGetShaderInfoLog(vert_shader, 2048, NULL, info_log);
-      std::cerr << "ERROR: vert shader compiling failed." << '\n';
-      std::cout << info_log << '\n';
-      exit(1);
+   gl_state_print(&gl_state, texture_budget.frame);
+   texture_budget_print(&texture_budget);
+   texture_streamer_print(&texture_streamer);
+   stream_ring_print(&stream_ring);
+   mesh_arena_print(&mesh_arena);
+   int exit_code = 0;
+   if(gpu_culling) {
+      gpu_cull_print(&gpu_cull);
+      if(config_data.cull_check && (gpu_cull.check_frames < CULL_CHECK_FRAMES || gpu_cull.check_failures > 0)) {
+	 exit_code = 1;
+      }
+      gpu_cull_destroy(&gpu_cull);
    }
-
-   const GLchar *char_frag_source = frag_source.c_str();
-   glShaderSource(frag_shader, 1, &char_frag_source, NULL);
-   glCompileShader(frag_shader);
-   glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &success);
-   if(!success) {
-      glGetShaderInfoLog(frag_shader, 2048, NULL, info_log);
-      std::cerr << "ERROR: frag shader compiling failed." << '\n';
-      std::cout << info_log << '\n';
-      exit(1);
+   if(config_data.batched_object_count > 0) {
+      mesh_batch_print(&mesh_batch);
+      mesh_batch_destroy(&mesh_batch);
    }
-   
-   *shader_program = glCreateProgram();
-   glAttachShader(*shader_program, vert_shader);
-   glAttachShader(*shader_program, frag_shader);
-   glLinkProgram(*shader_program);
-
-   glGetProgramiv(*shader_program, GL_LINK_STATUS, &success);
-   if(!success) {
-      glGetProgramInfoLog(*shader_program, 2048, NULL, info_log);
-      std::cerr << "ERROR: shader link failed." << '\n';
-      std::cout << info_log << '\n';
-      exit(1);
+   thread_pool_shutdown(&thread_pool);
+   texture_loader_shutdown(&texture_loader);
+   texture_pack_destroy(&material_pack);
+   if(virtual_texture_enabled) {
+      virtual_texture_close(&virtual_texture);
    }
+   stream_ring_destroy(&stream_ring);
+   mesh_arena_destroy(&mesh_arena);
+   gl_resource_thread_stop(&gl_resources);
+   glfwTerminate();
+   // @!
    
-   glDeleteShader(vert_shader);
-   glDeleteShader(frag_shader);
 
+   return exit_code;
 }
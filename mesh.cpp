@@ -0,0 +1,422 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "mesh.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+// @@ welding
+static uint64_t hash_vertex(const float *vertex, int vertex_floats) {
+   uint64_t hash = 14695981039346656037ull;
+   for(int i = 0; i < vertex_floats; ++i) {
+      // -0 and 0 compare equal, so they have to hash equal too
+      float value = vertex[i] == 0.0f ? 0.0f : vertex[i];
+      uint32_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      hash = (hash ^ bits) * 1099511628211ull;
+   }
+   return hash;
+}
+
+static bool vertices_equal(const float *a, const float *b, int vertex_floats) {
+   for(int i = 0; i < vertex_floats; ++i) {
+      if(a[i] != b[i]) {
+	 return false;
+      }
+   }
+   return true;
+}
+
+// open addressing over the unique vertices found so far, degenerate triangles welding creates are dropped
+static void weld_vertices(const float *soup, int soup_vertex_count, Mesh *mesh) {
+   int vertex_floats = mesh->vertex_floats;
+   size_t table_size = 1;
+   while(table_size < (size_t)soup_vertex_count * 2) {
+      table_size *= 2;
+   }
+   std::vector<uint32_t> table(table_size, UINT32_MAX);
+
+   std::vector<uint32_t> remap(soup_vertex_count);
+   for(int i = 0; i < soup_vertex_count; ++i) {
+      const float *vertex = soup + (size_t)i * vertex_floats;
+      size_t slot = hash_vertex(vertex, vertex_floats) & (table_size - 1);
+      while(table[slot] != UINT32_MAX &&
+	    !vertices_equal(&mesh->vertices[(size_t)table[slot] * vertex_floats], vertex, vertex_floats)) {
+	 slot = (slot + 1) & (table_size - 1);
+      }
+      if(table[slot] == UINT32_MAX) {
+	 table[slot] = (uint32_t)(mesh->vertices.size() / vertex_floats);
+	 mesh->vertices.insert(mesh->vertices.end(), vertex, vertex + vertex_floats);
+      }
+      remap[i] = table[slot];
+   }
+
+   for(int i = 0; i + 2 < soup_vertex_count; i += 3) {
+      uint32_t a = remap[i], b = remap[i + 1], c = remap[i + 2];
+      if(a == b || b == c || c == a) {
+	 mesh->stats.degenerate_triangles += 1;
+	 continue;
+      }
+      mesh->indices.push_back(a);
+      mesh->indices.push_back(b);
+      mesh->indices.push_back(c);
+   }
+}
+// @!
+
+
+// @@ vertex cache order, Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+// vertices score by how recently they were used and how few triangles still need them, each step
+// emits the best scoring triangle among those touching the cache
+static float forsyth_vertex_score(int cache_position, int remaining_triangles) {
+   if(remaining_triangles == 0) {
+      return -1.0f;
+   }
+   float score = 0.0f;
+   if(cache_position >= 0) {
+      if(cache_position < 3) {
+	 // used by the triangle just emitted, a fixed score so the next one does not always share an edge
+	 score = 0.75f;
+      } else {
+	 float scale = 1.0f / (MESH_OPTIMIZE_CACHE_SIZE - 3);
+	 score = powf(1.0f - (cache_position - 3) * scale, 1.5f);
+      }
+   }
+   // favour finishing off vertices with few triangles left, they would cost a reload later
+   score += 2.0f * powf((float)remaining_triangles, -0.5f);
+   return score;
+}
+
+static void optimize_vertex_cache(std::vector<uint32_t> *indices, int vertex_count) {
+   const std::vector<uint32_t> input = *indices;
+   int triangle_count = (int)input.size() / 3;
+
+   // @@ live triangle lists per vertex, the first remaining[v] entries are the unemitted ones
+   std::vector<int> remaining(vertex_count, 0);
+   for(uint32_t index : input) {
+      remaining[index] += 1;
+   }
+   std::vector<int> adjacency_offset(vertex_count + 1, 0);
+   for(int v = 0; v < vertex_count; ++v) {
+      adjacency_offset[v + 1] = adjacency_offset[v] + remaining[v];
+   }
+   std::vector<int> adjacency(input.size());
+   {
+      std::vector<int> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+      for(int t = 0; t < triangle_count * 3; ++t) {
+	 adjacency[fill[input[t]]++] = t / 3;
+      }
+   }
+   // @!
+
+   std::vector<int> cache_position(vertex_count, -1);
+   std::vector<float> vertex_score(vertex_count);
+   for(int v = 0; v < vertex_count; ++v) {
+      vertex_score[v] = forsyth_vertex_score(-1, remaining[v]);
+   }
+   std::vector<bool> emitted(triangle_count, false);
+   int best_triangle = -1;
+   float best_score = -1.0f;
+   for(int t = 0; t < triangle_count; ++t) {
+      float score = vertex_score[input[t * 3]] + vertex_score[input[t * 3 + 1]] + vertex_score[input[t * 3 + 2]];
+      if(score > best_score) {
+	 best_score = score;
+	 best_triangle = t;
+      }
+   }
+
+   indices->clear();
+   std::vector<uint32_t> cache;
+   std::vector<uint32_t> next_cache;
+   int cursor = 0;
+   for(int emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+      if(best_triangle < 0) {
+	 // dead end, nothing around the cache is left. carry on from the first triangle not yet emitted
+	 while(emitted[cursor]) {
+	    cursor += 1;
+	 }
+	 best_triangle = cursor;
+      }
+
+      int t = best_triangle;
+      const uint32_t *triangle = &input[t * 3];
+      emitted[t] = true;
+      next_cache.clear();
+      for(int k = 0; k < 3; ++k) {
+	 uint32_t v = triangle[k];
+	 indices->push_back(v);
+	 next_cache.push_back(v);
+	 int begin = adjacency_offset[v];
+	 int end = begin + remaining[v];
+	 for(int i = begin; i < end; ++i) {
+	    if(adjacency[i] == t) {
+	       std::swap(adjacency[i], adjacency[end - 1]);
+	       break;
+	    }
+	 }
+	 remaining[v] -= 1;
+      }
+      for(uint32_t v : cache) {
+	 if(v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+	    next_cache.push_back(v);
+	 }
+      }
+
+      for(size_t i = 0; i < next_cache.size(); ++i) {
+	 uint32_t v = next_cache[i];
+	 cache_position[v] = i < (size_t)MESH_OPTIMIZE_CACHE_SIZE ? (int)i : -1;
+	 vertex_score[v] = forsyth_vertex_score(cache_position[v], remaining[v]);
+      }
+      if(next_cache.size() > (size_t)MESH_OPTIMIZE_CACHE_SIZE) {
+	 next_cache.resize(MESH_OPTIMIZE_CACHE_SIZE);
+      }
+      cache.swap(next_cache);
+
+      // only triangles touching the cache changed score, the best of them goes next
+      best_triangle = -1;
+      best_score = -1.0f;
+      for(uint32_t v : cache) {
+	 for(int i = adjacency_offset[v]; i < adjacency_offset[v] + remaining[v]; ++i) {
+	    const uint32_t *candidate = &input[adjacency[i] * 3];
+	    float score = vertex_score[candidate[0]] + vertex_score[candidate[1]] + vertex_score[candidate[2]];
+	    if(score > best_score) {
+	       best_score = score;
+	       best_triangle = adjacency[i];
+	    }
+	 }
+      }
+   }
+}
+// @!
+
+
+void mesh_cache_stats(const std::vector<uint32_t> &indices, int vertex_count, int cache_size, float *acmr,
+		      float *atvr) {
+   // a vertex is cached while fewer than cache_size misses happened since it was loaded
+   std::vector<long long> loaded_at(vertex_count, -(long long)cache_size - 1);
+   long long misses = 0;
+   for(uint32_t index : indices) {
+      if(misses - loaded_at[index] > cache_size) {
+	 loaded_at[index] = misses;
+	 misses += 1;
+      }
+   }
+   size_t triangle_count = indices.size() / 3;
+   *acmr = triangle_count ? (float)misses / triangle_count : 0.0f;
+   *atvr = vertex_count ? (float)misses / vertex_count : 0.0f;
+}
+
+
+// @@ overdraw order, after Sander et al. "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// the cache ordered list is cut into clusters, then clusters facing away from the middle of the mesh
+// are drawn first: they tend to be in front of the rest from any direction they are visible from
+static void optimize_overdraw(std::vector<uint32_t> *indices, const Mesh *mesh, int vertex_count,
+			      float threshold) {
+   int triangle_count = (int)indices->size() / 3;
+   if(triangle_count < 2) {
+      return;
+   }
+   const std::vector<uint32_t> &order = *indices;
+
+   float target_acmr, target_atvr;
+   mesh_cache_stats(order, vertex_count, MESH_STATS_CACHE_SIZE, &target_acmr, &target_atvr);
+   target_acmr *= threshold;
+
+   // @@ clusters, a triangle that misses on all three vertices starts one for free. otherwise a
+   // cluster may end as soon as its own ACMR, counted from a cold cache, is under the target
+   std::vector<int> cluster_starts;
+   {
+      std::vector<long long> loaded_at(vertex_count, -(long long)MESH_STATS_CACHE_SIZE - 1);
+      long long misses = 0;
+      int cluster_triangles = 0;
+      long long cluster_misses = 0;
+      for(int t = 0; t < triangle_count; ++t) {
+	 const uint32_t *triangle = &order[t * 3];
+	 bool cold = true;
+	 for(int k = 0; k < 3; ++k) {
+	    cold = cold && misses - loaded_at[triangle[k]] > MESH_STATS_CACHE_SIZE;
+	 }
+	 if(t == 0 || cold || (float)cluster_misses / cluster_triangles <= target_acmr) {
+	    // a cluster may be drawn after any other, so it is counted from a cold cache
+	    misses += MESH_STATS_CACHE_SIZE + 1;
+	    cluster_starts.push_back(t);
+	    cluster_triangles = 0;
+	    cluster_misses = 0;
+	 }
+	 int triangle_misses = 0;
+	 for(int k = 0; k < 3; ++k) {
+	    if(misses - loaded_at[triangle[k]] > MESH_STATS_CACHE_SIZE) {
+	       loaded_at[triangle[k]] = misses;
+	       misses += 1;
+	       triangle_misses += 1;
+	    }
+	 }
+	 cluster_triangles += 1;
+	 cluster_misses += triangle_misses;
+      }
+   }
+   int cluster_count = (int)cluster_starts.size();
+   cluster_starts.push_back(triangle_count);
+   if(cluster_count < 2) {
+      return;
+   }
+   // @!
+
+   // @@ area weighted centroid and normal per cluster, and for the whole mesh
+   const float *vertices = mesh->vertices.data();
+   int vertex_floats = mesh->vertex_floats;
+   std::vector<glm::vec3> cluster_centroid(cluster_count, glm::vec3(0.0f));
+   std::vector<glm::vec3> cluster_normal(cluster_count, glm::vec3(0.0f));
+   glm::vec3 mesh_centroid(0.0f);
+   float mesh_area = 0.0f;
+   for(int c = 0; c < cluster_count; ++c) {
+      float cluster_area = 0.0f;
+      for(int t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t) {
+	 glm::vec3 p0 = glm::vec3(vertices[order[t * 3] * vertex_floats], vertices[order[t * 3] * vertex_floats + 1],
+				  vertices[order[t * 3] * vertex_floats + 2]);
+	 glm::vec3 p1 = glm::vec3(vertices[order[t * 3 + 1] * vertex_floats],
+				  vertices[order[t * 3 + 1] * vertex_floats + 1],
+				  vertices[order[t * 3 + 1] * vertex_floats + 2]);
+	 glm::vec3 p2 = glm::vec3(vertices[order[t * 3 + 2] * vertex_floats],
+				  vertices[order[t * 3 + 2] * vertex_floats + 1],
+				  vertices[order[t * 3 + 2] * vertex_floats + 2]);
+	 glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+	 float area = glm::length(normal);
+	 glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+	 cluster_centroid[c] += centroid * area;
+	 cluster_normal[c] += normal;
+	 cluster_area += area;
+	 mesh_centroid += centroid * area;
+	 mesh_area += area;
+      }
+      if(cluster_area > 0.0f) {
+	 cluster_centroid[c] /= cluster_area;
+      }
+   }
+   if(mesh_area > 0.0f) {
+      mesh_centroid /= mesh_area;
+   }
+   // @!
+
+   std::vector<float> outwardness(cluster_count);
+   std::vector<int> cluster_order(cluster_count);
+   for(int c = 0; c < cluster_count; ++c) {
+      float length = glm::length(cluster_normal[c]);
+      glm::vec3 normal = length > 0.0f ? cluster_normal[c] / length : glm::vec3(0.0f);
+      outwardness[c] = glm::dot(cluster_centroid[c] - mesh_centroid, normal);
+      cluster_order[c] = c;
+   }
+   std::stable_sort(cluster_order.begin(), cluster_order.end(),
+		    [&outwardness](int a, int b) { return outwardness[a] > outwardness[b]; });
+
+   std::vector<uint32_t> sorted;
+   sorted.reserve(order.size());
+   for(int c : cluster_order) {
+      sorted.insert(sorted.end(), order.begin() + cluster_starts[c] * 3, order.begin() + cluster_starts[c + 1] * 3);
+   }
+   indices->swap(sorted);
+}
+// @!
+
+
+// @@ fetch order, vertices move to where the index buffer first asks for them
+static void optimize_vertex_fetch(Mesh *mesh) {
+   int vertex_floats = mesh->vertex_floats;
+   std::vector<uint32_t> remap(mesh->vertices.size() / vertex_floats, UINT32_MAX);
+   std::vector<float> fetch_ordered;
+   fetch_ordered.reserve(mesh->vertices.size());
+   uint32_t next_vertex = 0;
+   for(uint32_t &index : mesh->indices) {
+      if(remap[index] == UINT32_MAX) {
+	 remap[index] = next_vertex++;
+	 const float *vertex = &mesh->vertices[(size_t)index * vertex_floats];
+	 fetch_ordered.insert(fetch_ordered.end(), vertex, vertex + vertex_floats);
+      }
+      index = remap[index];
+   }
+   mesh->vertices.swap(fetch_ordered);
+}
+// @!
+
+
+void mesh_build(const float *soup, int soup_vertex_count, int vertex_floats, Mesh *mesh, float overdraw_threshold) {
+   mesh->vertex_floats = vertex_floats;
+   mesh->vertices.clear();
+   mesh->indices.clear();
+   mesh->stats = MeshStats{};
+   mesh->stats.soup_vertices = soup_vertex_count;
+
+   weld_vertices(soup, soup_vertex_count, mesh);
+   int vertex_count = (int)(mesh->vertices.size() / vertex_floats);
+   mesh_cache_stats(mesh->indices, vertex_count, MESH_STATS_CACHE_SIZE, &mesh->stats.welded_acmr,
+		    &mesh->stats.welded_atvr);
+
+   optimize_vertex_cache(&mesh->indices, vertex_count);
+   mesh_cache_stats(mesh->indices, vertex_count, MESH_STATS_CACHE_SIZE, &mesh->stats.cache_acmr,
+		    &mesh->stats.cache_atvr);
+
+   optimize_overdraw(&mesh->indices, mesh, vertex_count, overdraw_threshold);
+   optimize_vertex_fetch(mesh);
+   vertex_count = (int)(mesh->vertices.size() / vertex_floats);
+   mesh_cache_stats(mesh->indices, vertex_count, MESH_STATS_CACHE_SIZE, &mesh->stats.final_acmr,
+		    &mesh->stats.final_atvr);
+}
+
+
+void mesh_generate_sphere(int segments, int rings, std::vector<float> *soup) {
+   auto push_vertex = [soup, segments, rings](int segment, int ring) {
+      float u = (float)segment / segments;
+      float v = (float)ring / rings;
+      float theta = u * 6.28318531f;
+      float phi = v * 3.14159265f;
+      glm::vec3 normal(sinf(phi) * cosf(theta), -cosf(phi), -sinf(phi) * sinf(theta));
+      glm::vec3 position = normal * 0.5f;
+      soup->insert(soup->end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z, u, v});
+   };
+
+   soup->clear();
+   for(int ring = 0; ring < rings; ++ring) {
+      for(int segment = 0; segment < segments; ++segment) {
+	 // the pole rows only get one triangle per quad, the other would have zero area
+	 if(ring > 0) {
+	    push_vertex(segment, ring);
+	    push_vertex(segment + 1, ring);
+	    push_vertex(segment + 1, ring + 1);
+	 }
+	 if(ring < rings - 1) {
+	    push_vertex(segment, ring);
+	    push_vertex(segment + 1, ring + 1);
+	    push_vertex(segment, ring + 1);
+	 }
+      }
+   }
+}
+
+
+void mesh_print_stats(const char *name, const Mesh *mesh) {
+   const MeshStats &stats = mesh->stats;
+   int vertex_count = (int)(mesh->vertices.size() / mesh->vertex_floats);
+   printf("mesh %s: %d soup vertices welded to %d, %d triangles, %d degenerate dropped\n", name,
+	  stats.soup_vertices, vertex_count, (int)mesh->indices.size() / 3, stats.degenerate_triangles);
+   printf("   ACMR  unindexed 3.000  welded %.3f  cache order %.3f  overdraw order %.3f\n", stats.welded_acmr,
+	  stats.cache_acmr, stats.final_acmr);
+   printf("   ATVR  unindexed %.3f  welded %.3f  cache order %.3f  overdraw order %.3f\n",
+	  vertex_count ? (float)stats.soup_vertices / vertex_count : 0.0f, stats.welded_atvr, stats.cache_atvr,
+	  stats.final_atvr);
+}
@@ -0,0 +1,64 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+// @@ post transform cache models
+// the optimizer scores against an LRU of this size, the statistics simulate a FIFO of the stats size
+// which is closer to what current hardware does and what published ACMR numbers are quoted against
+const int MESH_OPTIMIZE_CACHE_SIZE = 32;
+const int MESH_STATS_CACHE_SIZE = 16;
+// @!
+
+
+// ACMR is transformed vertices per triangle (3 unindexed, 0.5 is the limit for a regular grid),
+// ATVR is transformed vertices per unique vertex (1 means every vertex is shaded exactly once)
+struct MeshStats {
+   int soup_vertices;
+   int degenerate_triangles;
+   float welded_acmr;
+   float welded_atvr;
+   float cache_acmr;
+   float cache_atvr;
+   float final_acmr;
+   float final_atvr;
+};
+
+// interleaved vertices, vertex_floats per vertex with the position in the first three
+struct Mesh {
+   int vertex_floats;
+   std::vector<float> vertices;
+   std::vector<uint32_t> indices;
+   MeshStats stats;
+};
+
+
+// triangle soup in, indexed mesh out. bit identical vertices are welded, triangles are ordered for
+// the post transform cache (Forsyth), then regrouped into clusters drawn outside facing first as long
+// as that costs less than overdraw_threshold times the cache optimized ACMR, and finally vertices are
+// renumbered in first use order so fetches walk the buffer forwards
+void mesh_build(const float *soup, int soup_vertex_count, int vertex_floats, Mesh *mesh,
+		float overdraw_threshold = 1.05f);
+
+// FIFO cache of cache_size over indices, vertex_count is the number of vertices indices refers to
+void mesh_cache_stats(const std::vector<uint32_t> &indices, int vertex_count, int cache_size, float *acmr,
+		      float *atvr);
+
+void mesh_print_stats(const char *name, const Mesh *mesh);
+
+// unit diameter uv sphere as a soup of 8 float vertices (position, normal, uv) for mesh_build
+void mesh_generate_sphere(int segments, int rings, std::vector<float> *soup);
@@ -0,0 +1,100 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "mesh_arena.h"
+
+#include <cstdlib>
+#include <iostream>
+
+
+void mesh_arena_init(MeshArena *arena, GLsizeiptr vertex_bytes, GLsizeiptr index_bytes) {
+   buffer_arena_init(&arena->vertices, "mesh vertex", vertex_bytes, MESH_ARENA_VERTEX_GRANULARITY);
+   buffer_arena_init(&arena->indices, "mesh index", index_bytes, MESH_ARENA_INDEX_GRANULARITY);
+}
+
+
+GLuint mesh_arena_create_pull_vertex_array(MeshArena *arena) {
+   glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, MESH_PULL_VERTEX_BINDING, 1, &arena->vertices.buffer);
+
+   GLuint vertex_array;
+   glCreateVertexArrays(1, &vertex_array);
+   glVertexArrayElementBuffer(vertex_array, arena->indices.buffer);
+   return vertex_array;
+}
+
+
+bool mesh_arena_add(MeshArena *arena, const void *vertices, uint32_t vertex_count, GLsizei vertex_stride,
+		    const uint32_t *indices, GLsizei index_count, MeshAllocation *allocation) {
+   if(MESH_ARENA_VERTEX_GRANULARITY % vertex_stride != 0) {
+      std::cerr << "ERROR: vertex stride " << vertex_stride << " does not divide the mesh arena granularity\n";
+      exit(1);
+   }
+
+   *allocation = MeshAllocation{TLSF_INVALID, TLSF_INVALID, vertex_stride, 0};
+   uint32_t vertex_allocation = buffer_arena_allocate(&arena->vertices, (GLsizeiptr)vertex_count * vertex_stride,
+						      vertices);
+   if(vertex_allocation == TLSF_INVALID) {
+      return false;
+   }
+   uint32_t index_allocation = buffer_arena_allocate(&arena->indices, index_count * sizeof(uint32_t), indices);
+   if(index_allocation == TLSF_INVALID) {
+      buffer_arena_free(&arena->vertices, vertex_allocation);
+      return false;
+   }
+
+   *allocation = MeshAllocation{vertex_allocation, index_allocation, vertex_stride, index_count};
+   return true;
+}
+
+
+void mesh_arena_remove(MeshArena *arena, MeshAllocation *allocation) {
+   if(allocation->index_count == 0) {
+      return;
+   }
+   buffer_arena_free(&arena->vertices, allocation->vertices);
+   buffer_arena_free(&arena->indices, allocation->indices);
+   allocation->index_count = 0;
+}
+
+
+MeshDrawRange mesh_arena_range(const MeshArena *arena, const MeshAllocation &allocation) {
+   MeshDrawRange range;
+   range.first_index = (GLuint)(buffer_arena_offset(&arena->indices, allocation.indices) / sizeof(uint32_t));
+   range.index_count = allocation.index_count;
+   range.base_vertex = (GLint)(buffer_arena_offset(&arena->vertices, allocation.vertices) / allocation.vertex_stride);
+   return range;
+}
+
+
+void mesh_arena_draw(const MeshArena *arena, const MeshAllocation &allocation, GLsizei instance_count) {
+   MeshDrawRange range = mesh_arena_range(arena, allocation);
+   const void *first_index = (const void *)(range.first_index * sizeof(uint32_t));
+   if(instance_count == 1) {
+      glDrawElementsBaseVertex(GL_TRIANGLES, range.index_count, GL_UNSIGNED_INT, first_index, range.base_vertex);
+   } else {
+      glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.index_count, GL_UNSIGNED_INT, first_index,
+					instance_count, range.base_vertex);
+   }
+}
+
+
+void mesh_arena_print(MeshArena *arena) {
+   buffer_arena_print(&arena->vertices);
+   buffer_arena_print(&arena->indices);
+}
+
+
+void mesh_arena_destroy(MeshArena *arena) {
+   buffer_arena_destroy(&arena->vertices);
+   buffer_arena_destroy(&arena->indices);
+}
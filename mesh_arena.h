@@ -0,0 +1,69 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <cstdint>
+
+#include "buffer_allocator.h"
+
+
+// @@ every mesh's vertices in one shared buffer and its indices in another
+// vertex ranges start on multiples of MESH_ARENA_VERTEX_GRANULARITY, so any stride dividing it turns
+// the offset into a whole base vertex. one vertex array per vertex layout covers every mesh in it
+const GLsizeiptr MESH_ARENA_VERTEX_GRANULARITY = 64;
+const GLsizeiptr MESH_ARENA_INDEX_GRANULARITY = 16;
+
+// vertex pulling, shaders/include/vertex_pulling.glsl reads the vertex buffer (and an instance buffer)
+// as shader storage and decodes by gl_VertexID, so every layout shares one attribute-less VAO
+const GLuint MESH_PULL_VERTEX_BINDING = 2;
+const GLuint MESH_PULL_INSTANCE_BINDING = 3;
+// @!
+
+// index_count is 0 while the mesh is not in the arena
+struct MeshAllocation {
+   uint32_t vertices;
+   uint32_t indices;
+   GLsizei vertex_stride;
+   GLsizei index_count;
+};
+
+// where a mesh is right now, only valid until the next allocation (which may defragment)
+struct MeshDrawRange {
+   GLuint first_index;
+   GLsizei index_count;
+   GLint base_vertex;
+};
+
+struct MeshArena {
+   BufferArena vertices;
+   BufferArena indices;
+};
+
+
+void mesh_arena_init(MeshArena *arena, GLsizeiptr vertex_bytes, GLsizeiptr index_bytes);
+// binds the vertex buffer at MESH_PULL_VERTEX_BINDING for the rest of the run and returns a vertex
+// array that only holds the index buffer. the buffer never changes name, so neither goes stale
+GLuint mesh_arena_create_pull_vertex_array(MeshArena *arena);
+// uploads both halves on the GL thread, false (and nothing allocated) if either does not fit
+bool mesh_arena_add(MeshArena *arena, const void *vertices, uint32_t vertex_count, GLsizei vertex_stride,
+		    const uint32_t *indices, GLsizei index_count, MeshAllocation *allocation);
+void mesh_arena_remove(MeshArena *arena, MeshAllocation *allocation);
+MeshDrawRange mesh_arena_range(const MeshArena *arena, const MeshAllocation &allocation);
+// a vertex array over the arena buffers with the mesh's layout must be bound
+void mesh_arena_draw(const MeshArena *arena, const MeshAllocation &allocation, GLsizei instance_count = 1);
+
+void mesh_arena_print(MeshArena *arena);
+void mesh_arena_destroy(MeshArena *arena);
@@ -0,0 +1,197 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "mesh_batch.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+void mesh_batch_init(MeshBatch *batch, MeshArena *arena) {
+   *batch = MeshBatch{};
+   batch->arena = arena;
+}
+
+
+int mesh_batch_add_mesh(MeshBatch *batch, const Mesh *mesh) {
+   VertexQuantization quantization = vertex_quantization_from_mesh(mesh);
+
+   BatchMesh batch_mesh;
+   batch_mesh.bounds_center = quantization.position_center;
+   batch_mesh.bounds_radius = glm::length(quantization.position_extent);
+   batch_mesh.dequantize = vertex_dequantize_matrix(quantization);
+
+   std::vector<ObjectVertexLayout::Vertex> packed;
+   ObjectVertexLayout::encode(mesh, quantization, &packed);
+   if(!mesh_arena_add(batch->arena, packed.data(), (uint32_t)packed.size(), ObjectVertexLayout::stride,
+		      mesh->indices.data(), (GLsizei)mesh->indices.size(), &batch_mesh.allocation)) {
+      return -1;
+   }
+   batch->meshes.push_back(batch_mesh);
+   return (int)batch->meshes.size() - 1;
+}
+
+
+void mesh_batch_add_object(MeshBatch *batch, int mesh, const glm::mat4 &model) {
+   batch->objects.push_back(BatchObject{mesh, model});
+}
+
+
+void mesh_batch_create(MeshBatch *batch, GLResourceThread *resources, bool draw_id_attribute) {
+   batch->draw_id_attribute = draw_id_attribute;
+   size_t object_count = batch->objects.size();
+   batch->commands.reserve(object_count);
+   batch->draw_objects.reserve(object_count);
+
+   std::vector<glm::mat4> object_models(object_count);
+   batch->object_spheres.resize(object_count);
+   for(size_t i = 0; i < object_count; ++i) {
+      const BatchObject &object = batch->objects[i];
+      const BatchMesh &mesh = batch->meshes[object.mesh];
+      object_models[i] = object.model * mesh.dequantize;
+
+      // the largest axis scale keeps the sphere conservative under non uniform scaling
+      glm::vec3 center = glm::vec3(object.model * glm::vec4(mesh.bounds_center, 1.0f));
+      float scale = std::max(glm::length(glm::vec3(object.model[0])),
+			     std::max(glm::length(glm::vec3(object.model[1])), glm::length(glm::vec3(object.model[2]))));
+      batch->object_spheres[i] = glm::vec4(center, mesh.bounds_radius * scale);
+   }
+   // the fallback draw index is an instanced attribute, base_instance picks the entry for each command
+   std::vector<GLuint> draw_ids(draw_id_attribute ? object_count : 0);
+   for(size_t i = 0; i < draw_ids.size(); ++i) {
+      draw_ids[i] = (GLuint)i;
+   }
+
+   gl_resource_thread_submit(resources, [batch, object_models, draw_ids]() {
+      batch->object_buffer = gl_create_buffer(object_models.size() * sizeof(glm::mat4), object_models.data(), 0);
+      if(!draw_ids.empty()) {
+	 batch->draw_id_buffer = gl_create_buffer(draw_ids.size() * sizeof(GLuint), draw_ids.data(), 0);
+      }
+   }, [batch]() {
+      GLuint vertex_array = ObjectVertexLayout::create_vertex_array(batch->arena->vertices.buffer,
+								    batch->arena->indices.buffer);
+      if(batch->draw_id_buffer) {
+	 VertexAttributeFormat draw_id = {MESH_BATCH_DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, GL_FALSE, 0};
+	 gl_vertex_array_add_buffer(vertex_array, 1, batch->draw_id_buffer, sizeof(GLuint), &draw_id, 1, 1);
+	 // an integer attribute, the float format call above would convert it
+	 glVertexArrayAttribIFormat(vertex_array, MESH_BATCH_DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, 0);
+      }
+      glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, MESH_BATCH_OBJECT_BINDING, 1, &batch->object_buffer);
+      batch->vertex_array = vertex_array;
+   });
+}
+
+
+void mesh_batch_frustum_planes(const glm::mat4 &view_projection, glm::vec4 planes[6]) {
+   glm::vec4 row[4];
+   for(int i = 0; i < 4; ++i) {
+      row[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+   }
+   planes[0] = row[3] + row[0];
+   planes[1] = row[3] - row[0];
+   planes[2] = row[3] + row[1];
+   planes[3] = row[3] - row[1];
+   planes[4] = row[3] + row[2];
+   planes[5] = row[3] - row[2];
+   for(int i = 0; i < 6; ++i) {
+      planes[i] /= glm::length(glm::vec3(planes[i]));
+   }
+}
+
+
+void mesh_batch_draw_ranges(MeshBatch *batch, std::vector<MeshDrawRange> *ranges) {
+   ranges->resize(batch->meshes.size());
+   for(size_t i = 0; i < batch->meshes.size(); ++i) {
+      (*ranges)[i] = mesh_arena_range(batch->arena, batch->meshes[i].allocation);
+   }
+}
+
+
+void mesh_batch_cull(MeshBatch *batch, const glm::mat4 &view_projection) {
+   glm::vec4 planes[6];
+   mesh_batch_frustum_planes(view_projection, planes);
+   std::vector<MeshDrawRange> ranges;
+   mesh_batch_draw_ranges(batch, &ranges);
+
+   batch->commands.clear();
+   batch->draw_objects.clear();
+   for(size_t i = 0; i < batch->objects.size(); ++i) {
+      const BatchObject &object = batch->objects[i];
+      glm::vec3 center = glm::vec3(batch->object_spheres[i]);
+      float radius = batch->object_spheres[i].w;
+
+      bool visible = true;
+      for(const glm::vec4 &plane : planes) {
+	 if(glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+	    visible = false;
+	    break;
+	 }
+      }
+      if(!visible) {
+	 continue;
+      }
+
+      GLuint draw = (GLuint)batch->commands.size();
+      const MeshDrawRange &range = ranges[object.mesh];
+      batch->commands.push_back({(GLuint)range.index_count, 1, range.first_index, range.base_vertex, draw});
+      batch->draw_objects.push_back((GLuint)i);
+   }
+}
+
+
+void mesh_batch_draw(MeshBatch *batch, GLStateCache *state, StreamRing *ring) {
+   batch->frames += 1;
+   if(!batch->vertex_array || batch->commands.empty()) {
+      return;
+   }
+
+   // plain stores into mapped memory, no GL call at all for the uploads
+   GLsizei draw_count = (GLsizei)batch->commands.size();
+   GLsizeiptr draw_objects_size = draw_count * sizeof(GLuint);
+   GLintptr command_offset = stream_ring_write(ring, batch->commands.data(),
+					       draw_count * sizeof(DrawElementsIndirectCommand));
+   GLintptr draw_objects_offset = stream_ring_write(ring, batch->draw_objects.data(), draw_objects_size);
+   if(command_offset < 0 || draw_objects_offset < 0) {
+      return;
+   }
+
+   glBindBuffersRange(GL_SHADER_STORAGE_BUFFER, MESH_BATCH_DRAW_BINDING, 1, &ring->buffer, &draw_objects_offset,
+		      &draw_objects_size);
+   gl_state_bind_vertex_array(state, batch->vertex_array);
+   gl_state_bind_buffer(state, GL_DRAW_INDIRECT_BUFFER, ring->buffer);
+   glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void *)command_offset, draw_count, 0);
+
+   // the range bind, two binds that gl_state elides while nothing else moves them, and the draw
+   batch->draws_submitted += draw_count;
+   batch->api_calls += 4;
+}
+
+
+void mesh_batch_print(MeshBatch *batch) {
+   uint64_t frames = std::max(batch->frames, (uint64_t)1);
+   printf("mesh batch: %zu meshes, %zu objects, draw index from %s\n", batch->meshes.size(),
+	  batch->objects.size(), batch->draw_id_attribute ? "an instanced attribute" : "gl_DrawIDARB");
+   // nothing to report when the GPU culled and drew it
+   if(batch->frames > 0) {
+      printf("   per frame  %.1f visible draws in %.1f GL calls\n", (double)batch->draws_submitted / frames,
+	     (double)batch->api_calls / frames);
+   }
+}
+
+
+void mesh_batch_destroy(MeshBatch *batch) {
+   GLuint buffers[2] = {batch->object_buffer, batch->draw_id_buffer};
+   glDeleteBuffers(2, buffers);
+   glDeleteVertexArrays(1, &batch->vertex_array);
+   batch->vertex_array = 0;
+}
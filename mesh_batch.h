@@ -0,0 +1,110 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "gl_resources.h"
+#include "gl_state.h"
+#include "mesh.h"
+#include "mesh_arena.h"
+#include "stream_ring.h"
+#include "vertex_layout.h"
+
+
+// @@ shader storage bindings, shaders/batched.vert declares the same numbers
+const GLuint MESH_BATCH_OBJECT_BINDING = 0;
+const GLuint MESH_BATCH_DRAW_BINDING = 1;
+// without GL_ARB_shader_draw_parameters the draw index comes in as this per instance attribute
+const GLuint MESH_BATCH_DRAW_ID_LOCATION = 5;
+// @!
+
+
+// the layout glMultiDrawElementsIndirect reads, five uints per command
+struct DrawElementsIndirectCommand {
+   GLuint count;
+   GLuint instance_count;
+   GLuint first_index;
+   GLint base_vertex;
+   GLuint base_instance;
+};
+
+// bounds are in the mesh's own space before dequantizing
+struct BatchMesh {
+   MeshAllocation allocation;
+   glm::vec3 bounds_center;
+   float bounds_radius;
+   glm::mat4 dequantize;
+};
+
+struct BatchObject {
+   int mesh;
+   glm::mat4 model;
+};
+
+// every mesh lives in the MeshArena as ObjectVertexLayout vertices, every object has its model matrix
+// (dequantize folded in) in the object SSBO. each frame the visible objects become one command each
+// plus an entry in the draw SSBO that maps the draw index back to the object, both streamed through
+// the frame's StreamRing region
+struct MeshBatch {
+   // @@ CPU side, objects are added before mesh_batch_create
+   MeshArena *arena;
+   std::vector<BatchMesh> meshes;
+   std::vector<BatchObject> objects;
+   // world space bounding sphere of every object, xyz center and w radius, filled by mesh_batch_create
+   std::vector<glm::vec4> object_spheres;
+   std::vector<DrawElementsIndirectCommand> commands;
+   std::vector<GLuint> draw_objects;
+   // @!
+
+   // @@ GPU side, vertex_array is 0 until the resource thread has made the buffers
+   GLuint object_buffer;
+   GLuint draw_id_buffer;
+   GLuint vertex_array;
+   bool draw_id_attribute;
+   // @!
+
+   uint64_t frames;
+   uint64_t draws_submitted;
+   uint64_t api_calls;
+};
+
+
+void mesh_batch_init(MeshBatch *batch, MeshArena *arena);
+// returns the mesh index for mesh_batch_add_object, -1 if the arena is full
+int mesh_batch_add_mesh(MeshBatch *batch, const Mesh *mesh);
+void mesh_batch_add_object(MeshBatch *batch, int mesh, const glm::mat4 &model);
+
+// uploads the objects added so far on the resource thread, the batch must stay where it is until the
+// ready half has run. draw_id_attribute for drivers without GL_ARB_shader_draw_parameters
+void mesh_batch_create(MeshBatch *batch, GLResourceThread *resources, bool draw_id_attribute);
+
+// frustum planes straight from the matrix rows (Gribb and Hartmann), normalized with xyz pointing in
+void mesh_batch_frustum_planes(const glm::mat4 &view_projection, glm::vec4 planes[6]);
+// arena offsets move when it defragments, look them up once per frame
+void mesh_batch_draw_ranges(MeshBatch *batch, std::vector<MeshDrawRange> *ranges);
+
+// CPU frustum test of every object's bounding sphere, fills commands and draw_objects
+void mesh_batch_cull(MeshBatch *batch, const glm::mat4 &view_projection);
+// the batched program and its textures must already be bound, one glMultiDrawElementsIndirect
+// skips the frame if the ring has no room left for the commands
+void mesh_batch_draw(MeshBatch *batch, GLStateCache *state, StreamRing *ring);
+
+void mesh_batch_print(MeshBatch *batch);
+void mesh_batch_destroy(MeshBatch *batch);
@@ -0,0 +1,1193 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "mesh_import.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+
+const int MESH_SOUP_FLOATS = 8;
+
+
+// @@ text scanning, OBJ files run to hundreds of megabytes so this avoids strtof and its locale
+static const char *skip_spaces(const char *cursor, const char *end) {
+   while(cursor < end && (*cursor == ' ' || *cursor == '\t')) {
+      cursor += 1;
+   }
+   return cursor;
+}
+
+static const char *skip_line(const char *cursor, const char *end) {
+   while(cursor < end && *cursor != '\n') {
+      cursor += 1;
+   }
+   return cursor < end ? cursor + 1 : end;
+}
+
+static const char *parse_int(const char *cursor, const char *end, int *out) {
+   bool negative = cursor < end && *cursor == '-';
+   if(cursor < end && (*cursor == '-' || *cursor == '+')) {
+      cursor += 1;
+   }
+   long long value = 0;
+   const char *digits = cursor;
+   while(cursor < end && *cursor >= '0' && *cursor <= '9') {
+      value = std::min(value * 10 + (*cursor - '0'), (long long)INT_MAX);
+      cursor += 1;
+   }
+   *out = cursor == digits ? 0 : (int)(negative ? -value : value);
+   return cursor;
+}
+
+static const char *parse_float(const char *cursor, const char *end, float *out) {
+   static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+					  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+   bool negative = cursor < end && *cursor == '-';
+   if(cursor < end && (*cursor == '-' || *cursor == '+')) {
+      cursor += 1;
+   }
+   // 19 significant digits fit in the mantissa, the rest only move the exponent
+   uint64_t mantissa = 0;
+   int digits = 0;
+   int exponent = 0;
+   while(cursor < end && *cursor >= '0' && *cursor <= '9') {
+      if(digits < 19) {
+	 mantissa = mantissa * 10 + (*cursor - '0');
+	 digits += mantissa > 0;
+      } else {
+	 exponent += 1;
+      }
+      cursor += 1;
+   }
+   if(cursor < end && *cursor == '.') {
+      cursor += 1;
+      while(cursor < end && *cursor >= '0' && *cursor <= '9') {
+	 if(digits < 19) {
+	    mantissa = mantissa * 10 + (*cursor - '0');
+	    digits += mantissa > 0;
+	    exponent -= 1;
+	 }
+	 cursor += 1;
+      }
+   }
+   if(cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+      int written_exponent;
+      cursor = parse_int(cursor + 1, end, &written_exponent);
+      exponent += written_exponent;
+   }
+
+   double value = (double)mantissa;
+   if(exponent < 0) {
+      value = -exponent <= 22 ? value / powers_of_ten[-exponent] : value * pow(10.0, exponent);
+   } else if(exponent > 0) {
+      value = exponent <= 22 ? value * powers_of_ten[exponent] : value * pow(10.0, exponent);
+   }
+   *out = (float)(negative ? -value : value);
+   return cursor;
+}
+// @!
+
+
+// face normal for corners that came without one, counter clockwise is the front
+static glm::vec3 triangle_normal(const float *a, const float *b, const float *c) {
+   glm::vec3 p0(a[0], a[1], a[2]);
+   glm::vec3 normal = glm::cross(glm::vec3(b[0], b[1], b[2]) - p0, glm::vec3(c[0], c[1], c[2]) - p0);
+   float length = glm::length(normal);
+   return length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+
+// @@ OBJ, the file is cut into chunks at line breaks and every chunk is parsed on its own
+// indices that are relative (negative) can only be resolved once the counts of the chunks before are
+// known, so they are kept chunk local until every chunk is done
+const int OBJ_INDEX_ABSENT = INT_MIN;
+
+struct ObjCorner {
+   int index[3];      // position, uv, normal
+   uint8_t chunk_local; // bit per index, set when it is relative to the chunk's own attribute counts
+};
+
+struct ObjChunk {
+   const char *begin;
+   const char *end;
+   std::vector<float> positions;
+   std::vector<float> uvs;
+   std::vector<float> normals;
+   std::vector<ObjCorner> corners;
+   size_t attribute_base[3];
+   size_t triangle_base;
+   bool failed;
+};
+
+static const char *parse_obj_corner(const char *cursor, const char *end, const ObjChunk *chunk,
+				    ObjCorner *corner) {
+   size_t local_counts[3] = {chunk->positions.size() / 3, chunk->uvs.size() / 2, chunk->normals.size() / 3};
+   corner->chunk_local = 0;
+   for(int i = 0; i < 3; ++i) {
+      corner->index[i] = OBJ_INDEX_ABSENT;
+      if(i > 0) {
+	 if(cursor >= end || *cursor != '/') {
+	    continue;
+	 }
+	 cursor += 1;
+      }
+      if(cursor < end && (*cursor == '-' || (*cursor >= '0' && *cursor <= '9'))) {
+	 int value;
+	 cursor = parse_int(cursor, end, &value);
+	 if(value < 0) {
+	    corner->index[i] = (int)local_counts[i] + value;
+	    corner->chunk_local |= 1 << i;
+	 } else if(value > 0) {
+	    corner->index[i] = value - 1;
+	 }
+      }
+   }
+   return cursor;
+}
+
+static void parse_obj_chunk(ObjChunk *chunk) {
+   const char *cursor = chunk->begin;
+   const char *end = chunk->end;
+   std::vector<ObjCorner> polygon;
+   while(cursor < end) {
+      cursor = skip_spaces(cursor, end);
+      const char *line_end = cursor;
+      while(line_end < end && *line_end != '\n' && *line_end != '\r') {
+	 line_end += 1;
+      }
+
+      if(line_end - cursor > 2 && cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+	 for(int i = 0; i < 3; ++i) {
+	    float value;
+	    cursor = parse_float(skip_spaces(cursor + (i == 0), line_end), line_end, &value);
+	    chunk->positions.push_back(value);
+	 }
+      } else if(line_end - cursor > 3 && cursor[0] == 'v' && cursor[1] == 't') {
+	 cursor += 2;
+	 for(int i = 0; i < 2; ++i) {
+	    float value;
+	    cursor = parse_float(skip_spaces(cursor, line_end), line_end, &value);
+	    chunk->uvs.push_back(value);
+	 }
+      } else if(line_end - cursor > 3 && cursor[0] == 'v' && cursor[1] == 'n') {
+	 cursor += 2;
+	 for(int i = 0; i < 3; ++i) {
+	    float value;
+	    cursor = parse_float(skip_spaces(cursor, line_end), line_end, &value);
+	    chunk->normals.push_back(value);
+	 }
+      } else if(line_end - cursor > 2 && cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+	 polygon.clear();
+	 cursor += 1;
+	 while(true) {
+	    cursor = skip_spaces(cursor, line_end);
+	    if(cursor >= line_end) {
+	       break;
+	    }
+	    ObjCorner corner;
+	    const char *corner_end = parse_obj_corner(cursor, line_end, chunk, &corner);
+	    if(corner_end == cursor || corner.index[0] == OBJ_INDEX_ABSENT) {
+	       break;
+	    }
+	    cursor = corner_end;
+	    polygon.push_back(corner);
+	 }
+	 // fan, fine for the convex polygons exporters write
+	 for(size_t i = 2; i < polygon.size(); ++i) {
+	    chunk->corners.push_back(polygon[0]);
+	    chunk->corners.push_back(polygon[i - 1]);
+	    chunk->corners.push_back(polygon[i]);
+	 }
+      }
+      cursor = skip_line(line_end, end);
+   }
+}
+
+// chunk local indices become absolute, false when anything points outside its array
+static bool resolve_obj_chunk(ObjChunk *chunk, const size_t attribute_counts[3]) {
+   for(ObjCorner &corner : chunk->corners) {
+      for(int i = 0; i < 3; ++i) {
+	 if(corner.index[i] == OBJ_INDEX_ABSENT) {
+	    continue;
+	 }
+	 long long index = corner.index[i];
+	 if(corner.chunk_local & (1 << i)) {
+	    index += (long long)chunk->attribute_base[i];
+	 }
+	 if(index < 0 || index >= (long long)attribute_counts[i]) {
+	    return false;
+	 }
+	 corner.index[i] = (int)index;
+      }
+   }
+   return true;
+}
+
+bool mesh_import_obj(ThreadPool *pool, std::string path, Mesh *mesh) {
+   FileMapping mapping;
+   if(!file_map_open(path, &mapping)) {
+      std::cerr << "ERROR: could not open mesh: " << path << '\n';
+      return false;
+   }
+
+   // @@ chunks of at least a megabyte, a few per worker so uneven lines even out
+   const char *text = (const char *)mapping.data;
+   const char *text_end = text + mapping.size;
+   size_t chunk_target = std::max(mapping.size / (pool->workers.size() * 4 + 1), (size_t)1 << 20);
+   std::vector<ObjChunk> chunks;
+   for(const char *begin = text; begin < text_end;) {
+      const char *end = begin + std::min(chunk_target, (size_t)(text_end - begin));
+      end = end < text_end ? skip_line(end, text_end) : text_end;
+      ObjChunk chunk;
+      chunk.begin = begin;
+      chunk.end = end;
+      chunk.failed = false;
+      chunks.push_back(std::move(chunk));
+      begin = end;
+   }
+   thread_pool_parallel_for(pool, (int)chunks.size(), 1, [&chunks](int begin, int end) {
+      for(int i = begin; i < end; ++i) {
+	 parse_obj_chunk(&chunks[i]);
+      }
+   });
+   // @!
+
+   // @@ prefix sums, then resolve and expand every chunk into its slice of the soup
+   size_t attribute_counts[3] = {0, 0, 0};
+   size_t triangle_count = 0;
+   for(ObjChunk &chunk : chunks) {
+      chunk.attribute_base[0] = attribute_counts[0];
+      chunk.attribute_base[1] = attribute_counts[1];
+      chunk.attribute_base[2] = attribute_counts[2];
+      chunk.triangle_base = triangle_count;
+      attribute_counts[0] += chunk.positions.size() / 3;
+      attribute_counts[1] += chunk.uvs.size() / 2;
+      attribute_counts[2] += chunk.normals.size() / 3;
+      triangle_count += chunk.corners.size() / 3;
+   }
+   std::vector<float> positions;
+   std::vector<float> uvs;
+   std::vector<float> normals;
+   positions.reserve(attribute_counts[0] * 3);
+   uvs.reserve(attribute_counts[1] * 2);
+   normals.reserve(attribute_counts[2] * 3);
+   for(ObjChunk &chunk : chunks) {
+      positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+      uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+      normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+   }
+
+   std::vector<float> soup(triangle_count * 3 * MESH_SOUP_FLOATS);
+   thread_pool_parallel_for(pool, (int)chunks.size(), 1, [&](int begin, int end) {
+      for(int c = begin; c < end; ++c) {
+	 ObjChunk &chunk = chunks[c];
+	 if(!resolve_obj_chunk(&chunk, attribute_counts)) {
+	    chunk.failed = true;
+	    continue;
+	 }
+	 for(size_t t = 0; t < chunk.corners.size() / 3; ++t) {
+	    const ObjCorner *corners = &chunk.corners[t * 3];
+	    glm::vec3 face_normal(0.0f);
+	    if(corners[0].index[2] == OBJ_INDEX_ABSENT || corners[1].index[2] == OBJ_INDEX_ABSENT ||
+	       corners[2].index[2] == OBJ_INDEX_ABSENT) {
+	       face_normal = triangle_normal(&positions[corners[0].index[0] * 3], &positions[corners[1].index[0] * 3],
+					     &positions[corners[2].index[0] * 3]);
+	    }
+	    for(int k = 0; k < 3; ++k) {
+	       const ObjCorner &corner = corners[k];
+	       float *vertex = &soup[((chunk.triangle_base + t) * 3 + k) * MESH_SOUP_FLOATS];
+	       memcpy(vertex, &positions[(size_t)corner.index[0] * 3], 3 * sizeof(float));
+	       if(corner.index[2] != OBJ_INDEX_ABSENT) {
+		  memcpy(vertex + 3, &normals[(size_t)corner.index[2] * 3], 3 * sizeof(float));
+	       } else {
+		  memcpy(vertex + 3, &face_normal[0], 3 * sizeof(float));
+	       }
+	       vertex[6] = corner.index[1] != OBJ_INDEX_ABSENT ? uvs[(size_t)corner.index[1] * 2] : 0.0f;
+	       vertex[7] = corner.index[1] != OBJ_INDEX_ABSENT ? uvs[(size_t)corner.index[1] * 2 + 1] : 0.0f;
+	    }
+	 }
+      }
+   });
+   file_map_close(&mapping);
+   for(const ObjChunk &chunk : chunks) {
+      if(chunk.failed) {
+	 std::cerr << "ERROR: face index out of range in " << path << '\n';
+	 return false;
+      }
+   }
+   // @!
+
+   mesh_build(soup.data(), (int)(triangle_count * 3), MESH_SOUP_FLOATS, mesh);
+   return true;
+}
+// @!
+
+
+// @@ JSON, just enough for glTF documents
+enum JsonType {
+   JSON_NULL,
+   JSON_BOOL,
+   JSON_NUMBER,
+   JSON_STRING,
+   JSON_ARRAY,
+   JSON_OBJECT
+};
+
+struct JsonValue {
+   JsonType type;
+   bool boolean;
+   double number;
+   std::string string;
+   std::vector<JsonValue> items;
+   std::vector<std::pair<std::string, JsonValue>> members;
+};
+
+static const char *skip_json_space(const char *cursor, const char *end) {
+   while(cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) {
+      cursor += 1;
+   }
+   return cursor;
+}
+
+static void append_utf8(uint32_t code_point, std::string *out) {
+   if(code_point < 0x80) {
+      out->push_back((char)code_point);
+   } else if(code_point < 0x800) {
+      out->push_back((char)(0xc0 | (code_point >> 6)));
+      out->push_back((char)(0x80 | (code_point & 0x3f)));
+   } else if(code_point < 0x10000) {
+      out->push_back((char)(0xe0 | (code_point >> 12)));
+      out->push_back((char)(0x80 | ((code_point >> 6) & 0x3f)));
+      out->push_back((char)(0x80 | (code_point & 0x3f)));
+   } else {
+      out->push_back((char)(0xf0 | (code_point >> 18)));
+      out->push_back((char)(0x80 | ((code_point >> 12) & 0x3f)));
+      out->push_back((char)(0x80 | ((code_point >> 6) & 0x3f)));
+      out->push_back((char)(0x80 | (code_point & 0x3f)));
+   }
+}
+
+static const char *parse_json_hex4(const char *cursor, const char *end, uint32_t *out) {
+   *out = 0;
+   for(int i = 0; i < 4; ++i) {
+      if(cursor >= end) {
+	 return NULL;
+      }
+      char c = *cursor++;
+      int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+      if(digit < 0) {
+	 return NULL;
+      }
+      *out = *out * 16 + digit;
+   }
+   return cursor;
+}
+
+static const char *parse_json_string(const char *cursor, const char *end, std::string *out) {
+   cursor += 1;
+   while(cursor < end && *cursor != '"') {
+      if(*cursor != '\\') {
+	 out->push_back(*cursor++);
+	 continue;
+      }
+      if(++cursor >= end) {
+	 return NULL;
+      }
+      char escape = *cursor++;
+      switch(escape) {
+	 case 'b': out->push_back('\b'); break;
+	 case 'f': out->push_back('\f'); break;
+	 case 'n': out->push_back('\n'); break;
+	 case 'r': out->push_back('\r'); break;
+	 case 't': out->push_back('\t'); break;
+	 case 'u': {
+	    uint32_t code_point;
+	    if(!(cursor = parse_json_hex4(cursor, end, &code_point))) {
+	       return NULL;
+	    }
+	    // surrogate pairs
+	    if(code_point >= 0xd800 && code_point < 0xdc00 && end - cursor >= 6 && cursor[0] == '\\' &&
+	       cursor[1] == 'u') {
+	       uint32_t low;
+	       if(!(cursor = parse_json_hex4(cursor + 2, end, &low))) {
+		  return NULL;
+	       }
+	       code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+	    }
+	    append_utf8(code_point, out);
+	 } break;
+	 default: out->push_back(escape); break;
+      }
+   }
+   return cursor < end ? cursor + 1 : NULL;
+}
+
+static const char *parse_json(const char *cursor, const char *end, JsonValue *out, int depth) {
+   out->type = JSON_NULL;
+   cursor = skip_json_space(cursor, end);
+   if(cursor >= end || depth > 64) {
+      return NULL;
+   }
+
+   if(*cursor == '{') {
+      out->type = JSON_OBJECT;
+      cursor = skip_json_space(cursor + 1, end);
+      if(cursor < end && *cursor == '}') {
+	 return cursor + 1;
+      }
+      while(cursor && cursor < end) {
+	 cursor = skip_json_space(cursor, end);
+	 if(cursor >= end || *cursor != '"') {
+	    return NULL;
+	 }
+	 out->members.emplace_back();
+	 if(!(cursor = parse_json_string(cursor, end, &out->members.back().first))) {
+	    return NULL;
+	 }
+	 cursor = skip_json_space(cursor, end);
+	 if(cursor >= end || *cursor != ':') {
+	    return NULL;
+	 }
+	 if(!(cursor = parse_json(cursor + 1, end, &out->members.back().second, depth + 1))) {
+	    return NULL;
+	 }
+	 cursor = skip_json_space(cursor, end);
+	 if(cursor < end && *cursor == '}') {
+	    return cursor + 1;
+	 }
+	 if(cursor >= end || *cursor != ',') {
+	    return NULL;
+	 }
+	 cursor += 1;
+      }
+      return NULL;
+   }
+   if(*cursor == '[') {
+      out->type = JSON_ARRAY;
+      cursor = skip_json_space(cursor + 1, end);
+      if(cursor < end && *cursor == ']') {
+	 return cursor + 1;
+      }
+      while(cursor && cursor < end) {
+	 out->items.emplace_back();
+	 if(!(cursor = parse_json(cursor, end, &out->items.back(), depth + 1))) {
+	    return NULL;
+	 }
+	 cursor = skip_json_space(cursor, end);
+	 if(cursor < end && *cursor == ']') {
+	    return cursor + 1;
+	 }
+	 if(cursor >= end || *cursor != ',') {
+	    return NULL;
+	 }
+	 cursor += 1;
+      }
+      return NULL;
+   }
+   if(*cursor == '"') {
+      out->type = JSON_STRING;
+      return parse_json_string(cursor, end, &out->string);
+   }
+   if(end - cursor >= 4 && !strncmp(cursor, "true", 4)) {
+      out->type = JSON_BOOL;
+      out->boolean = true;
+      return cursor + 4;
+   }
+   if(end - cursor >= 5 && !strncmp(cursor, "false", 5)) {
+      out->type = JSON_BOOL;
+      out->boolean = false;
+      return cursor + 5;
+   }
+   if(end - cursor >= 4 && !strncmp(cursor, "null", 4)) {
+      return cursor + 4;
+   }
+   if(*cursor == '-' || (*cursor >= '0' && *cursor <= '9')) {
+      // strtod needs a terminated string, numbers are short so copy one out
+      char number[64];
+      size_t length = 0;
+      while(cursor + length < end && length < sizeof(number) - 1 && strchr("+-.eE0123456789", cursor[length])) {
+	 number[length] = cursor[length];
+	 length += 1;
+      }
+      number[length] = 0;
+      out->type = JSON_NUMBER;
+      out->number = strtod(number, NULL);
+      return cursor + length;
+   }
+   return NULL;
+}
+
+static const JsonValue *json_get(const JsonValue *object, const char *key) {
+   if(!object || object->type != JSON_OBJECT) {
+      return NULL;
+   }
+   for(const auto &member : object->members) {
+      if(member.first == key) {
+	 return &member.second;
+      }
+   }
+   return NULL;
+}
+
+static const JsonValue *json_item(const JsonValue *array, size_t index) {
+   if(!array || array->type != JSON_ARRAY || index >= array->items.size()) {
+      return NULL;
+   }
+   return &array->items[index];
+}
+
+static double json_number(const JsonValue *object, const char *key, double fallback) {
+   const JsonValue *value = json_get(object, key);
+   return value && value->type == JSON_NUMBER ? value->number : fallback;
+}
+// @!
+
+
+// @@ glTF 2.0
+const uint32_t GLB_MAGIC = 0x46546c67;      // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4e4f534a; // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004e4942;  // "BIN\0"
+
+const int GLTF_BYTE = 5120;
+const int GLTF_UNSIGNED_BYTE = 5121;
+const int GLTF_SHORT = 5122;
+const int GLTF_UNSIGNED_SHORT = 5123;
+const int GLTF_UNSIGNED_INT = 5125;
+const int GLTF_FLOAT = 5126;
+const int GLTF_TRIANGLES = 4;
+
+struct GltfBuffer {
+   const unsigned char *data;
+   size_t size;
+};
+
+struct GltfDocument {
+   JsonValue json;
+   FileMapping file;
+   std::vector<FileMapping> external_files;
+   std::vector<std::vector<unsigned char>> decoded_buffers;
+   std::vector<GltfBuffer> buffers;
+};
+
+// one element per count, stride bytes apart
+struct GltfAccessor {
+   const unsigned char *data;
+   size_t count;
+   size_t stride;
+   int component_type;
+   int components;
+   bool normalized;
+};
+
+struct GltfPrimitive {
+   GltfAccessor positions;
+   GltfAccessor normals;
+   GltfAccessor uvs;
+   GltfAccessor indices;
+   bool has_normals;
+   bool has_uvs;
+   bool has_indices;
+   glm::mat4 transform;
+   size_t triangle_count;
+   size_t triangle_base;
+};
+
+static bool decode_base64(const char *text, size_t length, std::vector<unsigned char> *out) {
+   uint32_t bits = 0;
+   int bit_count = 0;
+   for(size_t i = 0; i < length && text[i] != '='; ++i) {
+      char c = text[i];
+      int value = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26 :
+	 c >= '0' && c <= '9' ? c - '0' + 52 : c == '+' ? 62 : c == '/' ? 63 : -1;
+      if(value < 0) {
+	 return false;
+      }
+      bits = (bits << 6) | value;
+      bit_count += 6;
+      if(bit_count >= 8) {
+	 bit_count -= 8;
+	 out->push_back((unsigned char)(bits >> bit_count));
+      }
+   }
+   return true;
+}
+
+static std::string decode_uri(const std::string &uri) {
+   std::string decoded;
+   for(size_t i = 0; i < uri.size(); ++i) {
+      uint32_t value;
+      char hex[4] = {'0', '0', 0, 0};
+      if(uri[i] == '%' && i + 2 < uri.size()) {
+	 hex[2] = uri[i + 1];
+	 hex[3] = uri[i + 2];
+	 if(parse_json_hex4(hex, hex + 4, &value)) {
+	    decoded.push_back((char)value);
+	    i += 2;
+	    continue;
+	 }
+      }
+      decoded.push_back(uri[i]);
+   }
+   return decoded;
+}
+
+static void gltf_close(GltfDocument *document) {
+   if(document->file.data) {
+      file_map_close(&document->file);
+   }
+   for(FileMapping &mapping : document->external_files) {
+      file_map_close(&mapping);
+   }
+   document->external_files.clear();
+}
+
+static bool gltf_open(std::string path, GltfDocument *document) {
+   document->file.data = NULL;
+   if(!file_map_open(path, &document->file)) {
+      std::cerr << "ERROR: could not open mesh: " << path << '\n';
+      return false;
+   }
+
+   // @@ .glb is a JSON chunk then an optional binary chunk, .gltf is the JSON alone
+   const unsigned char *data = document->file.data;
+   size_t size = document->file.size;
+   const char *json_begin = (const char *)data;
+   const char *json_end = json_begin + size;
+   GltfBuffer glb_binary = {NULL, 0};
+   uint32_t magic = 0;
+   if(size >= 4) {
+      memcpy(&magic, data, 4);
+   }
+   if(magic == GLB_MAGIC) {
+      uint32_t header[3];
+      uint32_t chunk[2];
+      if(size < 20) {
+	 return false;
+      }
+      memcpy(header, data, sizeof(header));
+      memcpy(chunk, data + 12, sizeof(chunk));
+      if(header[1] != 2 || chunk[1] != GLB_CHUNK_JSON || 20 + (size_t)chunk[0] > size) {
+	 std::cerr << "ERROR: not a glTF 2.0 binary: " << path << '\n';
+	 return false;
+      }
+      json_begin = (const char *)data + 20;
+      json_end = json_begin + chunk[0];
+      size_t binary_offset = 20 + (size_t)chunk[0];
+      if(binary_offset + 8 <= size) {
+	 memcpy(chunk, data + binary_offset, sizeof(chunk));
+	 if(chunk[1] == GLB_CHUNK_BIN && binary_offset + 8 + chunk[0] <= size) {
+	    glb_binary = GltfBuffer{data + binary_offset + 8, chunk[0]};
+	 }
+      }
+   }
+   if(!parse_json(json_begin, json_end, &document->json, 0) || document->json.type != JSON_OBJECT) {
+      std::cerr << "ERROR: could not parse glTF JSON: " << path << '\n';
+      return false;
+   }
+   // @!
+
+   // @@ buffers, the GLB chunk, base64 data URIs or files next to the document
+   const JsonValue *buffers = json_get(&document->json, "buffers");
+   size_t buffer_count = buffers && buffers->type == JSON_ARRAY ? buffers->items.size() : 0;
+   document->decoded_buffers.resize(buffer_count);
+   std::filesystem::path directory = std::filesystem::path(path).parent_path();
+   for(size_t i = 0; i < buffer_count; ++i) {
+      const JsonValue *uri = json_get(&buffers->items[i], "uri");
+      GltfBuffer buffer = {NULL, 0};
+      if(!uri || uri->type != JSON_STRING) {
+	 buffer = glb_binary;
+      } else if(uri->string.compare(0, 5, "data:") == 0) {
+	 size_t comma = uri->string.find(',');
+	 if(comma == std::string::npos || uri->string.rfind(";base64", comma) == std::string::npos ||
+	    !decode_base64(uri->string.c_str() + comma + 1, uri->string.size() - comma - 1,
+			   &document->decoded_buffers[i])) {
+	    std::cerr << "ERROR: unsupported glTF data URI in " << path << '\n';
+	    return false;
+	 }
+	 buffer = GltfBuffer{document->decoded_buffers[i].data(), document->decoded_buffers[i].size()};
+      } else {
+	 FileMapping mapping;
+	 std::string buffer_path = (directory / decode_uri(uri->string)).string();
+	 if(!file_map_open(buffer_path, &mapping)) {
+	    std::cerr << "ERROR: could not open glTF buffer: " << buffer_path << '\n';
+	    return false;
+	 }
+	 document->external_files.push_back(mapping);
+	 buffer = GltfBuffer{mapping.data, mapping.size};
+      }
+      if(buffer.size < (size_t)json_number(&buffers->items[i], "byteLength", 0.0)) {
+	 std::cerr << "ERROR: glTF buffer " << i << " is shorter than its byteLength in " << path << '\n';
+	 return false;
+      }
+      document->buffers.push_back(buffer);
+   }
+   // @!
+
+   return true;
+}
+
+static bool gltf_accessor(const GltfDocument *document, int index, GltfAccessor *accessor) {
+   const JsonValue *json = json_item(json_get(&document->json, "accessors"), index);
+   if(!json) {
+      return false;
+   }
+   if(json_get(json, "sparse")) {
+      printf("@DEV_WARNING: sparse glTF accessors are not supported.\n");
+      return false;
+   }
+   const JsonValue *view = json_item(json_get(&document->json, "bufferViews"), (int)json_number(json, "bufferView", -1));
+   if(!view) {
+      return false;
+   }
+   int buffer_index = (int)json_number(view, "buffer", -1);
+   if(buffer_index < 0 || buffer_index >= (int)document->buffers.size()) {
+      return false;
+   }
+
+   const JsonValue *type = json_get(json, "type");
+   std::string type_name = type && type->type == JSON_STRING ? type->string : "";
+   accessor->components = type_name == "SCALAR" ? 1 : type_name == "VEC2" ? 2 : type_name == "VEC3" ? 3 :
+      type_name == "VEC4" ? 4 : 0;
+   accessor->component_type = (int)json_number(json, "componentType", 0);
+   accessor->normalized = json_get(json, "normalized") && json_get(json, "normalized")->boolean;
+   accessor->count = (size_t)json_number(json, "count", 0);
+   size_t component_size = accessor->component_type == GLTF_BYTE || accessor->component_type == GLTF_UNSIGNED_BYTE ? 1 :
+      accessor->component_type == GLTF_SHORT || accessor->component_type == GLTF_UNSIGNED_SHORT ? 2 :
+      accessor->component_type == GLTF_UNSIGNED_INT || accessor->component_type == GLTF_FLOAT ? 4 : 0;
+   size_t element_size = component_size * accessor->components;
+   if(!element_size) {
+      return false;
+   }
+   accessor->stride = (size_t)json_number(view, "byteStride", 0);
+   if(accessor->stride == 0) {
+      accessor->stride = element_size;
+   }
+
+   // everything the accessor reads has to sit inside its view, and the view inside its buffer
+   const GltfBuffer &buffer = document->buffers[buffer_index];
+   size_t view_offset = (size_t)json_number(view, "byteOffset", 0);
+   size_t view_length = (size_t)json_number(view, "byteLength", 0);
+   size_t accessor_offset = (size_t)json_number(json, "byteOffset", 0);
+   if(view_offset + view_length > buffer.size ||
+      (accessor->count && accessor_offset + accessor->stride * (accessor->count - 1) + element_size > view_length)) {
+      return false;
+   }
+   accessor->data = buffer.data + view_offset + accessor_offset;
+   return true;
+}
+
+static float gltf_read_float(const GltfAccessor &accessor, size_t element, int component) {
+   const unsigned char *source = accessor.data + element * accessor.stride;
+   switch(accessor.component_type) {
+      case GLTF_FLOAT: {
+	 float value;
+	 memcpy(&value, source + component * 4, 4);
+	 return value;
+      }
+      case GLTF_BYTE: {
+	 int8_t value = (int8_t)source[component];
+	 return accessor.normalized ? std::max(value / 127.0f, -1.0f) : value;
+      }
+      case GLTF_UNSIGNED_BYTE: {
+	 return accessor.normalized ? source[component] / 255.0f : source[component];
+      }
+      case GLTF_SHORT: {
+	 int16_t value;
+	 memcpy(&value, source + component * 2, 2);
+	 return accessor.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+      }
+      case GLTF_UNSIGNED_SHORT: {
+	 uint16_t value;
+	 memcpy(&value, source + component * 2, 2);
+	 return accessor.normalized ? value / 65535.0f : value;
+      }
+      case GLTF_UNSIGNED_INT: {
+	 uint32_t value;
+	 memcpy(&value, source + component * 4, 4);
+	 return (float)value;
+      }
+   }
+   return 0.0f;
+}
+
+static uint32_t gltf_read_index(const GltfAccessor &accessor, size_t element) {
+   const unsigned char *source = accessor.data + element * accessor.stride;
+   if(accessor.component_type == GLTF_UNSIGNED_BYTE) {
+      return source[0];
+   }
+   if(accessor.component_type == GLTF_UNSIGNED_SHORT) {
+      uint16_t value;
+      memcpy(&value, source, 2);
+      return value;
+   }
+   uint32_t value;
+   memcpy(&value, source, 4);
+   return value;
+}
+
+static glm::mat4 gltf_node_transform(const JsonValue *node) {
+   const JsonValue *matrix = json_get(node, "matrix");
+   if(matrix && matrix->type == JSON_ARRAY && matrix->items.size() == 16) {
+      // column major, like glm
+      glm::mat4 result;
+      for(int i = 0; i < 16; ++i) {
+	 result[i / 4][i % 4] = (float)matrix->items[i].number;
+      }
+      return result;
+   }
+
+   glm::vec3 translation(0.0f);
+   glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+   glm::vec3 scale(1.0f);
+   const JsonValue *t = json_get(node, "translation");
+   const JsonValue *r = json_get(node, "rotation");
+   const JsonValue *s = json_get(node, "scale");
+   if(t && t->type == JSON_ARRAY && t->items.size() == 3) {
+      translation = glm::vec3(t->items[0].number, t->items[1].number, t->items[2].number);
+   }
+   if(r && r->type == JSON_ARRAY && r->items.size() == 4) {
+      // glTF stores x, y, z, w
+      rotation = glm::quat((float)r->items[3].number, (float)r->items[0].number, (float)r->items[1].number,
+			   (float)r->items[2].number);
+   }
+   if(s && s->type == JSON_ARRAY && s->items.size() == 3) {
+      scale = glm::vec3(s->items[0].number, s->items[1].number, s->items[2].number);
+   }
+   return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+static void gltf_collect_node(const GltfDocument *document, int node_index, glm::mat4 parent, int depth,
+			      std::vector<std::pair<int, glm::mat4>> *instances) {
+   const JsonValue *node = json_item(json_get(&document->json, "nodes"), node_index);
+   if(!node || depth > 64) {
+      return;
+   }
+   glm::mat4 transform = parent * gltf_node_transform(node);
+   int mesh = (int)json_number(node, "mesh", -1);
+   if(mesh >= 0) {
+      instances->push_back({mesh, transform});
+   }
+   const JsonValue *children = json_get(node, "children");
+   if(children && children->type == JSON_ARRAY) {
+      for(const JsonValue &child : children->items) {
+	 gltf_collect_node(document, (int)child.number, transform, depth + 1, instances);
+      }
+   }
+}
+
+static void gltf_build_triangles(const GltfPrimitive &primitive, size_t begin, size_t end, float *soup) {
+   glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(primitive.transform)));
+   // a mirroring transform turns the winding around, swap two corners to keep the front facing out
+   bool mirrored = glm::determinant(glm::mat3(primitive.transform)) < 0.0f;
+
+   for(size_t t = begin; t < end; ++t) {
+      float *triangle = soup + (primitive.triangle_base + t) * 3 * MESH_SOUP_FLOATS;
+      for(int k = 0; k < 3; ++k) {
+	 int corner = mirrored && k > 0 ? 3 - k : k;
+	 size_t element = primitive.has_indices ? gltf_read_index(primitive.indices, t * 3 + corner) : t * 3 + corner;
+	 if(element >= primitive.positions.count) {
+	    element = 0;
+	 }
+	 float *vertex = triangle + k * MESH_SOUP_FLOATS;
+
+	 glm::vec4 position(gltf_read_float(primitive.positions, element, 0),
+			    gltf_read_float(primitive.positions, element, 1),
+			    gltf_read_float(primitive.positions, element, 2), 1.0f);
+	 position = primitive.transform * position;
+	 vertex[0] = position.x;
+	 vertex[1] = position.y;
+	 vertex[2] = position.z;
+	 if(primitive.has_normals && element < primitive.normals.count) {
+	    glm::vec3 normal = normal_matrix * glm::vec3(gltf_read_float(primitive.normals, element, 0),
+							 gltf_read_float(primitive.normals, element, 1),
+							 gltf_read_float(primitive.normals, element, 2));
+	    float length = glm::length(normal);
+	    normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+	    vertex[3] = normal.x;
+	    vertex[4] = normal.y;
+	    vertex[5] = normal.z;
+	 }
+	 vertex[6] = 0.0f;
+	 vertex[7] = 0.0f;
+	 if(primitive.has_uvs && element < primitive.uvs.count) {
+	    vertex[6] = gltf_read_float(primitive.uvs, element, 0);
+	    vertex[7] = 1.0f - gltf_read_float(primitive.uvs, element, 1);
+	 }
+      }
+      if(!primitive.has_normals) {
+	 glm::vec3 normal = triangle_normal(triangle, triangle + MESH_SOUP_FLOATS, triangle + 2 * MESH_SOUP_FLOATS);
+	 for(int k = 0; k < 3; ++k) {
+	    memcpy(triangle + k * MESH_SOUP_FLOATS + 3, &normal[0], 3 * sizeof(float));
+	 }
+      }
+   }
+}
+
+bool mesh_import_gltf(ThreadPool *pool, std::string path, Mesh *mesh) {
+   GltfDocument document;
+   if(!gltf_open(path, &document)) {
+      gltf_close(&document);
+      return false;
+   }
+
+   // @@ mesh instances of the default scene, every mesh once when there is no scene at all
+   std::vector<std::pair<int, glm::mat4>> instances;
+   const JsonValue *scenes = json_get(&document.json, "scenes");
+   const JsonValue *scene = json_item(scenes, (int)json_number(&document.json, "scene", 0));
+   const JsonValue *scene_nodes = json_get(scene, "nodes");
+   if(scene_nodes && scene_nodes->type == JSON_ARRAY) {
+      for(const JsonValue &node : scene_nodes->items) {
+	 gltf_collect_node(&document, (int)node.number, glm::mat4(1.0f), 0, &instances);
+      }
+   } else {
+      const JsonValue *meshes = json_get(&document.json, "meshes");
+      for(size_t i = 0; meshes && meshes->type == JSON_ARRAY && i < meshes->items.size(); ++i) {
+	 instances.push_back({(int)i, glm::mat4(1.0f)});
+      }
+   }
+   // @!
+
+   // @@ resolve every triangle primitive up front so the soup can be sized and split across the pool
+   std::vector<GltfPrimitive> primitives;
+   size_t triangle_count = 0;
+   for(auto &instance : instances) {
+      const JsonValue *json_mesh = json_item(json_get(&document.json, "meshes"), instance.first);
+      const JsonValue *json_primitives = json_get(json_mesh, "primitives");
+      for(size_t i = 0; json_primitives && json_primitives->type == JSON_ARRAY && i < json_primitives->items.size(); ++i) {
+	 const JsonValue *json_primitive = &json_primitives->items[i];
+	 if((int)json_number(json_primitive, "mode", GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+	    printf("@DEV_WARNING: skipping non triangle primitive in %s\n", path.c_str());
+	    continue;
+	 }
+	 const JsonValue *attributes = json_get(json_primitive, "attributes");
+	 GltfPrimitive primitive;
+	 primitive.transform = instance.second;
+	 if(!gltf_accessor(&document, (int)json_number(attributes, "POSITION", -1), &primitive.positions) ||
+	    primitive.positions.component_type != GLTF_FLOAT || primitive.positions.components != 3) {
+	    printf("@DEV_WARNING: skipping primitive without usable positions in %s\n", path.c_str());
+	    continue;
+	 }
+	 primitive.has_normals = gltf_accessor(&document, (int)json_number(attributes, "NORMAL", -1), &primitive.normals) &&
+	    primitive.normals.components == 3;
+	 primitive.has_uvs = gltf_accessor(&document, (int)json_number(attributes, "TEXCOORD_0", -1), &primitive.uvs) &&
+	    primitive.uvs.components == 2;
+	 // indices that are there but unusable would turn the primitive into a soup of its raw positions
+	 primitive.has_indices = json_get(json_primitive, "indices") != NULL;
+	 if(primitive.has_indices &&
+	    (!gltf_accessor(&document, (int)json_number(json_primitive, "indices", -1), &primitive.indices) ||
+	     primitive.indices.components != 1)) {
+	    printf("@DEV_WARNING: skipping primitive with unusable indices in %s\n", path.c_str());
+	    continue;
+	 }
+	 primitive.triangle_count = (primitive.has_indices ? primitive.indices.count : primitive.positions.count) / 3;
+	 primitive.triangle_base = triangle_count;
+	 triangle_count += primitive.triangle_count;
+	 primitives.push_back(primitive);
+      }
+   }
+   // @!
+
+   std::vector<float> soup(triangle_count * 3 * MESH_SOUP_FLOATS);
+   const int triangles_per_job = 16384;
+   for(const GltfPrimitive &primitive : primitives) {
+      thread_pool_parallel_for(pool, (int)primitive.triangle_count, triangles_per_job,
+			       [&primitive, &soup](int begin, int end) {
+				  gltf_build_triangles(primitive, begin, end, soup.data());
+			       });
+   }
+   gltf_close(&document);
+
+   mesh_build(soup.data(), (int)(triangle_count * 3), MESH_SOUP_FLOATS, mesh);
+   return true;
+}
+// @!
+
+
+bool mesh_import(ThreadPool *pool, std::string path, Mesh *mesh) {
+   std::string extension = std::filesystem::path(path).extension().string();
+   std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+   if(extension == ".obj") {
+      return mesh_import_obj(pool, path, mesh);
+   }
+   if(extension == ".gltf" || extension == ".glb") {
+      return mesh_import_gltf(pool, path, mesh);
+   }
+   std::cerr << "ERROR: unknown mesh format: " << path << '\n';
+   return false;
+}
+
+
+// @@ binary mesh cache
+const uint32_t MESH_CACHE_MAGIC = 0x48534d4c; // "LMSH"
+const uint32_t MESH_CACHE_VERSION = 1;
+
+struct MeshCacheHeader {
+   uint32_t magic;
+   uint32_t version;
+   uint64_t layout_signature;
+   uint32_t stride;
+   uint32_t vertex_count;
+   uint64_t index_count;
+   float position_center[3];
+   float position_extent[3];
+   uint64_t vertex_offset;
+   uint64_t index_offset;
+};
+
+// changes whenever ObjectVertexLayout does, so old caches are rebuilt instead of misread
+static uint64_t layout_signature() {
+   uint64_t signature = hash_bytes(&ObjectVertexLayout::stride, sizeof(ObjectVertexLayout::stride));
+   for(const VertexAttributeFormat &attribute : ObjectVertexLayout::attributes) {
+      uint32_t fields[5] = {attribute.location, (uint32_t)attribute.size, attribute.type, attribute.normalized,
+			    attribute.offset};
+      signature = hash_bytes(fields, sizeof(fields), signature);
+   }
+   return signature;
+}
+
+static bool mesh_file_point(const unsigned char *data, size_t size, MeshFile *file) {
+   MeshCacheHeader header;
+   if(size < sizeof(header)) {
+      return false;
+   }
+   memcpy(&header, data, sizeof(header));
+   uint64_t vertex_bytes = (uint64_t)header.vertex_count * header.stride;
+   if(header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION ||
+      header.layout_signature != layout_signature() || header.stride != (uint32_t)ObjectVertexLayout::stride ||
+      header.vertex_offset > size || vertex_bytes > size - header.vertex_offset ||
+      header.index_offset > size || header.index_count > (size - header.index_offset) / 4 ||
+      header.index_offset % 4 != 0 || header.index_count % 3 != 0) {
+      return false;
+   }
+
+   // a stale or corrupt index would fetch outside this mesh's vertices once it sits in the shared arena.
+   // one pass over the indices is cheap next to the copy into the arena that follows
+   const uint32_t *indices = (const uint32_t *)(data + header.index_offset);
+   uint32_t max_index = 0;
+   for(uint64_t i = 0; i < header.index_count; ++i) {
+      max_index = std::max(max_index, indices[i]);
+   }
+   if(header.index_count > 0 && max_index >= header.vertex_count) {
+      return false;
+   }
+
+   file->vertex_data = data + header.vertex_offset;
+   file->vertex_bytes = vertex_bytes;
+   file->index_data = indices;
+   file->index_count = header.index_count;
+   file->vertex_count = header.vertex_count;
+   file->quantization.position_center = glm::vec3(header.position_center[0], header.position_center[1],
+						   header.position_center[2]);
+   file->quantization.position_extent = glm::vec3(header.position_extent[0], header.position_extent[1],
+						   header.position_extent[2]);
+   return true;
+}
+
+bool mesh_cache_load(ThreadPool *pool, std::string cache_dir, std::string source_path, MeshFile *file) {
+   file->mapping.data = NULL;
+   file->heap_data.clear();
+   file->imported = false;
+
+   // @@ key from the file system alone, hashing a large model would cost more than the warm load itself
+   std::error_code error;
+   uint64_t source_size = std::filesystem::file_size(source_path, error);
+   if(error) {
+      std::cerr << "ERROR: could not find mesh: " << source_path << '\n';
+      return false;
+   }
+   long long write_time = (long long)std::filesystem::last_write_time(source_path, error).time_since_epoch().count();
+   uint64_t key_params[4] = {MESH_CACHE_VERSION, source_size, (uint64_t)write_time, layout_signature()};
+   uint64_t key = hash_bytes(source_path.data(), source_path.size());
+   key = hash_bytes(key_params, sizeof(key_params), key);
+   char key_string[17];
+   snprintf(key_string, sizeof(key_string), "%016llx", (unsigned long long)key);
+   std::string cache_path = cache_dir + "/" + key_string + ".meshcache";
+   // @!
+
+   if(file_map_open(cache_path, &file->mapping)) {
+      if(mesh_file_point(file->mapping.data, file->mapping.size, file)) {
+	 return true;
+      }
+      file_map_close(&file->mapping);
+      file->mapping.data = NULL;
+   }
+
+   // @@ cold path: import, encode into the GPU layout, persist for next launch
+   Mesh mesh;
+   if(!mesh_import(pool, source_path, &mesh)) {
+      return false;
+   }
+   mesh_print_stats(source_path.c_str(), &mesh);
+   VertexQuantization quantization = vertex_quantization_from_mesh(&mesh);
+   std::vector<ObjectVertexLayout::Vertex> vertices;
+   ObjectVertexLayout::encode(&mesh, quantization, &vertices);
+
+   MeshCacheHeader header;
+   memset(&header, 0, sizeof(header));
+   header.magic = MESH_CACHE_MAGIC;
+   header.version = MESH_CACHE_VERSION;
+   header.layout_signature = layout_signature();
+   header.stride = ObjectVertexLayout::stride;
+   header.vertex_count = (uint32_t)vertices.size();
+   header.index_count = mesh.indices.size();
+   for(int axis = 0; axis < 3; ++axis) {
+      header.position_center[axis] = quantization.position_center[axis];
+      header.position_extent[axis] = quantization.position_extent[axis];
+   }
+   size_t vertex_bytes = vertices.size() * sizeof(ObjectVertexLayout::Vertex);
+   header.vertex_offset = (sizeof(header) + 15) & ~(size_t)15;
+   header.index_offset = (header.vertex_offset + vertex_bytes + 15) & ~(size_t)15;
+
+   file->heap_data.assign(header.index_offset + mesh.indices.size() * sizeof(uint32_t), 0);
+   memcpy(file->heap_data.data(), &header, sizeof(header));
+   memcpy(file->heap_data.data() + header.vertex_offset, vertices.data(), vertex_bytes);
+   memcpy(file->heap_data.data() + header.index_offset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+
+   std::filesystem::create_directories(cache_dir, error);
+   if(file_write_atomic(cache_path, file->heap_data.data(), file->heap_data.size()) &&
+      file_map_open(cache_path, &file->mapping)) {
+      file->heap_data.clear();
+      file->heap_data.shrink_to_fit();
+      mesh_file_point(file->mapping.data, file->mapping.size, file);
+   } else {
+      printf("@DEV_WARNING: could not write mesh cache %s\n", cache_path.c_str());
+      mesh_file_point(file->heap_data.data(), file->heap_data.size(), file);
+   }
+   file->imported = true;
+   // @!
+
+   return true;
+}
+
+
+void mesh_file_close(MeshFile *file) {
+   if(file->mapping.data) {
+      file_map_close(&file->mapping);
+      file->mapping.data = NULL;
+   }
+   file->heap_data.clear();
+   file->heap_data.shrink_to_fit();
+   file->vertex_data = NULL;
+   file->index_data = NULL;
+}
+// @!
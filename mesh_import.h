@@ -0,0 +1,58 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file_map.h"
+#include "mesh.h"
+#include "thread_pool.h"
+#include "vertex_layout.h"
+
+
+// @@ importers, both produce 8 float vertices (position, normal, uv) run through mesh_build
+// OBJ: v/vt/vn/f only, polygons are fanned, missing normals become face normals
+// glTF 2.0 (.gltf with external or base64 buffers, or .glb): triangle primitives of the default scene
+// with node transforms applied, POSITION, NORMAL and TEXCOORD_0. uvs are flipped to the bottom left
+// origin the texture loader uses
+bool mesh_import_obj(ThreadPool *pool, std::string path, Mesh *mesh);
+bool mesh_import_gltf(ThreadPool *pool, std::string path, Mesh *mesh);
+// picks the importer by extension
+bool mesh_import(ThreadPool *pool, std::string path, Mesh *mesh);
+// @!
+
+
+// @@ binary mesh cache, ObjectVertexLayout vertices and 32 bit indices exactly as the GPU buffers
+// want them. a warm load maps the file and does no per vertex work at all
+// the data pointers go into mapping, or into heap_data when the cache could not be written
+struct MeshFile {
+   FileMapping mapping;
+   std::vector<unsigned char> heap_data;
+   const void *vertex_data;
+   size_t vertex_bytes;
+   const uint32_t *index_data;
+   size_t index_count;
+   uint32_t vertex_count;
+   VertexQuantization quantization;
+   bool imported;
+};
+
+// keyed on source path, size and modification time, so a warm load never reads the source. a miss
+// imports with parsing spread over pool and waits for it, so never call this from a pool job
+bool mesh_cache_load(ThreadPool *pool, std::string cache_dir, std::string source_path, MeshFile *file);
+void mesh_file_close(MeshFile *file);
+// @!
@@ -0,0 +1,681 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "shader.h"
+
+#include "file_map.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+
+const uint32_t SHADER_CACHE_MAGIC = 0x4250534c; // "LSPB"
+const uint32_t SHADER_CACHE_VERSION = 1;
+
+struct ShaderCacheHeader {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t binary_format;
+   uint32_t binary_size;
+};
+
+
+void shader_cache_init(ShaderCache *cache, std::string cache_dir, bool batch, bool parallel_compile) {
+   cache->cache_dir = cache_dir;
+   cache->permutations.clear();
+   cache->permutations_reused = 0;
+   cache->pending.clear();
+   cache->reloads.clear();
+   cache->batch = batch;
+   cache->parallel_compile = parallel_compile;
+   cache->programs_loaded = 0;
+   cache->programs_compiled = 0;
+   cache->binaries_rejected = 0;
+   cache->seconds = 0.0;
+   cache->wait_seconds = 0.0;
+
+   GLint binary_format_count = 0;
+   if(glGetProgramBinary && glProgramBinary && glProgramParameteri) {
+      glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_format_count);
+   }
+   cache->enabled = binary_format_count > 0;
+   if(!cache->enabled) {
+      printf("@DEV_WARNING: no program binary formats, shader cache disabled.\n");
+      return;
+   }
+
+   // @@ a binary is only good for the exact driver that produced it
+   std::string driver = std::string{(const char *)glGetString(GL_VENDOR)} + '\n' +
+      (const char *)glGetString(GL_RENDERER) + '\n' + (const char *)glGetString(GL_VERSION);
+   cache->driver_key = hash_bytes(driver.data(), driver.size());
+   cache->driver_key = hash_bytes(&SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION), cache->driver_key);
+   // @!
+
+   std::error_code error;
+   std::filesystem::create_directories(cache_dir, error);
+}
+
+
+void shader_cache_print(ShaderCache *cache) {
+   printf("shader programs: %d from cache, %d compiled, %d binaries rejected, %d permutations reused\n",
+	  cache->programs_loaded, cache->programs_compiled, cache->binaries_rejected, cache->permutations_reused);
+   printf("shader startup: %.1f ms, %.1f ms of it waiting on status (%s%s)\n", cache->seconds * 1000.0,
+	  cache->wait_seconds * 1000.0, cache->batch ? "batched" : "one at a time",
+	  cache->parallel_compile ? ", parallel compile" : "");
+}
+
+
+// @@ preprocessor
+const int SHADER_MAX_INCLUDE_DEPTH = 16;
+
+static bool preprocess_file(std::string path, int depth, std::string *source,
+			    std::vector<std::string> *source_files) {
+   std::ifstream inf{path};
+   if(!inf) {
+      std::cerr << "ERROR: could not open shader " << path << '\n';
+      return false;
+   }
+   if(depth > SHADER_MAX_INCLUDE_DEPTH) {
+      std::cerr << "ERROR: shader includes nested too deep at " << path << '\n';
+      return false;
+   }
+
+   std::string file_number = std::to_string(source_files->size());
+   source_files->push_back(path);
+   std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+   std::string line;
+   int line_number = 0;
+   while(std::getline(inf, line)) {
+      line_number += 1;
+      if(!line.empty() && line.back() == '\r') {
+	 line.pop_back();
+      }
+
+      size_t first = line.find_first_not_of(" \t");
+      if(first == std::string::npos || line.compare(first, 8, "#include") != 0) {
+	 *source += line;
+	 *source += '\n';
+	 continue;
+      }
+
+      size_t open = line.find('"', first + 8);
+      size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+      if(close == std::string::npos) {
+	 std::cerr << "ERROR: malformed #include at " << path << ":" << line_number << '\n';
+	 return false;
+      }
+      std::string include_path = (directory / line.substr(open + 1, close - open - 1)).lexically_normal().generic_string();
+      if(std::find(source_files->begin(), source_files->end(), include_path) == source_files->end()) {
+	 *source += "#line 1 " + std::to_string(source_files->size()) + "\n";
+	 if(!preprocess_file(include_path, depth + 1, source, source_files)) {
+	    return false;
+	 }
+      }
+      *source += "#line " + std::to_string(line_number + 1) + " " + file_number + "\n";
+   }
+   return true;
+}
+
+bool shader_preprocess(std::string path, const ShaderDefines &defines, std::string *source,
+		       std::vector<std::string> *source_files) {
+   source->clear();
+   source_files->clear();
+   path = std::filesystem::path(path).lexically_normal().generic_string();
+   if(!preprocess_file(path, 0, source, source_files)) {
+      return false;
+   }
+   if(defines.empty()) {
+      return true;
+   }
+
+   // #version has to stay the first thing the compiler sees, defines go in right behind it
+   size_t insert_at = 0;
+   int next_line = 1;
+   if(source->compare(0, 8, "#version") == 0) {
+      insert_at = source->find('\n') + 1;
+      next_line = 2;
+   }
+   std::string define_text;
+   for(const ShaderDefine &define : defines) {
+      define_text += "#define " + define.name + (define.value.empty() ? "" : " " + define.value) + "\n";
+   }
+   define_text += "#line " + std::to_string(next_line) + " 0\n";
+   source->insert(insert_at, define_text);
+   return true;
+}
+
+static void print_source_files(const std::vector<std::string> &source_files) {
+   for(size_t i = 0; i < source_files.size(); ++i) {
+      std::cout << "  source string " << i << ": " << source_files[i] << '\n';
+   }
+}
+
+
+// @@ reflection
+static std::string strip_array_suffix(const char *name) {
+   std::string result{name};
+   size_t bracket = result.find('[');
+   if(bracket != std::string::npos) {
+      result.resize(bracket);
+   }
+   return result;
+}
+
+static void reflect_program(ShaderProgram *program) {
+   GLchar name[256];
+   program->uniforms.clear();
+   program->attributes.clear();
+   program->uniform_blocks.clear();
+
+   GLint uniform_count = 0;
+   glGetProgramiv(program->id, GL_ACTIVE_UNIFORMS, &uniform_count);
+   for(GLint i = 0; i < uniform_count; ++i) {
+      ShaderUniform uniform;
+      GLsizei length;
+      GLuint index = (GLuint)i;
+      glGetActiveUniform(program->id, index, sizeof(name), &length, &uniform.array_size, &uniform.type, name);
+      glGetActiveUniformsiv(program->id, 1, &index, GL_UNIFORM_BLOCK_INDEX, &uniform.block_index);
+      uniform.name = strip_array_suffix(name);
+      uniform.location = uniform.block_index < 0 ? glGetUniformLocation(program->id, name) : -1;
+      program->uniforms.push_back(uniform);
+   }
+
+   GLint attribute_count = 0;
+   glGetProgramiv(program->id, GL_ACTIVE_ATTRIBUTES, &attribute_count);
+   for(GLint i = 0; i < attribute_count; ++i) {
+      ShaderAttribute attribute;
+      GLsizei length;
+      GLint size;
+      glGetActiveAttrib(program->id, (GLuint)i, sizeof(name), &length, &size, &attribute.type, name);
+      attribute.name = name;
+      attribute.location = glGetAttribLocation(program->id, name);
+      program->attributes.push_back(attribute);
+   }
+
+   GLint block_count = 0;
+   glGetProgramiv(program->id, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+   for(GLint i = 0; i < block_count; ++i) {
+      ShaderUniformBlock block;
+      GLsizei length;
+      block.index = (GLuint)i;
+      glGetActiveUniformBlockName(program->id, block.index, sizeof(name), &length, name);
+      glGetActiveUniformBlockiv(program->id, block.index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.data_size);
+      block.name = name;
+      program->uniform_blocks.push_back(block);
+   }
+}
+
+static void bind_uniform_blocks(ShaderProgram *program) {
+   static const struct { const char *name; GLuint binding; } fixed_blocks[] = {
+      {"Camera", CAMERA_BLOCK_BINDING},
+      {"GpuCull", GPU_CULL_BLOCK_BINDING},
+   };
+   for(const ShaderUniformBlock &block : program->uniform_blocks) {
+      bool known = false;
+      for(const auto &fixed : fixed_blocks) {
+	 if(block.name == fixed.name) {
+	    glUniformBlockBinding(program->id, block.index, fixed.binding);
+	    known = true;
+	 }
+      }
+      if(!known) {
+	 printf("@DEV_WARNING: uniform block %s in %s has no fixed binding\n", block.name.c_str(),
+		program->vert_path.c_str());
+      }
+   }
+}
+
+static bool is_sampler_type(GLenum type) {
+   switch(type) {
+   case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_2D_ARRAY:
+   case GL_SAMPLER_2D_SHADOW: case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D:
+   case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY: case GL_SAMPLER_BUFFER:
+      return true;
+   default:
+      return false;
+   }
+}
+
+// returns -1 for unknown names, exits on a type mismatch like any other broken shader
+static GLint find_uniform(ShaderProgram *program, const std::string &name, GLenum expected_type) {
+   if(!program->ready) {
+      std::cerr << "ERROR: uniform " << name << " looked up in " << program->vert_path << " + "
+		<< program->frag_path << " before it finished compiling" << '\n';
+      exit(1);
+   }
+   for(const ShaderUniform &uniform : program->uniforms) {
+      if(uniform.name != name) {
+	 continue;
+      }
+      bool matches = expected_type == GL_SAMPLER_2D ? is_sampler_type(uniform.type) :
+	 uniform.type == expected_type || (expected_type == GL_INT && uniform.type == GL_BOOL);
+      if(!matches) {
+	 std::cerr << "ERROR: uniform " << name << " in " << program->vert_path << " + " << program->frag_path
+		   << " has type 0x" << std::hex << uniform.type << ", expected 0x" << expected_type << std::dec
+		   << '\n';
+	 exit(1);
+      }
+      return uniform.location;
+   }
+   return -1;
+}
+// @!
+
+
+UniformInt shader_uniform_int(ShaderProgram *program, std::string name) {
+   return UniformInt{find_uniform(program, name, GL_INT)};
+}
+
+UniformFloat shader_uniform_float(ShaderProgram *program, std::string name) {
+   return UniformFloat{find_uniform(program, name, GL_FLOAT)};
+}
+
+UniformVec3 shader_uniform_vec3(ShaderProgram *program, std::string name) {
+   return UniformVec3{find_uniform(program, name, GL_FLOAT_VEC3)};
+}
+
+UniformVec4 shader_uniform_vec4(ShaderProgram *program, std::string name) {
+   return UniformVec4{find_uniform(program, name, GL_FLOAT_VEC4)};
+}
+
+UniformMat4 shader_uniform_mat4(ShaderProgram *program, std::string name) {
+   return UniformMat4{find_uniform(program, name, GL_FLOAT_MAT4)};
+}
+
+UniformSampler shader_uniform_sampler(ShaderProgram *program, std::string name) {
+   return UniformSampler{find_uniform(program, name, GL_SAMPLER_2D)};
+}
+
+
+void set_uniform(UniformInt uniform, int value) {
+   glUniform1i(uniform.location, value);
+}
+
+void set_uniform(UniformFloat uniform, float value) {
+   glUniform1f(uniform.location, value);
+}
+
+void set_uniform(UniformVec3 uniform, const glm::vec3 &value) {
+   glUniform3f(uniform.location, value.x, value.y, value.z);
+}
+
+void set_uniform(UniformVec4 uniform, const glm::vec4 &value) {
+   glUniform4f(uniform.location, value.x, value.y, value.z, value.w);
+}
+
+void set_uniform(UniformMat4 uniform, const glm::mat4 &value) {
+   glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &value[0][0]);
+}
+
+void set_uniform(UniformSampler uniform, int texture_unit) {
+   glUniform1i(uniform.location, texture_unit);
+}
+
+
+// @@ binary cache
+static uint64_t program_source_key(const std::string &vert_source, const std::string &frag_source,
+				   uint64_t seed) {
+   // stage lengths go in too so moving text from one stage to the other changes the key
+   uint64_t lengths[2] = {vert_source.size(), frag_source.size()};
+   uint64_t key = hash_bytes(lengths, sizeof(lengths), seed);
+   key = hash_bytes(vert_source.data(), vert_source.size(), key);
+   return hash_bytes(frag_source.data(), frag_source.size(), key);
+}
+
+static std::string program_cache_path(ShaderCache *cache, const std::string &vert_source,
+				      const std::string &frag_source) {
+   uint64_t key = program_source_key(vert_source, frag_source, cache->driver_key);
+
+   char key_string[17];
+   snprintf(key_string, sizeof(key_string), "%016llx", (unsigned long long)key);
+   return cache->cache_dir + "/" + key_string + ".progbin";
+}
+
+static bool submit_program_binary(std::string cache_path, GLuint *shader_program) {
+   FileMapping mapping;
+   if(!file_map_open(cache_path, &mapping)) {
+      return false;
+   }
+
+   ShaderCacheHeader header;
+   bool valid = mapping.size >= sizeof(header);
+   if(valid) {
+      memcpy(&header, mapping.data, sizeof(header));
+      valid = header.magic == SHADER_CACHE_MAGIC && header.version == SHADER_CACHE_VERSION &&
+	 sizeof(header) + header.binary_size <= mapping.size;
+   }
+
+   // link status is left for finish like any other program, the driver may still reject the binary there
+   if(valid) {
+      *shader_program = glCreateProgram();
+      glProgramBinary(*shader_program, header.binary_format, mapping.data + sizeof(header), header.binary_size);
+   }
+   file_map_close(&mapping);
+   return valid;
+}
+
+static void store_program_binary(std::string cache_path, GLuint shader_program) {
+   GLint binary_size = 0;
+   glGetProgramiv(shader_program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+   if(binary_size <= 0) {
+      return;
+   }
+
+   std::vector<unsigned char> file_bytes(sizeof(ShaderCacheHeader) + binary_size);
+   ShaderCacheHeader header;
+   GLenum binary_format;
+   GLsizei written = 0;
+   glGetProgramBinary(shader_program, binary_size, &written, &binary_format,
+		      file_bytes.data() + sizeof(header));
+   header.magic = SHADER_CACHE_MAGIC;
+   header.version = SHADER_CACHE_VERSION;
+   header.binary_format = binary_format;
+   header.binary_size = written;
+   memcpy(file_bytes.data(), &header, sizeof(header));
+   file_bytes.resize(sizeof(header) + written);
+
+   if(!file_write_atomic(cache_path, file_bytes.data(), file_bytes.size())) {
+      printf("@DEV_WARNING: could not write shader cache %s\n", cache_path.c_str());
+   }
+}
+// @!
+
+
+// @@ submission, nothing in here asks the driver for a status so threaded compilers can overlap programs
+static void submit_source(PendingShaderProgram *pending, bool retrievable) {
+   pending->from_binary = false;
+   bool compute = pending->frag_files.empty();
+
+   pending->vert_shader = glCreateShader(compute ? GL_COMPUTE_SHADER : GL_VERTEX_SHADER);
+   const GLchar *char_vert_source = pending->vert_source.c_str();
+   glShaderSource(pending->vert_shader, 1, &char_vert_source, NULL);
+   glCompileShader(pending->vert_shader);
+
+   if(!compute) {
+      pending->frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+      const GLchar *char_frag_source = pending->frag_source.c_str();
+      glShaderSource(pending->frag_shader, 1, &char_frag_source, NULL);
+      glCompileShader(pending->frag_shader);
+   }
+
+   pending->program_id = glCreateProgram();
+   glAttachShader(pending->program_id, pending->vert_shader);
+   if(!compute) {
+      glAttachShader(pending->program_id, pending->frag_shader);
+   }
+   if(retrievable) {
+      glProgramParameteri(pending->program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+   }
+   glLinkProgram(pending->program_id);
+}
+
+// a cached binary is only ever a shortcut, the sources stay around in case finish finds it rejected
+static void submit_program(ShaderCache *cache, PendingShaderProgram *pending) {
+   pending->vert_shader = 0;
+   pending->frag_shader = 0;
+   pending->source_key = program_source_key(pending->vert_source, pending->frag_source, 0);
+   if(cache->enabled) {
+      pending->cache_path = program_cache_path(cache, pending->vert_source, pending->frag_source);
+      if(submit_program_binary(pending->cache_path, &pending->program_id)) {
+	 pending->from_binary = true;
+	 return;
+      }
+      if(std::filesystem::exists(pending->cache_path)) {
+	 cache->binaries_rejected += 1;
+      }
+   }
+   submit_source(pending, cache->enabled);
+}
+
+static bool preprocess_pending(ShaderProgram *program, PendingShaderProgram *pending) {
+   pending->program = program;
+   pending->frag_source.clear();
+   pending->frag_files.clear();
+   return shader_preprocess(program->vert_path, program->defines, &pending->vert_source, &pending->vert_files) &&
+      (program->frag_path.empty() ||
+       shader_preprocess(program->frag_path, program->defines, &pending->frag_source, &pending->frag_files));
+}
+// @!
+
+
+// @@ status checks, the first GL query on a program waits for its compile to finish
+static bool check_shader_compiled(GLuint shader, const char *stage, const std::vector<std::string> &files) {
+   int success;
+   glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+   if(!success) {
+      char info_log[2048];
+      glGetShaderInfoLog(shader, 2048, NULL, info_log);
+      std::cerr << "ERROR: " << stage << " shader compiling failed." << '\n';
+      print_source_files(files);
+      std::cout << info_log << '\n';
+   }
+   return success;
+}
+
+static bool check_program_linked(GLuint shader_program) {
+   int success;
+   glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+   if(!success) {
+      char info_log[2048];
+      glGetProgramInfoLog(shader_program, 2048, NULL, info_log);
+      std::cerr << "ERROR: shader link failed." << '\n';
+      std::cout << info_log << '\n';
+   }
+   return success;
+}
+
+// false leaves pending->program untouched and everything pending created deleted again
+static bool finish_program(ShaderCache *cache, PendingShaderProgram *pending) {
+   if(pending->from_binary) {
+      GLint success = 0;
+      glGetProgramiv(pending->program_id, GL_LINK_STATUS, &success);
+      if(success) {
+	 cache->programs_loaded += 1;
+      } else {
+	 // rejected only now, so this one program falls back to a blocking compile
+	 glDeleteProgram(pending->program_id);
+	 cache->binaries_rejected += 1;
+	 submit_source(pending, true);
+      }
+   }
+
+   if(!pending->from_binary) {
+      bool compute = pending->frag_files.empty();
+      bool success = check_shader_compiled(pending->vert_shader, compute ? "comp" : "vert", pending->vert_files) &&
+	 (compute || check_shader_compiled(pending->frag_shader, "frag", pending->frag_files)) &&
+	 check_program_linked(pending->program_id);
+      glDeleteShader(pending->vert_shader);
+      glDeleteShader(pending->frag_shader);
+      if(!success) {
+	 glDeleteProgram(pending->program_id);
+	 return false;
+      }
+
+      if(cache->enabled) {
+	 store_program_binary(pending->cache_path, pending->program_id);
+      }
+      cache->programs_compiled += 1;
+   }
+
+   ShaderProgram *program = pending->program;
+   if(program->id != 0) {
+      glDeleteProgram(program->id);
+   }
+   program->id = pending->program_id;
+   program->source_files = pending->vert_files;
+   for(const std::string &file : pending->frag_files) {
+      if(std::find(program->source_files.begin(), program->source_files.end(), file) == program->source_files.end()) {
+	 program->source_files.push_back(file);
+      }
+   }
+   reflect_program(program);
+   bind_uniform_blocks(program);
+   program->ready = true;
+
+   // @@ edited text means a new permutation key, the node moves so the program pointer stays valid
+   if(program->source_key != pending->source_key) {
+      auto node = cache->permutations.extract(program->source_key);
+      if(!node.empty() && cache->permutations.count(pending->source_key) == 0) {
+	 node.key() = pending->source_key;
+	 cache->permutations.insert(std::move(node));
+	 program->source_key = pending->source_key;
+      } else if(!node.empty()) {
+	 // some other program already has this text, keep the old key rather than lose either
+	 cache->permutations.insert(std::move(node));
+      }
+   }
+   // @!
+   return true;
+}
+
+// finishes one queued program and takes it off the queue, startup compiles have no old program to
+// fall back on so their errors are fatal
+static void finish_pending(ShaderCache *cache, size_t pending_index) {
+   auto start_time = std::chrono::steady_clock::now();
+   PendingShaderProgram pending = std::move(cache->pending[pending_index]);
+   cache->pending.erase(cache->pending.begin() + pending_index);
+   if(!finish_program(cache, &pending)) {
+      exit(1);
+   }
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+   cache->wait_seconds += seconds;
+   cache->seconds += seconds;
+}
+
+static bool pending_complete(ShaderCache *cache, const PendingShaderProgram &pending) {
+   if(!cache->parallel_compile) {
+      return true;
+   }
+   GLint complete = GL_FALSE;
+   glGetProgramiv(pending.program_id, GL_COMPLETION_STATUS_KHR, &complete);
+   return complete;
+}
+// @!
+
+
+ShaderProgram *shader_program_submit(ShaderCache *cache, std::string vert_path, std::string frag_path,
+				     const ShaderDefines &defines) {
+   auto start_time = std::chrono::steady_clock::now();
+
+   ShaderProgram scratch;
+   scratch.vert_path = vert_path;
+   scratch.frag_path = frag_path;
+   scratch.defines = defines;
+   PendingShaderProgram pending;
+   if(!preprocess_pending(&scratch, &pending)) {
+      exit(1);
+   }
+
+   // the key is the resolved text, so reading the files is the whole cost of a hit
+   uint64_t key = program_source_key(pending.vert_source, pending.frag_source, 0);
+   auto found = cache->permutations.find(key);
+   if(found != cache->permutations.end()) {
+      cache->permutations_reused += 1;
+      return &found->second;
+   }
+
+   ShaderProgram *program = &cache->permutations[key];
+   *program = scratch;
+   program->id = 0;
+   program->ready = false;
+   program->source_key = key;
+   pending.program = program;
+   submit_program(cache, &pending);
+   cache->pending.push_back(std::move(pending));
+   cache->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+   if(!cache->batch) {
+      finish_pending(cache, cache->pending.size() - 1);
+   }
+   return program;
+}
+
+
+ShaderProgram *shader_compute_submit(ShaderCache *cache, std::string comp_path, const ShaderDefines &defines) {
+   return shader_program_submit(cache, comp_path, "", defines);
+}
+
+
+void shader_cache_finish(ShaderCache *cache) {
+   while(!cache->pending.empty()) {
+      finish_pending(cache, 0);
+   }
+}
+
+
+// @@ hot reload
+void shader_cache_reload(ShaderCache *cache, const std::vector<std::string> &changed_files) {
+   for(auto &entry : cache->permutations) {
+      ShaderProgram *program = &entry.second;
+      if(!program->ready) {
+	 continue;
+      }
+      bool affected = false;
+      for(const std::string &file : changed_files) {
+	 if(std::find(program->source_files.begin(), program->source_files.end(), file) != program->source_files.end()) {
+	    affected = true;
+	 }
+      }
+      // a second edit before the first reload landed just replaces it
+      for(size_t i = 0; affected && i < cache->reloads.size(); ++i) {
+	 if(cache->reloads[i].program == program) {
+	    PendingShaderProgram &stale = cache->reloads[i];
+	    glDeleteShader(stale.vert_shader);
+	    glDeleteShader(stale.frag_shader);
+	    glDeleteProgram(stale.program_id);
+	    cache->reloads.erase(cache->reloads.begin() + i);
+	    break;
+	 }
+      }
+      if(!affected) {
+	 continue;
+      }
+
+      PendingShaderProgram pending;
+      if(!preprocess_pending(program, &pending)) {
+	 printf("@DEV_WARNING: keeping the old %s + %s\n", program->vert_path.c_str(), program->frag_path.c_str());
+	 continue;
+      }
+      submit_program(cache, &pending);
+      cache->reloads.push_back(std::move(pending));
+   }
+}
+
+
+int shader_cache_swap_reloads(ShaderCache *cache) {
+   int swapped = 0;
+   for(size_t i = 0; i < cache->reloads.size();) {
+      if(!pending_complete(cache, cache->reloads[i])) {
+	 i += 1;
+	 continue;
+      }
+      PendingShaderProgram pending = std::move(cache->reloads[i]);
+      cache->reloads.erase(cache->reloads.begin() + i);
+      if(finish_program(cache, &pending)) {
+	 printf("reloaded %s + %s\n", pending.program->vert_path.c_str(), pending.program->frag_path.c_str());
+	 swapped += 1;
+      } else {
+	 printf("@DEV_WARNING: keeping the old %s + %s\n", pending.program->vert_path.c_str(),
+		pending.program->frag_path.c_str());
+      }
+   }
+   return swapped;
+}
+// @!
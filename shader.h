@@ -0,0 +1,200 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// @@ preprocessor
+// defines are written right after #version, an empty value gives a bare #define NAME
+struct ShaderDefine {
+   std::string name;
+   std::string value;
+};
+
+typedef std::vector<ShaderDefine> ShaderDefines;
+
+// resolves #include "file" relative to the including file, every file at most once per stage so
+// includes need no guards. includes resolve before the compiler sees any #if, so one inside an inactive
+// branch still counts as read. #line directives keep compiler errors pointing at the right file, the
+// source string number is the index into source_files, which starts with path itself
+bool shader_preprocess(std::string path, const ShaderDefines &defines, std::string *source,
+		       std::vector<std::string> *source_files);
+// @!
+
+
+// @@ reflection, filled once right after linking
+// block_index is -1 for default block uniforms, array uniforms are stored without their [0]
+struct ShaderUniform {
+   std::string name;
+   GLint location;
+   GLenum type;
+   GLint array_size;
+   GLint block_index;
+};
+
+struct ShaderAttribute {
+   std::string name;
+   GLint location;
+   GLenum type;
+};
+
+struct ShaderUniformBlock {
+   std::string name;
+   GLuint index;
+   GLint data_size;
+};
+
+// ready is false while the program sits in the batch queue, nothing may look it up or draw with it
+// a compute program has its one stage in vert_path and an empty frag_path
+struct ShaderProgram {
+   GLuint id;
+   bool ready;
+   std::string vert_path;
+   std::string frag_path;
+   ShaderDefines defines;
+   // every file either stage read, includes included
+   std::vector<std::string> source_files;
+   // hash of the resolved text, the program's key in the permutation cache
+   uint64_t source_key;
+   std::vector<ShaderUniform> uniforms;
+   std::vector<ShaderAttribute> attributes;
+   std::vector<ShaderUniformBlock> uniform_blocks;
+};
+// @!
+
+
+// GL_KHR_parallel_shader_compile is not part of the glad build, main loads it by hand
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// a submitted program whose compile and link status nobody has asked for yet
+// program_id only replaces program->id once it linked
+struct PendingShaderProgram {
+   ShaderProgram *program;
+   GLuint program_id;
+   uint64_t source_key;
+   bool from_binary;
+   GLuint vert_shader;
+   GLuint frag_shader;
+   std::string cache_path;
+   std::string vert_source;
+   std::string frag_source;
+   std::vector<std::string> vert_files;
+   std::vector<std::string> frag_files;
+};
+
+// linked program binaries on disk, keyed on the exact source text plus the driver that built them
+// a driver update or any edit (defines included, they are part of the text) simply misses
+struct ShaderCache {
+   std::string cache_dir;
+   bool enabled;
+   uint64_t driver_key;
+
+   // one program per resolved source permutation, node based so handed out pointers stay put
+   std::unordered_map<uint64_t, ShaderProgram> permutations;
+   int permutations_reused;
+
+   // @@ batching, submits queue up here until finish
+   std::vector<PendingShaderProgram> pending;
+   // recompiles of programs that are already in use, these never block and never exit
+   std::vector<PendingShaderProgram> reloads;
+   bool batch;
+   bool parallel_compile;
+   // @!
+
+   int programs_loaded;
+   int programs_compiled;
+   int binaries_rejected;
+   // all time spent in shader calls, wait_seconds is the part spent blocked on status queries
+   double seconds;
+   double wait_seconds;
+};
+
+
+// the binary cache is disabled when the context has no program binary formats, compiles then always
+// go to source. the in memory permutation cache works either way
+// batch false finishes every program as soon as it is submitted, which is how compiles used to run
+// parallel_compile says GL_KHR_parallel_shader_compile is loaded and its threads are set up
+void shader_cache_init(ShaderCache *cache, std::string cache_dir, bool batch, bool parallel_compile);
+void shader_cache_print(ShaderCache *cache);
+
+
+// @@ typed uniform handles, looked up once at load time so draws never touch strings
+// a uniform the program does not have (or the compiler stripped) gives location -1, which GL
+// ignores on set. a uniform declared with another type is an error at lookup
+struct UniformInt { GLint location; };
+struct UniformFloat { GLint location; };
+struct UniformVec3 { GLint location; };
+struct UniformVec4 { GLint location; };
+struct UniformMat4 { GLint location; };
+// any sampler type, set to a texture unit
+struct UniformSampler { GLint location; };
+
+UniformInt shader_uniform_int(ShaderProgram *program, std::string name);
+UniformFloat shader_uniform_float(ShaderProgram *program, std::string name);
+UniformVec3 shader_uniform_vec3(ShaderProgram *program, std::string name);
+UniformVec4 shader_uniform_vec4(ShaderProgram *program, std::string name);
+UniformMat4 shader_uniform_mat4(ShaderProgram *program, std::string name);
+UniformSampler shader_uniform_sampler(ShaderProgram *program, std::string name);
+
+// the program owning the handle must be current
+void set_uniform(UniformInt uniform, int value);
+void set_uniform(UniformFloat uniform, float value);
+void set_uniform(UniformVec3 uniform, const glm::vec3 &value);
+void set_uniform(UniformVec4 uniform, const glm::vec4 &value);
+void set_uniform(UniformMat4 uniform, const glm::mat4 &value);
+void set_uniform(UniformSampler uniform, int texture_unit);
+// @!
+
+
+// @@ fixed uniform block binding points, glsl 330 has no binding qualifier so every program that
+// declares one of these blocks has it bound by name right after linking
+const GLuint CAMERA_BLOCK_BINDING = 0;
+const GLuint GPU_CULL_BLOCK_BINDING = 1;
+// @!
+
+
+// @@ compiling, every permutation compiles the first time it is asked for and after that the same
+// program comes back, two define sets that resolve to identical text share one program
+// known uniform blocks are bound to their fixed binding points once a program is ready
+
+// queues the compile and link without waiting on the driver, submit everything before finishing
+ShaderProgram *shader_program_submit(ShaderCache *cache, std::string vert_path, std::string frag_path,
+				     const ShaderDefines &defines = {});
+// the compute stage alone, shares the queue, cache and reload with everything else
+ShaderProgram *shader_compute_submit(ShaderCache *cache, std::string comp_path, const ShaderDefines &defines = {});
+// checks every queued program, exits on compile or link errors. startup blocks here until all of
+// them are ready
+void shader_cache_finish(ShaderCache *cache);
+// @!
+
+
+// @@ hot reload
+// resubmits every program that read one of changed_files, the old program keeps drawing meanwhile
+void shader_cache_reload(ShaderCache *cache, const std::vector<std::string> &changed_files);
+// call at a frame boundary, swaps in every reload that has finished and returns how many did
+// a reload that fails to compile is logged and the old program stays. uniform locations and values
+// do not survive a swap, callers redo their uniform setup when this returns more than 0
+int shader_cache_swap_reloads(ShaderCache *cache);
+// @!
@@ -0,0 +1,154 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "shader_watch.h"
+
+#include <cstdio>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+
+static std::string normalized_path(const std::filesystem::path &path) {
+   return path.lexically_normal().generic_string();
+}
+
+static void note_changed(ShaderWatcher *watcher, std::string path) {
+   std::lock_guard<std::mutex> lock(watcher->mutex);
+   watcher->changed[path] = std::chrono::steady_clock::now();
+}
+
+static bool should_quit(ShaderWatcher *watcher) {
+   std::lock_guard<std::mutex> lock(watcher->mutex);
+   return watcher->quit;
+}
+
+
+#ifdef __linux__
+// @@ inotify, one watch per directory so includes in subdirectories are seen too
+static void watch_thread(ShaderWatcher *watcher, int inotify_fd) {
+   std::unordered_map<int, std::string> watched_dirs;
+   std::error_code error;
+   std::vector<std::filesystem::path> dirs{watcher->root};
+   for(auto &entry : std::filesystem::recursive_directory_iterator(watcher->root, error)) {
+      if(entry.is_directory()) {
+	 dirs.push_back(entry.path());
+      }
+   }
+   for(const std::filesystem::path &dir : dirs) {
+      // editors that save through a rename show up as IN_MOVED_TO rather than IN_CLOSE_WRITE
+      int wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+      if(wd >= 0) {
+	 watched_dirs[wd] = normalized_path(dir);
+      }
+   }
+
+   alignas(inotify_event) char buffer[4096];
+   while(!should_quit(watcher)) {
+      pollfd poll_fd{inotify_fd, POLLIN, 0};
+      if(poll(&poll_fd, 1, 100) <= 0) {
+	 continue;
+      }
+      ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+      for(ssize_t offset = 0; offset < length;) {
+	 const inotify_event *event = (const inotify_event *)(buffer + offset);
+	 offset += sizeof(inotify_event) + event->len;
+	 auto dir = watched_dirs.find(event->wd);
+	 if(dir == watched_dirs.end() || event->len == 0 || (event->mask & IN_ISDIR)) {
+	    continue;
+	 }
+	 note_changed(watcher, normalized_path(std::filesystem::path(dir->second) / event->name));
+      }
+   }
+   close(inotify_fd);
+}
+// @!
+#else
+// @@ modification time polling, a few stats every quarter second is nothing next to a frame
+static void poll_write_times(ShaderWatcher *watcher, bool record_only) {
+   std::error_code error;
+   for(auto &entry : std::filesystem::recursive_directory_iterator(watcher->root, error)) {
+      if(!entry.is_regular_file(error)) {
+	 continue;
+      }
+      std::string path = normalized_path(entry.path());
+      std::filesystem::file_time_type write_time = entry.last_write_time(error);
+      auto known = watcher->write_times.find(path);
+      if(known == watcher->write_times.end() || known->second != write_time) {
+	 watcher->write_times[path] = write_time;
+	 if(!record_only) {
+	    note_changed(watcher, path);
+	 }
+      }
+   }
+}
+
+static void watch_thread(ShaderWatcher *watcher) {
+   while(!should_quit(watcher)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(250));
+      poll_write_times(watcher, false);
+   }
+}
+// @!
+#endif
+
+
+bool shader_watcher_start(ShaderWatcher *watcher, std::string root) {
+   watcher->root = root;
+   watcher->quit = false;
+   watcher->settle_time = std::chrono::milliseconds(100);
+   watcher->changed.clear();
+   watcher->write_times.clear();
+
+#ifdef __linux__
+   int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if(inotify_fd < 0) {
+      printf("@DEV_WARNING: inotify unavailable, shader hot reload disabled.\n");
+      return false;
+   }
+   watcher->thread = std::thread(watch_thread, watcher, inotify_fd);
+#else
+   poll_write_times(watcher, true);
+   watcher->thread = std::thread(watch_thread, watcher);
+#endif
+   return true;
+}
+
+
+void shader_watcher_take(ShaderWatcher *watcher, std::vector<std::string> *changed_files) {
+   changed_files->clear();
+   auto now = std::chrono::steady_clock::now();
+   std::lock_guard<std::mutex> lock(watcher->mutex);
+   for(auto it = watcher->changed.begin(); it != watcher->changed.end();) {
+      if(now - it->second >= watcher->settle_time) {
+	 changed_files->push_back(it->first);
+	 it = watcher->changed.erase(it);
+      } else {
+	 ++it;
+      }
+   }
+}
+
+
+void shader_watcher_stop(ShaderWatcher *watcher) {
+   {
+      std::lock_guard<std::mutex> lock(watcher->mutex);
+      watcher->quit = true;
+   }
+   if(watcher->thread.joinable()) {
+      watcher->thread.join();
+   }
+}
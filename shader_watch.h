@@ -0,0 +1,47 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+// watches a shader directory tree from its own thread, inotify on linux and modification times
+// everywhere else. paths come out in the same normalized form shader_preprocess records them in
+struct ShaderWatcher {
+   std::string root;
+   std::thread thread;
+   std::mutex mutex;
+   bool quit;
+
+   // last event per path, editors save in several steps so a path is only handed out once it settles
+   std::unordered_map<std::string, std::chrono::steady_clock::time_point> changed;
+   std::chrono::milliseconds settle_time;
+
+   // polling fallback only
+   std::unordered_map<std::string, std::filesystem::file_time_type> write_times;
+};
+
+
+bool shader_watcher_start(ShaderWatcher *watcher, std::string root);
+
+// GL thread, once per frame: every path whose last change is at least settle_time old
+void shader_watcher_take(ShaderWatcher *watcher, std::vector<std::string> *changed_files);
+
+void shader_watcher_stop(ShaderWatcher *watcher);
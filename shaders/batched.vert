@@ -0,0 +1,44 @@
+#version 450 core
+
+// mesh_batch.h, one glMultiDrawElementsIndirect for every visible object. the command index picks
+// the entry in draw_objects, which picks the model matrix in object_models
+#ifndef DRAW_ID_ATTRIBUTE
+#extension GL_ARB_shader_draw_parameters : require
+#endif
+
+layout (location = 0) in vec3 va_pos;
+layout (location = 1) in vec3 va_normal;
+layout (location = 2) in vec2 va_text_coord;
+
+#ifdef DRAW_ID_ATTRIBUTE
+// instanced with each command's base_instance set to its index, so it reads the same as gl_DrawIDARB
+layout (location = 5) in uint va_draw_id;
+#endif
+
+out vec2 text_coord;
+
+#include "include/camera.glsl"
+
+// MESH_BATCH_OBJECT_BINDING, model with the mesh dequantize folded in
+layout (std430, binding = 0) readonly buffer ObjectModels
+{
+   mat4 object_models[];
+};
+
+// MESH_BATCH_DRAW_BINDING, rewritten every frame with the visible objects
+layout (std430, binding = 1) readonly buffer DrawObjects
+{
+   uint draw_objects[];
+};
+
+void main()
+{
+#ifdef DRAW_ID_ATTRIBUTE
+   uint draw_id = va_draw_id;
+#else
+   uint draw_id = uint(gl_DrawIDARB);
+#endif
+   mat4 model = object_models[draw_objects[draw_id]];
+   gl_Position = camera.view_projection * model * vec4(va_pos, 1.0);
+   text_coord = va_text_coord;
+}
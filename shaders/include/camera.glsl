@@ -0,0 +1,9 @@
+// per frame camera data, bound once at CAMERA_BLOCK_BINDING, see camera_uniforms.h
+layout (std140) uniform Camera
+{
+   mat4 view;
+   mat4 projection;
+   mat4 view_projection;
+   vec4 camera_position;
+   vec4 time;
+} camera;
@@ -0,0 +1,7 @@
+uniform vec3 light_color;
+uniform float ambient_light_strength;
+
+vec3 phong_ambient()
+{
+   return ambient_light_strength * light_color;
+}
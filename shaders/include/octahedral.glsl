@@ -0,0 +1,8 @@
+// unfolds normals stored with VertexNormalOctahedral, see vertex_layout.h
+vec3 oct_decode(vec2 folded)
+{
+   vec3 n = vec3(folded, 1.0 - abs(folded.x) - abs(folded.y));
+   float t = max(-n.z, 0.0);
+   n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+   return normalize(n);
+}
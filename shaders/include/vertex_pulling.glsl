@@ -0,0 +1,38 @@
+// programmable vertex pulling, see mesh_arena.h. the mesh arena's vertex buffer is read as plain
+// words, gl_VertexID already has the draw's base vertex added so it counts whole vertices of the
+// layout being read. the decoders mirror the encodings in vertex_layout.h, keep both in step
+
+// MESH_PULL_VERTEX_BINDING
+layout (std430, binding = 2) readonly buffer PulledVertices
+{
+   uint pulled_vertex_words[];
+};
+
+// MESH_PULL_INSTANCE_BINDING, InstanceLayout instances for gl_InstanceID
+layout (std430, binding = 3) readonly buffer PulledInstances
+{
+   uint pulled_instance_words[];
+};
+
+// VertexPositionSnorm16, two words, the last short is padding
+vec3 pull_position_snorm16(uint word)
+{
+   vec2 xy = unpackSnorm2x16(pulled_vertex_words[word]);
+   return vec3(xy, unpackSnorm2x16(pulled_vertex_words[word + 1u]).x);
+}
+
+// VertexHalf2, one word
+vec2 pull_half2(uint word)
+{
+   return unpackHalf2x16(pulled_vertex_words[word]);
+}
+
+// InstanceLayout, six words: VertexFloat4 position and scale, then VertexSnorm16x4 rotation
+void pull_instance(uint instance, out vec4 position_scale, out vec4 rotation)
+{
+   uint word = instance * 6u;
+   position_scale = uintBitsToFloat(uvec4(pulled_instance_words[word], pulled_instance_words[word + 1u],
+					  pulled_instance_words[word + 2u], pulled_instance_words[word + 3u]));
+   rotation = vec4(unpackSnorm2x16(pulled_instance_words[word + 4u]),
+		   unpackSnorm2x16(pulled_instance_words[word + 5u]));
+}
@@ -0,0 +1,12 @@
+// shared by the virtual texture sampling and feedback passes, both have to agree on the level
+uniform float vt_pages;
+uniform float vt_page_texels;
+uniform float vt_max_level;
+
+float vt_level(vec2 uv, float bias)
+{
+   vec2 texel = uv * vt_pages * vt_page_texels;
+   vec2 dx = dFdx(texel);
+   vec2 dy = dFdy(texel);
+   return clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))) - bias, 0.0, vt_max_level);
+}
@@ -1,6 +1,6 @@
 #version 330 core
 
-uniform vec3 light_color;
+#include "include/lighting.glsl"
 
 out vec4 frag_color;
 
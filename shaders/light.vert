@@ -1,10 +1,20 @@
-#version 330 core
+#version 450 core
 
+#ifdef VERTEX_PULLING
+#include "include/vertex_pulling.glsl"
+#else
 layout (location = 0) in vec3 va_pos;
+#endif
 
-uniform mat4 MVP;
+#include "include/camera.glsl"
+
+uniform mat4 model;
 
 void main()
 {
-   gl_Position = MVP * vec4(va_pos, 1.0);
+#ifdef VERTEX_PULLING
+   // LightVertexLayout, 8 bytes: position snorm16 only
+   vec3 va_pos = pull_position_snorm16(uint(gl_VertexID) * 2u);
+#endif
+   gl_Position = camera.view_projection * model * vec4(va_pos, 1.0);
 }
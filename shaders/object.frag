@@ -1,18 +1,54 @@
 #version 330 core
 
-uniform vec3 light_color;
-uniform float ambient_light_strength;
+#include "include/lighting.glsl"
 
 in vec2 text_coord;
 
 out vec4 frag_color;
 
-uniform sampler2D container_texture;
-uniform sampler2D face_texture;
+#ifdef VIRTUAL_TEXTURE
+#include "include/virtual_texture.glsl"
+
+uniform usampler2D vt_indirection;
+uniform sampler2D vt_physical;
+uniform float vt_border;
+uniform float vt_physical_size;
+
+// indirection texel holds the slot of the closest resident page and the level it came from
+vec4 vt_sample(vec2 uv)
+{
+   uv = clamp(uv, 0.0, 0.99999);
+   int level = int(vt_level(uv, 0.0));
+   float pages = max(vt_pages / exp2(float(level)), 1.0);
+   uvec4 entry = texelFetch(vt_indirection, ivec2(uv * pages), level);
+
+   float resident_pages = max(vt_pages / exp2(float(entry.z)), 1.0);
+   vec2 local = fract(uv * resident_pages);
+   float tile_texels = vt_page_texels + 2.0 * vt_border;
+   vec2 physical = (vec2(entry.xy) * tile_texels + vt_border + local * vt_page_texels) / vt_physical_size;
+   return textureLod(vt_physical, physical, 0.0);
+}
+#else
+uniform sampler2DArray material_textures;
+uniform int container_layer;
+uniform vec4 container_uv_rect;
+uniform int face_layer;
+uniform vec4 face_uv_rect;
+
+// uv_rect is offset.xy, scale.zw and only differs from (0, 0, 1, 1) for atlas layers
+vec4 sample_material(int layer, vec4 uv_rect)
+{
+   return texture(material_textures, vec3(uv_rect.xy + text_coord * uv_rect.zw, layer));
+}
+#endif
 
 void main()
 {
-   vec3 phong_ambient = ambient_light_strength * light_color;
-   frag_color = vec4(phong_ambient, 1.0f) * 
-      mix(texture(container_texture, text_coord), texture(face_texture, text_coord), 0.2f);
+#ifdef VIRTUAL_TEXTURE
+   frag_color = vec4(phong_ambient(), 1.0f) * vt_sample(text_coord);
+#else
+   frag_color = vec4(phong_ambient(), 1.0f) * 
+      mix(sample_material(container_layer, container_uv_rect),
+	  sample_material(face_layer, face_uv_rect), 0.2f);
+#endif
 }
@@ -1,15 +1,54 @@
-#version 330 core
+#version 450 core
 
+#ifdef VERTEX_PULLING
+// no attributes at all, main pulls the ObjectVertexLayout words itself
+#include "include/vertex_pulling.glsl"
+#else
 layout (location = 0) in vec3 va_pos;
 layout (location = 1) in vec3 va_normal;
 layout (location = 2) in vec2 va_text_coord;
+#endif
 
 out vec2 text_coord;
 
-uniform mat4 MVP;
+#include "include/camera.glsl"
+
+#ifdef INSTANCED
+// one per instance, see InstanceLayout. model then only undoes the mesh quantization
+#ifndef VERTEX_PULLING
+layout (location = 3) in vec4 va_instance_position_scale;
+layout (location = 4) in vec4 va_instance_rotation;
+#endif
+
+vec3 rotate(vec4 q, vec3 v)
+{
+   return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif
+
+uniform mat4 model;
 
 void main()
 {
-   gl_Position = MVP * vec4(va_pos, 1.0);
+#ifdef VERTEX_PULLING
+   // 16 bytes: position snorm16 (two words), normal 10:10:10:2, uv half2
+   uint word = uint(gl_VertexID) * 4u;
+   vec3 va_pos = pull_position_snorm16(word);
+   vec2 va_text_coord = pull_half2(word + 3u);
+#ifdef INSTANCED
+   vec4 va_instance_position_scale;
+   vec4 va_instance_rotation;
+   pull_instance(uint(gl_InstanceID), va_instance_position_scale, va_instance_rotation);
+#endif
+#endif
+
+#ifdef INSTANCED
+   vec3 local = (model * vec4(va_pos, 1.0)).xyz;
+   vec3 world = rotate(normalize(va_instance_rotation), local) * va_instance_position_scale.w +
+      va_instance_position_scale.xyz;
+   gl_Position = camera.view_projection * vec4(world, 1.0);
+#else
+   gl_Position = camera.view_projection * model * vec4(va_pos, 1.0);
+#endif
    text_coord = va_text_coord;
 }
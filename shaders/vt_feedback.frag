@@ -0,0 +1,19 @@
+#version 330 core
+
+#include "include/virtual_texture.glsl"
+
+in vec2 text_coord;
+
+out uvec4 feedback;
+
+uniform float vt_feedback_bias;
+
+// same level selection as the VIRTUAL_TEXTURE object.frag, biased back down because this pass renders smaller
+void main()
+{
+   vec2 uv = clamp(text_coord, 0.0, 0.99999);
+   float level = vt_level(uv, vt_feedback_bias);
+
+   float pages = max(vt_pages / exp2(floor(level)), 1.0);
+   feedback = uvec4(uvec2(uv * pages), uint(level), 1u);
+}
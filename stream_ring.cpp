@@ -0,0 +1,126 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "stream_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+
+void stream_ring_init(StreamRing *ring, GLsizeiptr region_bytes) {
+   GLint uniform_alignment = 0;
+   GLint storage_alignment = 0;
+   glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+   glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+   ring->alignment = std::max<GLsizeiptr>(16, std::max(uniform_alignment, storage_alignment));
+   ring->region_bytes = (region_bytes + ring->alignment - 1) / ring->alignment * ring->alignment;
+
+   GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+   GLsizeiptr total_bytes = ring->region_bytes * STREAM_RING_FRAMES;
+   glCreateBuffers(1, &ring->buffer);
+   glNamedBufferStorage(ring->buffer, total_bytes, NULL, flags);
+   ring->mapped = (unsigned char *)glMapNamedBufferRange(ring->buffer, 0, total_bytes, flags);
+
+   ring->region = 0;
+   ring->region_used = 0;
+   for(GLsync &fence : ring->fences) {
+      fence = 0;
+   }
+   ring->frames = 0;
+   ring->stalls = 0;
+   ring->stall_seconds = 0.0;
+   ring->failed_allocations = 0;
+   ring->peak_region_used = 0;
+}
+
+
+void stream_ring_begin_frame(StreamRing *ring) {
+   ring->region = (int)(ring->frames % STREAM_RING_FRAMES);
+   ring->region_used = 0;
+
+   GLsync &fence = ring->fences[ring->region];
+   if(fence) {
+      // with three regions this only blocks when the GPU is more than two frames behind
+      GLenum wait_result = glClientWaitSync(fence, 0, 0);
+      if(wait_result == GL_TIMEOUT_EXPIRED) {
+	 auto wait_start = std::chrono::steady_clock::now();
+	 while(wait_result == GL_TIMEOUT_EXPIRED) {
+	    wait_result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	 }
+	 ring->stalls += 1;
+	 ring->stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
+      }
+      glDeleteSync(fence);
+      fence = 0;
+   }
+}
+
+
+void stream_ring_end_frame(StreamRing *ring) {
+   ring->fences[ring->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   ring->peak_region_used = std::max(ring->peak_region_used, ring->region_used);
+   ring->frames += 1;
+}
+
+
+GLintptr stream_ring_allocate(StreamRing *ring, GLsizeiptr size, void **data) {
+   GLsizeiptr aligned_size = (size + ring->alignment - 1) / ring->alignment * ring->alignment;
+   if(!ring->mapped || ring->region_used + aligned_size > ring->region_bytes) {
+      if(ring->failed_allocations == 0) {
+	 printf("@DEV_WARNING: stream ring region of %lld bytes is full.\n", (long long)ring->region_bytes);
+      }
+      ring->failed_allocations += 1;
+      *data = NULL;
+      return -1;
+   }
+
+   GLintptr offset = ring->region * ring->region_bytes + ring->region_used;
+   ring->region_used += aligned_size;
+   *data = ring->mapped + offset;
+   return offset;
+}
+
+
+GLintptr stream_ring_write(StreamRing *ring, const void *data, GLsizeiptr size) {
+   void *destination;
+   GLintptr offset = stream_ring_allocate(ring, size, &destination);
+   if(destination) {
+      memcpy(destination, data, size);
+   }
+   return offset;
+}
+
+
+void stream_ring_print(StreamRing *ring) {
+   printf("stream ring: %d x %.1f KB regions, peak %.1f KB per frame, %llu failed allocations\n",
+	  STREAM_RING_FRAMES, ring->region_bytes / 1024.0, ring->peak_region_used / 1024.0,
+	  (unsigned long long)ring->failed_allocations);
+   printf("   %llu of %llu frames waited on the GPU, %.2f ms in total\n", (unsigned long long)ring->stalls,
+	  (unsigned long long)ring->frames, ring->stall_seconds * 1000.0);
+}
+
+
+void stream_ring_destroy(StreamRing *ring) {
+   for(GLsync &fence : ring->fences) {
+      if(fence) {
+	 glDeleteSync(fence);
+	 fence = 0;
+      }
+   }
+   glUnmapNamedBuffer(ring->buffer);
+   glDeleteBuffers(1, &ring->buffer);
+   ring->buffer = 0;
+   ring->mapped = NULL;
+}
@@ -0,0 +1,60 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <cstdint>
+
+
+// @@ per frame streaming, one persistently mapped buffer cut into a region per frame in flight
+// the CPU writes this frame's region while the GPU still reads the previous ones, and a fence per
+// region keeps it from coming back around before the GPU is done. coherent, so no flushes and no
+// map/unmap, and nothing the driver has to synchronize implicitly
+const int STREAM_RING_FRAMES = 3;
+// @!
+
+struct StreamRing {
+   GLuint buffer;
+   unsigned char *mapped;
+   GLsizeiptr region_bytes;
+   // every allocation starts on this, large enough for uniform and shader storage ranges
+   GLsizeiptr alignment;
+
+   int region;
+   GLsizeiptr region_used;
+   GLsync fences[STREAM_RING_FRAMES];
+
+   uint64_t frames;
+   uint64_t stalls;
+   double stall_seconds;
+   uint64_t failed_allocations;
+   GLsizeiptr peak_region_used;
+};
+
+
+// region_bytes is what one frame may stream in total
+void stream_ring_init(StreamRing *ring, GLsizeiptr region_bytes);
+// before the first allocation of a frame, waits if the GPU still reads the region being reused
+void stream_ring_begin_frame(StreamRing *ring);
+// after the last draw reading this frame's data, fences the region
+void stream_ring_end_frame(StreamRing *ring);
+
+// offset into ring->buffer and where to write it, -1 and NULL once the frame's region is full
+GLintptr stream_ring_allocate(StreamRing *ring, GLsizeiptr size, void **data);
+// allocate and copy in one go
+GLintptr stream_ring_write(StreamRing *ring, const void *data, GLsizeiptr size);
+
+void stream_ring_print(StreamRing *ring);
+void stream_ring_destroy(StreamRing *ring);
@@ -0,0 +1,283 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "texture_array.h"
+
+#include "gl_resources.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <utility>
+
+
+static int full_level_count(int width, int height) {
+   int levels = 1;
+   while((width > 1 || height > 1) && levels < TEXTURE_MAX_MIP_LEVELS) {
+      width = std::max(1, width / 2);
+      height = std::max(1, height / 2);
+      levels += 1;
+   }
+   return levels;
+}
+
+
+bool texture_pack_plan(const std::vector<std::string> &paths, int atlas_size, int atlas_padding,
+		       TexturePack *pack) {
+   pack->arrays.clear();
+   pack->entries.assign(paths.size(), TexturePackEntry{0, 0, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)});
+
+   // @@ group by size, headers only
+   std::map<std::pair<int, int>, std::vector<int>> size_groups;
+   std::vector<int> source_channels(paths.size());
+   for(size_t i = 0; i < paths.size(); ++i) {
+      int width, height;
+      if(!stbi_info(paths[i].c_str(), &width, &height, &source_channels[i])) {
+	 std::cerr << "ERROR: could not read image header: " << paths[i] << '\n';
+	 return false;
+      }
+      size_groups[{width, height}].push_back((int)i);
+   }
+
+   std::vector<int> atlas_candidates;
+   for(auto &group : size_groups) {
+      int width = group.first.first;
+      int height = group.first.second;
+      bool fits_atlas = width + 2 * atlas_padding <= atlas_size && height + 2 * atlas_padding <= atlas_size;
+      if(group.second.size() == 1 && fits_atlas) {
+	 atlas_candidates.push_back(group.second[0]);
+      }
+   }
+   // a lone odd size gains nothing from an atlas, it gets its own one layer array instead
+   if(atlas_candidates.size() == 1) {
+      atlas_candidates.clear();
+   }
+   // @!
+
+
+   // @@ same size groups become plain arrays, one source per layer
+   for(auto &group : size_groups) {
+      if(std::find(atlas_candidates.begin(), atlas_candidates.end(), group.second[0]) !=
+	 atlas_candidates.end()) {
+	 continue;
+      }
+
+      PackedTextureArray array;
+      array.id = 0;
+      array.width = group.first.first;
+      array.height = group.first.second;
+      array.channels = 1;
+      array.level_count = full_level_count(array.width, array.height);
+      array.is_atlas = false;
+      array.atlas_padding = 0;
+      for(int source : group.second) {
+	 array.channels = std::max(array.channels, source_channels[source]);
+	 TexturePackEntry &entry = pack->entries[source];
+	 entry.array_index = (int)pack->arrays.size();
+	 entry.layer = (int)array.layers.size();
+
+	 TexturePackLayer layer;
+	 layer.placements.push_back({paths[source], glm::ivec4(0, 0, array.width, array.height)});
+	 array.layers.push_back(layer);
+      }
+      pack->arrays.push_back(array);
+   }
+   // @!
+
+
+   // @@ shelf pack the odd sizes, tallest first
+   if(!atlas_candidates.empty()) {
+      std::vector<std::pair<int, glm::ivec2>> sized;
+      for(int source : atlas_candidates) {
+	 int width, height, channels;
+	 stbi_info(paths[source].c_str(), &width, &height, &channels);
+	 sized.push_back({source, glm::ivec2(width, height)});
+      }
+      std::sort(sized.begin(), sized.end(), [](const auto &a, const auto &b) { return a.second.y > b.second.y; });
+
+      // stop the chain once a level would have less than a texel of padding left
+      int padding_levels = 1;
+      while((atlas_padding >> padding_levels) > 0) {
+	 padding_levels += 1;
+      }
+
+      PackedTextureArray atlas;
+      atlas.id = 0;
+      atlas.width = atlas_size;
+      atlas.height = atlas_size;
+      atlas.channels = 1;
+      atlas.level_count = std::min(full_level_count(atlas_size, atlas_size), padding_levels);
+      atlas.is_atlas = true;
+      atlas.atlas_padding = atlas_padding;
+      atlas.layers.push_back(TexturePackLayer{});
+
+      int cursor_x = 0;
+      int cursor_y = 0;
+      int shelf_height = 0;
+      for(auto &item : sized) {
+	 int padded_width = item.second.x + 2 * atlas_padding;
+	 int padded_height = item.second.y + 2 * atlas_padding;
+	 if(cursor_x + padded_width > atlas_size) {
+	    cursor_x = 0;
+	    cursor_y += shelf_height;
+	    shelf_height = 0;
+	 }
+	 if(cursor_y + padded_height > atlas_size) {
+	    atlas.layers.push_back(TexturePackLayer{});
+	    cursor_x = 0;
+	    cursor_y = 0;
+	    shelf_height = 0;
+	 }
+
+	 glm::ivec4 rect(cursor_x + atlas_padding, cursor_y + atlas_padding, item.second.x, item.second.y);
+	 atlas.layers.back().placements.push_back({paths[item.first], rect});
+	 atlas.channels = std::max(atlas.channels, source_channels[item.first]);
+
+	 TexturePackEntry &entry = pack->entries[item.first];
+	 entry.array_index = (int)pack->arrays.size();
+	 entry.layer = (int)atlas.layers.size() - 1;
+	 entry.uv_rect = glm::vec4(rect) / (float)atlas_size;
+
+	 cursor_x += padded_width;
+	 shelf_height = std::max(shelf_height, padded_height);
+      }
+      pack->arrays.push_back(atlas);
+   }
+   // @!
+
+   return true;
+}
+
+
+// @@ atlas layers are composed on the worker, every source is edge extended into its padding
+static bool compose_atlas_layer(std::string cache_dir, const TexturePackLayer &layer, int atlas_size,
+				int padding, int channels, bool srgb, TextureMipChain *chain) {
+   std::vector<unsigned char> page((size_t)atlas_size * atlas_size * channels, 0);
+
+   for(const TextureAtlasPlacement &placement : layer.placements) {
+      TextureMipChain source;
+      if(!texture_cache_load(cache_dir, placement.path, srgb, &source)) {
+	 return false;
+      }
+
+      int width = placement.rect.z;
+      int height = placement.rect.w;
+      std::vector<unsigned char> texels((size_t)width * height * channels);
+      texture_convert_channels(source.data, (size_t)width * height, source.channels, texels.data(), channels);
+      texture_mip_chain_free(&source);
+
+      for(int y = -padding; y < height + padding; ++y) {
+	 int source_y = std::min(std::max(y, 0), height - 1);
+	 for(int x = -padding; x < width + padding; ++x) {
+	    int source_x = std::min(std::max(x, 0), width - 1);
+	    memcpy(&page[((size_t)(placement.rect.y + y) * atlas_size + placement.rect.x + x) * channels],
+		   &texels[((size_t)source_y * width + source_x) * channels], channels);
+	 }
+      }
+   }
+
+   build_mip_chain(page.data(), atlas_size, atlas_size, channels, srgb, chain);
+   return true;
+}
+
+// the cache stores each source in its own minimal layout, layers have to match the array
+static bool load_array_layer(std::string cache_dir, std::string path, int channels, bool srgb,
+			     TextureMipChain *chain) {
+   if(!texture_cache_load(cache_dir, path, srgb, chain)) {
+      return false;
+   }
+   if(chain->channels != channels) {
+      texture_mip_chain_convert(chain, channels);
+   }
+   return true;
+}
+// @!
+
+
+void texture_pack_create(TexturePack *pack, TextureLoader *loader, TextureStreamer *streamer, bool srgb) {
+   GLint previous_array;
+   glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previous_array);
+
+   for(PackedTextureArray &array : pack->arrays) {
+      // colour arrays need an sRGB format, and core GL only has those with three or four channels
+      if(srgb && array.channels < 3) {
+	 array.channels += 2;
+      }
+      GLenum internal_format = texture_internal_format(array.channels, srgb);
+      bool streamed = streamer && !array.is_atlas;
+      int first_level = 0;
+      if(streamed) {
+	 first_level = std::min(texture_streamer_start_level(streamer, array.width, array.height), array.level_count - 1);
+      }
+
+      glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array.id);
+      gl_texture_sampling(array.id, array.is_atlas ? GL_CLAMP_TO_EDGE : GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+      glTextureParameteri(array.id, GL_TEXTURE_BASE_LEVEL, first_level);
+      glTextureParameteri(array.id, GL_TEXTURE_MAX_LEVEL, array.level_count - 1);
+      if(array.channels <= 2) {
+	 GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, array.channels == 2 ? GL_GREEN : GL_ONE};
+	 glTextureParameteriv(array.id, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+      }
+      glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+      for(int level = first_level; level < array.level_count; ++level) {
+	 glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internal_format, std::max(1, array.width >> level),
+		      std::max(1, array.height >> level), (GLsizei)array.layers.size(), 0,
+		      texture_pixel_format(array.channels), GL_UNSIGNED_BYTE, NULL);
+      }
+      if(loader->budget) {
+	 texture_budget_track(loader->budget, array.id, GL_TEXTURE_2D_ARRAY,
+			      array.is_atlas ? "atlas array" : array.layers[0].placements[0].path, true);
+      }
+
+      std::string cache_dir = loader->cache_dir;
+      int channels = array.channels;
+      std::vector<TextureProducer> layer_producers;
+      for(size_t layer = 0; layer < array.layers.size(); ++layer) {
+	 const TexturePackLayer &pack_layer = array.layers[layer];
+	 if(array.is_atlas) {
+	    int atlas_size = array.width;
+	    int padding = array.atlas_padding;
+	    texture_loader_request_layer(loader, array.id, (int)layer, "atlas layer",
+					 [cache_dir, pack_layer, atlas_size, padding, channels, srgb](TextureMipChain *chain) {
+					    return compose_atlas_layer(cache_dir, pack_layer, atlas_size, padding,
+								       channels, srgb, chain);
+					 });
+	 } else {
+	    std::string path = pack_layer.placements[0].path;
+	    TextureProducer produce = [cache_dir, path, channels, srgb](TextureMipChain *chain) {
+	       return load_array_layer(cache_dir, path, channels, srgb, chain);
+	    };
+	    texture_loader_request_layer(loader, array.id, (int)layer, path, produce);
+	    layer_producers.push_back(produce);
+	 }
+      }
+
+      if(streamed) {
+	 texture_streamer_register_array(streamer, array.id, array.width, array.height, array.level_count,
+					 array.channels, srgb, layer_producers);
+      }
+   }
+
+   glBindTexture(GL_TEXTURE_2D_ARRAY, previous_array);
+}
+
+
+void texture_pack_destroy(TexturePack *pack) {
+   for(PackedTextureArray &array : pack->arrays) {
+      glDeleteTextures(1, &array.id);
+      array.id = 0;
+   }
+}
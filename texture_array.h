@@ -0,0 +1,74 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "texture_loader.h"
+#include "texture_streaming.h"
+
+
+// where one imported image ended up, sample with texture(array, vec3(uv_rect.xy + uv * uv_rect.zw, layer))
+struct TexturePackEntry {
+   int array_index;
+   int layer;
+   glm::vec4 uv_rect;
+};
+
+// x, y, width, height of a source inside an atlas layer, excluding its padding
+struct TextureAtlasPlacement {
+   std::string path;
+   glm::ivec4 rect;
+};
+
+// a plain layer holds exactly one source, an atlas layer holds several with padding between
+struct TexturePackLayer {
+   std::vector<TextureAtlasPlacement> placements;
+};
+
+// channels is the widest layout any source header reports, see texture_minimal_channels
+struct PackedTextureArray {
+   GLuint id;
+   int width;
+   int height;
+   int channels;
+   int level_count;
+   bool is_atlas;
+   int atlas_padding;
+   std::vector<TexturePackLayer> layers;
+};
+
+struct TexturePack {
+   std::vector<PackedTextureArray> arrays;
+   std::vector<TexturePackEntry> entries;
+};
+
+
+// groups sources by size into array layers, sizes nobody else shares go into shelf packed atlas
+// layers of atlas_size with atlas_padding texels of edge extended border around every image
+// only reads image headers, entries come back in the same order as paths
+bool texture_pack_plan(const std::vector<std::string> &paths, int atlas_size, int atlas_padding,
+		       TexturePack *pack);
+
+// allocates every array on the GL thread and queues the layers on the loader
+// with a streamer, plain arrays only get storage for their coarse levels and are handed to it for the
+// rest, atlas arrays always load whole since every page rebuild composes all of its sources
+void texture_pack_create(TexturePack *pack, TextureLoader *loader, TextureStreamer *streamer, bool srgb);
+
+void texture_pack_destroy(TexturePack *pack);
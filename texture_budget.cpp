@@ -0,0 +1,215 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "texture_budget.h"
+
+#include <cstdio>
+
+
+static GLenum binding_query(GLenum target) {
+   return target == GL_TEXTURE_2D_ARRAY ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D;
+}
+
+// uncompressed sizes as the driver is likely to lay them out, three channel formats get padded to four
+static size_t bytes_per_texel(GLenum internal_format) {
+   switch(internal_format) {
+   case GL_R8: return 1;
+   case GL_RG8: return 2;
+   case GL_RGBA16UI: case GL_RGBA16F: return 8;
+   case GL_RGBA32F: return 16;
+   default: return 4;
+   }
+}
+
+static bool is_integer_format(GLenum internal_format) {
+   switch(internal_format) {
+   case GL_RGBA8UI: case GL_RGBA16UI: case GL_RGBA32UI: case GL_R32UI: return true;
+   default: return false;
+   }
+}
+
+
+void texture_budget_init(TextureBudget *budget, size_t budget_bytes) {
+   budget->budget_bytes = budget_bytes;
+   budget->resident_bytes = 0;
+   budget->frame = 1;
+   budget->textures.clear();
+   budget->texture_index.clear();
+   budget->levels_dropped = 0;
+   budget->bytes_dropped = 0;
+   budget->exhausted_warned = false;
+}
+
+
+void texture_budget_track(TextureBudget *budget, GLuint id, GLenum target, std::string name, bool evictable) {
+   BudgetedTexture texture = {};
+   texture.id = id;
+   texture.target = target;
+   texture.name = name;
+   texture.evictable = evictable;
+   texture.last_used_frame = budget->frame;
+
+   GLint base_level;
+   GLint max_level;
+   glGetTextureParameteriv(id, GL_TEXTURE_BASE_LEVEL, &base_level);
+   glGetTextureParameteriv(id, GL_TEXTURE_MAX_LEVEL, &max_level);
+   texture.base_level = base_level;
+   texture.level_count = base_level;
+
+   // @@ walk the levels that actually have storage
+   for(int level = base_level; level <= max_level && level < TEXTURE_MAX_MIP_LEVELS; ++level) {
+      GLint width, height, depth, internal_format, compressed;
+      glGetTextureLevelParameteriv(id, level, GL_TEXTURE_WIDTH, &width);
+      if(width == 0) {
+	 break;
+      }
+      glGetTextureLevelParameteriv(id, level, GL_TEXTURE_HEIGHT, &height);
+      glGetTextureLevelParameteriv(id, level, GL_TEXTURE_DEPTH, &depth);
+      glGetTextureLevelParameteriv(id, level, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+      glGetTextureLevelParameteriv(id, level, GL_TEXTURE_COMPRESSED, &compressed);
+
+      if(compressed) {
+	 GLint image_size;
+	 glGetTextureLevelParameteriv(id, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &image_size);
+	 texture.level_bytes[level] = (size_t)image_size;
+      } else {
+	 texture.level_bytes[level] = (size_t)width * height * depth * bytes_per_texel(internal_format);
+      }
+      if(level == base_level) {
+	 texture.internal_format = internal_format;
+	 texture.compressed = compressed;
+      }
+      texture.resident_bytes += texture.level_bytes[level];
+      texture.level_count = level + 1;
+   }
+   // @!
+
+   auto found = budget->texture_index.find(id);
+   if(found != budget->texture_index.end()) {
+      BudgetedTexture &old = budget->textures[found->second];
+      budget->resident_bytes -= old.resident_bytes;
+      texture.last_used_frame = old.last_used_frame;
+      old = texture;
+   } else {
+      budget->texture_index[id] = (int)budget->textures.size();
+      budget->textures.push_back(texture);
+   }
+   budget->resident_bytes += texture.resident_bytes;
+}
+
+
+void texture_budget_touch(TextureBudget *budget, GLuint id) {
+   auto found = budget->texture_index.find(id);
+   if(found != budget->texture_index.end()) {
+      budget->textures[found->second].last_used_frame = budget->frame;
+   }
+}
+
+
+// @@ frees the storage of the base level and moves the base up, the texture keeps its name
+static void drop_top_level(TextureBudget *budget, BudgetedTexture *texture) {
+   int level = texture->base_level;
+   glTextureParameteri(texture->id, GL_TEXTURE_BASE_LEVEL, level + 1);
+
+   GLint previous_texture;
+   glGetIntegerv(binding_query(texture->target), &previous_texture);
+   glBindTexture(texture->target, texture->id);
+   // respecifying a level as 0x0 is what actually hands the memory back to the driver
+   if(texture->compressed) {
+      if(texture->target == GL_TEXTURE_2D_ARRAY) {
+	 glCompressedTexImage3D(texture->target, level, texture->internal_format, 0, 0, 0, 0, 0, NULL);
+      } else {
+	 glCompressedTexImage2D(texture->target, level, texture->internal_format, 0, 0, 0, 0, NULL);
+      }
+   } else {
+      GLenum format = is_integer_format(texture->internal_format) ? GL_RGBA_INTEGER : GL_RGBA;
+      if(texture->target == GL_TEXTURE_2D_ARRAY) {
+	 glTexImage3D(texture->target, level, texture->internal_format, 0, 0, 0, 0, format,
+		      GL_UNSIGNED_BYTE, NULL);
+      } else {
+	 glTexImage2D(texture->target, level, texture->internal_format, 0, 0, 0, format,
+		      GL_UNSIGNED_BYTE, NULL);
+      }
+   }
+
+   glBindTexture(texture->target, previous_texture);
+
+   size_t freed = texture->level_bytes[level];
+   texture->level_bytes[level] = 0;
+   texture->resident_bytes -= freed;
+   texture->base_level = level + 1;
+   budget->resident_bytes -= freed;
+   budget->levels_dropped += 1;
+   budget->bytes_dropped += freed;
+}
+// @!
+
+
+bool texture_budget_drop_top_level(TextureBudget *budget, GLuint id) {
+   auto found = budget->texture_index.find(id);
+   if(found == budget->texture_index.end()) {
+      return false;
+   }
+   BudgetedTexture &texture = budget->textures[found->second];
+   if(texture.base_level >= texture.level_count - 1) {
+      return false;
+   }
+   drop_top_level(budget, &texture);
+   return true;
+}
+
+
+void texture_budget_end_frame(TextureBudget *budget) {
+   while(budget->resident_bytes > budget->budget_bytes) {
+      // oldest stamp first, textures drawn this frame only go once nothing older is left
+      // ties go to whichever has the bigger top level since that frees the most
+      BudgetedTexture *victim = NULL;
+      for(BudgetedTexture &texture : budget->textures) {
+	 if(!texture.evictable || texture.base_level >= texture.level_count - 1) {
+	    continue;
+	 }
+	 if(!victim || texture.last_used_frame < victim->last_used_frame ||
+	    (texture.last_used_frame == victim->last_used_frame &&
+	     texture.level_bytes[texture.base_level] > victim->level_bytes[victim->base_level])) {
+	    victim = &texture;
+	 }
+      }
+      if(!victim) {
+	 if(budget->exhausted_warned) {
+	    break;
+	 }
+	 budget->exhausted_warned = true;
+	 printf("@DEV_WARNING: texture budget exceeded with nothing left to drop (%.1f of %.1f MB).\n",
+		budget->resident_bytes / (1024.0 * 1024.0), budget->budget_bytes / (1024.0 * 1024.0));
+	 break;
+      }
+      drop_top_level(budget, victim);
+   }
+   if(budget->resident_bytes <= budget->budget_bytes) {
+      budget->exhausted_warned = false;
+   }
+
+   budget->frame += 1;
+}
+
+
+void texture_budget_print(TextureBudget *budget) {
+   printf("texture budget: %.1f of %.1f MB resident, %d levels dropped (%.1f MB)\n",
+	  budget->resident_bytes / (1024.0 * 1024.0), budget->budget_bytes / (1024.0 * 1024.0),
+	  budget->levels_dropped, budget->bytes_dropped / (1024.0 * 1024.0));
+   for(const BudgetedTexture &texture : budget->textures) {
+      printf("   %-24s %8.2f MB  levels %d-%d  last used frame %llu%s\n", texture.name.c_str(),
+	     texture.resident_bytes / (1024.0 * 1024.0), texture.base_level, texture.level_count - 1,
+	     (unsigned long long)texture.last_used_frame, texture.evictable ? "" : "  (pinned)");
+   }
+}
@@ -0,0 +1,72 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "texture_cache.h"
+
+
+// what one texture costs in video memory, level_bytes covers every layer of that level
+// levels below base_level have been dropped and cost nothing
+struct BudgetedTexture {
+   GLuint id;
+   GLenum target;
+   std::string name;
+   GLenum internal_format;
+   bool compressed;
+   bool evictable;
+   int base_level;
+   int level_count;
+   size_t level_bytes[TEXTURE_MAX_MIP_LEVELS];
+   size_t resident_bytes;
+   uint64_t last_used_frame;
+};
+
+struct TextureBudget {
+   size_t budget_bytes;
+   size_t resident_bytes;
+   uint64_t frame;
+   std::vector<BudgetedTexture> textures;
+   std::unordered_map<GLuint, int> texture_index;
+
+   int levels_dropped;
+   size_t bytes_dropped;
+   bool exhausted_warned;
+};
+
+
+void texture_budget_init(TextureBudget *budget, size_t budget_bytes);
+
+// (re)reads the size of every allocated level straight from GL, call whenever a texture's storage
+// changes. pinned textures (evictable false) count against the budget but are never dropped
+void texture_budget_track(TextureBudget *budget, GLuint id, GLenum target, std::string name, bool evictable);
+
+// stamp a texture as used this frame, call where it gets bound for drawing
+void texture_budget_touch(TextureBudget *budget, GLuint id);
+
+// call once at the end of the frame, while over budget the least recently used texture loses its
+// top mip level. the smallest level is always kept so the texture name stays samplable
+void texture_budget_end_frame(TextureBudget *budget);
+
+// drops one level right away whatever the budget, false if id is untracked or down to its last level
+bool texture_budget_drop_top_level(TextureBudget *budget, GLuint id);
+
+void texture_budget_print(TextureBudget *budget);
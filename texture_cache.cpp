@@ -0,0 +1,504 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "texture_cache.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXTURE_CACHE_SSE2
+#endif
+
+
+const uint32_t TEXTURE_CACHE_MAGIC = 0x4358544c; // "LTXC"
+const uint32_t TEXTURE_CACHE_VERSION = 4;
+
+struct TextureCacheLevel {
+   uint32_t width;
+   uint32_t height;
+   uint64_t offset;
+   uint64_t size;
+};
+
+struct TextureCacheHeader {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t width;
+   uint32_t height;
+   uint32_t channels;
+   uint32_t level_count;
+   uint32_t srgb;
+   uint32_t padding;
+   uint64_t data_offset;
+   uint64_t data_size;
+   TextureCacheLevel levels[TEXTURE_MAX_MIP_LEVELS];
+};
+
+
+// @@ sRGB conversion tables, built once on first use
+struct ColorTables {
+   float srgb_to_linear[256];
+   float unorm_to_float[256];
+   unsigned char linear_to_srgb[4096];
+};
+
+static const ColorTables &color_tables() {
+   static const ColorTables tables = [] {
+      ColorTables t;
+      for(int i = 0; i < 256; ++i) {
+	 float c = i / 255.0f;
+	 t.srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	 t.unorm_to_float[i] = c;
+      }
+      for(int i = 0; i < 4096; ++i) {
+	 float l = i / 4095.0f;
+	 float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+	 t.linear_to_srgb[i] = (unsigned char)(c * 255.0f + 0.5f);
+      }
+      return t;
+   }();
+   return tables;
+}
+
+static bool is_alpha_channel(int channel, int channels) {
+   return (channels == 2 && channel == 1) || (channels == 4 && channel == 3);
+}
+// @!
+
+
+// @@ channel layouts
+int texture_minimal_channels(const unsigned char *pixels, size_t texel_count, int channels, bool srgb) {
+   bool has_alpha = channels == 2 || channels == 4;
+   bool opaque = true;
+   bool grey = true;
+   for(size_t i = 0; i < texel_count && (opaque || grey); ++i) {
+      const unsigned char *texel = pixels + i * channels;
+      if(has_alpha && texel[channels - 1] != 255) {
+	 opaque = false;
+      }
+      if(channels >= 3 && (texel[0] != texel[1] || texel[0] != texel[2])) {
+	 grey = false;
+      }
+   }
+
+   bool keep_alpha = has_alpha && !opaque;
+   if(grey && !srgb) {
+      return keep_alpha ? 2 : 1;
+   }
+   return keep_alpha ? 4 : 3;
+}
+
+
+void texture_convert_channels(const unsigned char *src, size_t texel_count, int src_channels,
+			      unsigned char *dst, int dst_channels) {
+   for(size_t i = 0; i < texel_count; ++i) {
+      const unsigned char *in = src + i * src_channels;
+      unsigned char *out = dst + i * dst_channels;
+
+      unsigned char rgba[4];
+      switch(src_channels) {
+      case 1: rgba[0] = rgba[1] = rgba[2] = in[0]; rgba[3] = 255; break;
+      case 2: rgba[0] = rgba[1] = rgba[2] = in[0]; rgba[3] = in[1]; break;
+      case 3: rgba[0] = in[0]; rgba[1] = in[1]; rgba[2] = in[2]; rgba[3] = 255; break;
+      default: memcpy(rgba, in, 4); break;
+      }
+
+      switch(dst_channels) {
+      case 1: out[0] = rgba[0]; break;
+      case 2: out[0] = rgba[0]; out[1] = rgba[3]; break;
+      case 3: memcpy(out, rgba, 3); break;
+      default: memcpy(out, rgba, 4); break;
+      }
+   }
+}
+// @!
+
+
+static int mip_level_count(int width, int height) {
+   int levels = 1;
+   while((width > 1 || height > 1) && levels < TEXTURE_MAX_MIP_LEVELS) {
+      width = std::max(1, width / 2);
+      height = std::max(1, height / 2);
+      levels += 1;
+   }
+   return levels;
+}
+
+
+// @@ 2x2 box filter on linear RGBA floats, odd edges clamp onto the last row/column
+static void downsample_linear(const float *src, int src_width, int src_height,
+			      float *dst, int dst_width, int dst_height) {
+   for(int y = 0; y < dst_height; ++y) {
+      int sy0 = std::min(2 * y, src_height - 1);
+      int sy1 = std::min(2 * y + 1, src_height - 1);
+      const float *row0 = src + (size_t)sy0 * src_width * 4;
+      const float *row1 = src + (size_t)sy1 * src_width * 4;
+      float *dst_row = dst + (size_t)y * dst_width * 4;
+
+      for(int x = 0; x < dst_width; ++x) {
+	 int sx0 = std::min(2 * x, src_width - 1) * 4;
+	 int sx1 = std::min(2 * x + 1, src_width - 1) * 4;
+#ifdef TEXTURE_CACHE_SSE2
+	 __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + sx0), _mm_loadu_ps(row0 + sx1)),
+				 _mm_add_ps(_mm_loadu_ps(row1 + sx0), _mm_loadu_ps(row1 + sx1)));
+	 _mm_storeu_ps(dst_row + x * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+	 for(int c = 0; c < 4; ++c) {
+	    dst_row[x * 4 + c] = 0.25f * (row0[sx0 + c] + row0[sx1 + c] + row1[sx0 + c] + row1[sx1 + c]);
+	 }
+#endif
+      }
+   }
+}
+// @!
+
+
+void build_mip_chain(const unsigned char *pixels, int width, int height, int channels, bool srgb,
+		     TextureMipChain *chain) {
+   const ColorTables &tables = color_tables();
+
+   chain->width = width;
+   chain->height = height;
+   chain->channels = channels;
+   chain->level_count = mip_level_count(width, height);
+   chain->block_format = TEXTURE_BLOCK_NONE;
+   chain->srgb = srgb;
+   chain->mapping.data = NULL;
+   chain->mapping.size = 0;
+
+   // @@ level layout, every level starts 16 byte aligned
+   size_t offset = 0;
+   for(int level = 0; level < chain->level_count; ++level) {
+      TextureMipLevel &mip = chain->levels[level];
+      mip.width = std::max(1, width >> level);
+      mip.height = std::max(1, height >> level);
+      mip.offset = offset;
+      mip.size = (size_t)mip.width * mip.height * channels;
+      offset = (offset + mip.size + 15) & ~(size_t)15;
+   }
+   chain->data_size = offset;
+   chain->heap_data = (unsigned char *)malloc(chain->data_size);
+   chain->data = chain->heap_data;
+   memcpy(chain->heap_data, pixels, chain->levels[0].size);
+   // @!
+
+   const float *decode_table[4];
+   for(int c = 0; c < channels; ++c) {
+      bool linear = !srgb || is_alpha_channel(c, channels);
+      decode_table[c] = linear ? tables.unorm_to_float : tables.srgb_to_linear;
+   }
+
+   // @@ keep the previous level in linear float so error does not pile up level over level
+   std::vector<float> previous((size_t)width * height * 4, 0.0f);
+   std::vector<float> current;
+   for(size_t i = 0; i < (size_t)width * height; ++i) {
+      for(int c = 0; c < channels; ++c) {
+	 previous[i * 4 + c] = decode_table[c][pixels[i * channels + c]];
+      }
+   }
+
+   for(int level = 1; level < chain->level_count; ++level) {
+      const TextureMipLevel &src = chain->levels[level - 1];
+      const TextureMipLevel &dst = chain->levels[level];
+      current.assign((size_t)dst.width * dst.height * 4, 0.0f);
+      downsample_linear(previous.data(), src.width, src.height, current.data(), dst.width, dst.height);
+
+      unsigned char *dst_texels = chain->heap_data + dst.offset;
+      for(size_t i = 0; i < (size_t)dst.width * dst.height; ++i) {
+	 for(int c = 0; c < channels; ++c) {
+	    float value = std::min(std::max(current[i * 4 + c], 0.0f), 1.0f);
+	    if(decode_table[c] == tables.srgb_to_linear) {
+	       dst_texels[i * channels + c] = tables.linear_to_srgb[(int)(value * 4095.0f + 0.5f)];
+	    } else {
+	       dst_texels[i * channels + c] = (unsigned char)(value * 255.0f + 0.5f);
+	    }
+	 }
+      }
+      previous.swap(current);
+   }
+   // @!
+}
+
+
+static bool texture_cache_open(std::string cache_path, TextureMipChain *chain) {
+   if(!file_map_open(cache_path, &chain->mapping)) {
+      return false;
+   }
+
+   TextureCacheHeader header;
+   bool valid = chain->mapping.size >= sizeof(header);
+   if(valid) {
+      memcpy(&header, chain->mapping.data, sizeof(header));
+      valid = header.magic == TEXTURE_CACHE_MAGIC && header.version == TEXTURE_CACHE_VERSION &&
+	 header.width >= 1 && header.height >= 1 && header.channels >= 1 && header.channels <= 4 &&
+	 header.level_count >= 1 && header.level_count <= (uint32_t)TEXTURE_MAX_MIP_LEVELS &&
+	 header.data_offset <= chain->mapping.size && header.data_size <= chain->mapping.size - header.data_offset;
+   }
+   // @@ every level has to be exactly what build_mip_chain would have laid out for these dims
+   uint64_t level_offset = 0;
+   for(uint32_t level = 0; valid && level < header.level_count; ++level) {
+      const TextureCacheLevel &mip = header.levels[level];
+      uint32_t width = std::max(1u, header.width >> level);
+      uint32_t height = std::max(1u, header.height >> level);
+      valid = mip.width == width && mip.height == height && mip.offset == level_offset &&
+	 mip.size == (uint64_t)width * height * header.channels &&
+	 mip.size <= header.data_size && mip.offset <= header.data_size - mip.size;
+      level_offset = (level_offset + mip.size + 15) & ~(uint64_t)15;
+   }
+   // @!
+   if(!valid) {
+      file_map_close(&chain->mapping);
+      return false;
+   }
+
+   chain->width = header.width;
+   chain->height = header.height;
+   chain->channels = header.channels;
+   chain->level_count = header.level_count;
+   chain->block_format = TEXTURE_BLOCK_NONE;
+   chain->srgb = header.srgb != 0;
+   for(int level = 0; level < chain->level_count; ++level) {
+      chain->levels[level].width = header.levels[level].width;
+      chain->levels[level].height = header.levels[level].height;
+      chain->levels[level].offset = header.levels[level].offset;
+      chain->levels[level].size = header.levels[level].size;
+   }
+   chain->data = chain->mapping.data + header.data_offset;
+   chain->data_size = header.data_size;
+   chain->heap_data = NULL;
+   return true;
+}
+
+
+static bool texture_cache_write(std::string cache_path, const TextureMipChain *chain) {
+   TextureCacheHeader header;
+   memset(&header, 0, sizeof(header));
+   header.magic = TEXTURE_CACHE_MAGIC;
+   header.version = TEXTURE_CACHE_VERSION;
+   header.width = chain->width;
+   header.height = chain->height;
+   header.channels = chain->channels;
+   header.level_count = chain->level_count;
+   header.srgb = chain->srgb;
+   header.data_offset = (sizeof(header) + 15) & ~(size_t)15;
+   header.data_size = chain->data_size;
+   for(int level = 0; level < chain->level_count; ++level) {
+      header.levels[level].width = chain->levels[level].width;
+      header.levels[level].height = chain->levels[level].height;
+      header.levels[level].offset = chain->levels[level].offset;
+      header.levels[level].size = chain->levels[level].size;
+   }
+
+   std::vector<unsigned char> file_bytes(header.data_offset + header.data_size, 0);
+   memcpy(file_bytes.data(), &header, sizeof(header));
+   memcpy(file_bytes.data() + header.data_offset, chain->data, chain->data_size);
+   return file_write_atomic(cache_path, file_bytes.data(), file_bytes.size());
+}
+
+
+static std::string cache_file_path(std::string cache_dir, uint64_t key) {
+   char key_string[17];
+   snprintf(key_string, sizeof(key_string), "%016llx", (unsigned long long)key);
+   return cache_dir + "/" + key_string + ".texcache";
+}
+
+// persists a freshly built chain and swaps it for the mapping so the heap copy can go
+static void texture_cache_store(std::string cache_path, TextureMipChain *chain) {
+   if(texture_cache_write(cache_path, chain)) {
+      TextureMipChain mapped_chain;
+      if(texture_cache_open(cache_path, &mapped_chain)) {
+	 free(chain->heap_data);
+	 *chain = mapped_chain;
+      }
+   } else {
+      printf("@DEV_WARNING: could not write texture cache %s\n", cache_path.c_str());
+   }
+}
+
+
+bool texture_cache_load(std::string cache_dir, std::string source_path, bool srgb,
+			TextureMipChain *chain) {
+   chain->data = NULL;
+   chain->heap_data = NULL;
+   chain->mapping.data = NULL;
+
+   std::ifstream inf{source_path, std::ios::binary};
+   if(!inf) {
+      return false;
+   }
+   std::vector<unsigned char> source_bytes{std::istreambuf_iterator<char>(inf),
+					   std::istreambuf_iterator<char>()};
+
+   // @@ key covers the file contents plus everything that changes the decoded result
+   uint32_t key_params[3] = {TEXTURE_CACHE_VERSION, (uint32_t)srgb, 1 /* flipped on load */};
+   uint64_t key = hash_bytes(source_bytes.data(), source_bytes.size());
+   key = hash_bytes(key_params, sizeof(key_params), key);
+
+   std::string cache_path = cache_file_path(cache_dir, key);
+   // @!
+
+   if(texture_cache_open(cache_path, chain)) {
+      return true;
+   }
+
+   // @@ cold path: decode, build mips on the cpu, persist for next launch
+   int width = 0;
+   int height = 0;
+   int channels = 0;
+   stbi_set_flip_vertically_on_load_thread(true);
+   unsigned char *pixels = stbi_load_from_memory(source_bytes.data(), (int)source_bytes.size(),
+						 &width, &height, &channels, 0);
+   if(!pixels) {
+      return false;
+   }
+
+   // import: store in the smallest layout that loses nothing, see texture_minimal_channels
+   size_t texel_count = (size_t)width * height;
+   int stored_channels = texture_minimal_channels(pixels, texel_count, channels, srgb);
+   if(stored_channels != channels) {
+      std::vector<unsigned char> converted(texel_count * stored_channels);
+      texture_convert_channels(pixels, texel_count, channels, converted.data(), stored_channels);
+      build_mip_chain(converted.data(), width, height, stored_channels, srgb, chain);
+   } else {
+      build_mip_chain(pixels, width, height, channels, srgb, chain);
+   }
+   stbi_image_free(pixels);
+
+   texture_cache_store(cache_path, chain);
+   // @!
+
+   return true;
+}
+
+
+bool texture_cache_load_packed(std::string cache_dir, const std::vector<std::string> &channel_paths,
+			       TextureMipChain *chain) {
+   chain->data = NULL;
+   chain->heap_data = NULL;
+   chain->mapping.data = NULL;
+
+   int channels = (int)channel_paths.size();
+   if(channels < 1 || channels > 4) {
+      return false;
+   }
+
+   // @@ key over every source in channel order, an empty slot still changes the key
+   std::vector<std::vector<unsigned char>> sources(channels);
+   uint32_t key_params[3] = {TEXTURE_CACHE_VERSION, (uint32_t)channels, 1 /* flipped on load */};
+   uint64_t key = hash_bytes(key_params, sizeof(key_params));
+   for(int c = 0; c < channels; ++c) {
+      if(!channel_paths[c].empty()) {
+	 std::ifstream inf{channel_paths[c], std::ios::binary};
+	 if(!inf) {
+	    return false;
+	 }
+	 sources[c].assign(std::istreambuf_iterator<char>(inf), std::istreambuf_iterator<char>());
+      }
+      key = hash_bytes(sources[c].data(), sources[c].size(), key);
+      key = hash_bytes(&c, sizeof(c), key);
+   }
+   std::string cache_path = cache_file_path(cache_dir, key);
+   // @!
+
+   if(texture_cache_open(cache_path, chain)) {
+      return true;
+   }
+
+   // @@ cold path: take the red channel of each source and interleave, grey sources have it as their grey
+   // asking stb for one channel would give luminance, a mix of every colour channel
+   int width = 0;
+   int height = 0;
+   std::vector<unsigned char> packed;
+   stbi_set_flip_vertically_on_load_thread(true);
+   for(int c = 0; c < channels; ++c) {
+      if(sources[c].empty()) {
+	 continue;
+      }
+
+      int source_width, source_height, source_channels;
+      unsigned char *pixels = stbi_load_from_memory(sources[c].data(), (int)sources[c].size(),
+						    &source_width, &source_height, &source_channels, 0);
+      if(!pixels) {
+	 return false;
+      }
+      if(packed.empty()) {
+	 width = source_width;
+	 height = source_height;
+	 packed.assign((size_t)width * height * channels, 255);
+      } else if(source_width != width || source_height != height) {
+	 printf("@DEV_WARNING: packed channel %s is %dx%d, expected %dx%d\n", channel_paths[c].c_str(),
+		source_width, source_height, width, height);
+	 stbi_image_free(pixels);
+	 return false;
+      }
+      for(size_t i = 0; i < (size_t)width * height; ++i) {
+	 packed[i * channels + c] = pixels[i * source_channels];
+      }
+      stbi_image_free(pixels);
+   }
+   if(packed.empty()) {
+      return false;
+   }
+
+   build_mip_chain(packed.data(), width, height, channels, false, chain);
+   texture_cache_store(cache_path, chain);
+   // @!
+
+   return true;
+}
+
+
+void texture_mip_chain_convert(TextureMipChain *chain, int dst_channels) {
+   TextureMipChain converted = *chain;
+   converted.channels = dst_channels;
+   converted.mapping.data = NULL;
+   converted.mapping.size = 0;
+
+   size_t offset = 0;
+   for(int level = 0; level < chain->level_count; ++level) {
+      TextureMipLevel &mip = converted.levels[level];
+      mip.offset = offset;
+      mip.size = (size_t)mip.width * mip.height * dst_channels;
+      offset = (offset + mip.size + 15) & ~(size_t)15;
+   }
+   converted.data_size = offset;
+   converted.heap_data = (unsigned char *)malloc(offset);
+   converted.data = converted.heap_data;
+
+   for(int level = 0; level < chain->level_count; ++level) {
+      const TextureMipLevel &src = chain->levels[level];
+      texture_convert_channels(chain->data + src.offset, (size_t)src.width * src.height, chain->channels,
+			       converted.heap_data + converted.levels[level].offset, dst_channels);
+   }
+
+   texture_mip_chain_free(chain);
+   *chain = converted;
+}
+
+
+void texture_mip_chain_free(TextureMipChain *chain) {
+   file_map_close(&chain->mapping);
+   free(chain->heap_data);
+   chain->heap_data = NULL;
+   chain->data = NULL;
+}
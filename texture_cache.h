@@ -0,0 +1,90 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file_map.h"
+
+
+const int TEXTURE_MAX_MIP_LEVELS = 16;
+
+enum TextureBlockFormat {
+   TEXTURE_BLOCK_NONE,
+   TEXTURE_BLOCK_BC1,
+   TEXTURE_BLOCK_BC3,
+   TEXTURE_BLOCK_BC7
+};
+
+struct TextureMipLevel {
+   int width;
+   int height;
+   size_t offset;
+   size_t size;
+};
+
+// full mip chain of 8 bit texels (or 4x4 blocks when block_format is set), level offsets are
+// relative to data. data points either into mapping (warm start) or into heap_data
+struct TextureMipChain {
+   int width;
+   int height;
+   int channels;
+   int level_count;
+   TextureBlockFormat block_format;
+   bool srgb;
+   TextureMipLevel levels[TEXTURE_MAX_MIP_LEVELS];
+
+   const unsigned char *data;
+   size_t data_size;
+
+   FileMapping mapping;
+   unsigned char *heap_data;
+};
+
+
+// @@ channel layouts, 1 is grey, 2 is grey + alpha, 3 is RGB, 4 is RGBA
+// smallest layout that holds pixels without loss: opaque alpha is dropped and, for linear data,
+// grey colour collapses to one channel. sRGB content keeps three colour channels since core GL
+// has no one or two channel sRGB formats
+int texture_minimal_channels(const unsigned char *pixels, size_t texel_count, int channels, bool srgb);
+
+// widening replicates grey and fills alpha with 255, narrowing to grey keeps the red channel
+void texture_convert_channels(const unsigned char *src, size_t texel_count, int src_channels,
+			      unsigned char *dst, int dst_channels);
+
+// rewrites every level of chain into dst_channels, the result always lives on the heap
+void texture_mip_chain_convert(TextureMipChain *chain, int dst_channels);
+// @!
+
+
+// srgb marks the colour channels as sRGB encoded so filtering happens in linear space, alpha
+// is always filtered linearly
+void build_mip_chain(const unsigned char *pixels, int width, int height, int channels, bool srgb,
+		     TextureMipChain *chain);
+
+// looks up source_path in cache_dir by content hash, on a miss decodes, builds mips, writes the
+// cache file and maps it. safe to call from worker threads
+bool texture_cache_load(std::string cache_dir, std::string source_path, bool srgb,
+			TextureMipChain *chain);
+
+// packs the first (red) channel of every source into one linear texture, channel i comes from
+// channel_paths[i] (e.g. occlusion, roughness, metalness). an empty path fills its channel with 255
+// every source must have the same size
+bool texture_cache_load_packed(std::string cache_dir, const std::vector<std::string> &channel_paths,
+			       TextureMipChain *chain);
+
+void texture_mip_chain_free(TextureMipChain *chain);
@@ -0,0 +1,936 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "texture_cooker.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXTURE_COOKER_SSE2
+#endif
+
+
+// @@ endpoint fitting shared by every codec
+// pixels are float RGBA in [0, 255], palettes are stored channel-major so four entries load at once
+
+static void principal_axis(const float (*pixels)[4], int channels, float *mean, float *axis) {
+   for(int c = 0; c < 4; ++c) {
+      mean[c] = 0.0f;
+      axis[c] = 0.0f;
+   }
+   for(int i = 0; i < 16; ++i) {
+      for(int c = 0; c < channels; ++c) {
+	 mean[c] += pixels[i][c] / 16.0f;
+      }
+   }
+
+   float covariance[4][4] = {};
+   for(int i = 0; i < 16; ++i) {
+      for(int a = 0; a < channels; ++a) {
+	 for(int b = 0; b < channels; ++b) {
+	    covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+	 }
+      }
+   }
+
+   // power iteration, a handful of steps is plenty for a 4x4 block
+   for(int c = 0; c < channels; ++c) {
+      axis[c] = 1.0f;
+   }
+   for(int iteration = 0; iteration < 8; ++iteration) {
+      float next[4] = {};
+      float length = 0.0f;
+      for(int a = 0; a < channels; ++a) {
+	 for(int b = 0; b < channels; ++b) {
+	    next[a] += covariance[a][b] * axis[b];
+	 }
+	 length += next[a] * next[a];
+      }
+      if(length < 1e-12f) {
+	 break;
+      }
+      length = sqrtf(length);
+      for(int c = 0; c < channels; ++c) {
+	 axis[c] = next[c] / length;
+      }
+   }
+}
+
+
+static void endpoints_along_axis(const float (*pixels)[4], int channels, float *e0, float *e1) {
+   float mean[4];
+   float axis[4];
+   principal_axis(pixels, channels, mean, axis);
+
+   float t_min = 1e30f;
+   float t_max = -1e30f;
+   for(int i = 0; i < 16; ++i) {
+      float t = 0.0f;
+      for(int c = 0; c < channels; ++c) {
+	 t += (pixels[i][c] - mean[c]) * axis[c];
+      }
+      t_min = std::min(t_min, t);
+      t_max = std::max(t_max, t);
+   }
+
+   for(int c = 0; c < channels; ++c) {
+      e0[c] = std::min(std::max(mean[c] + axis[c] * t_min, 0.0f), 255.0f);
+      e1[c] = std::min(std::max(mean[c] + axis[c] * t_max, 0.0f), 255.0f);
+   }
+}
+
+
+// palette_size must be a multiple of 4, returns the squared error of the chosen entry
+static float nearest_palette_index(const float *palette, int palette_size, int channels,
+				   const float *pixel, unsigned char *index) {
+   float best_error = 1e30f;
+   int best_index = 0;
+
+   for(int i = 0; i < palette_size; i += 4) {
+      float errors[4];
+#ifdef TEXTURE_COOKER_SSE2
+      __m128 error = _mm_setzero_ps();
+      for(int c = 0; c < channels; ++c) {
+	 __m128 diff = _mm_sub_ps(_mm_loadu_ps(palette + c * palette_size + i), _mm_set1_ps(pixel[c]));
+	 error = _mm_add_ps(error, _mm_mul_ps(diff, diff));
+      }
+      _mm_storeu_ps(errors, error);
+#else
+      for(int lane = 0; lane < 4; ++lane) {
+	 errors[lane] = 0.0f;
+	 for(int c = 0; c < channels; ++c) {
+	    float diff = palette[c * palette_size + i + lane] - pixel[c];
+	    errors[lane] += diff * diff;
+	 }
+      }
+#endif
+      for(int lane = 0; lane < 4; ++lane) {
+	 if(errors[lane] < best_error) {
+	    best_error = errors[lane];
+	    best_index = i + lane;
+	 }
+      }
+   }
+
+   *index = (unsigned char)best_index;
+   return best_error;
+}
+
+
+// weights[k] is how much of e1 palette entry k holds, solves for the endpoints that best
+// reproduce the block given the current indices
+static bool least_squares_endpoints(const float (*pixels)[4], int channels, const unsigned char *indices,
+				    const float *weights, float *e0, float *e1) {
+   float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+   float ax[4] = {}, bx[4] = {};
+   for(int i = 0; i < 16; ++i) {
+      float b = weights[indices[i]];
+      float a = 1.0f - b;
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for(int c = 0; c < channels; ++c) {
+	 ax[c] += a * pixels[i][c];
+	 bx[c] += b * pixels[i][c];
+      }
+   }
+
+   float determinant = aa * bb - ab * ab;
+   if(fabsf(determinant) < 1e-6f) {
+      return false;
+   }
+   for(int c = 0; c < channels; ++c) {
+      e0[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+      e1[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+   }
+   return true;
+}
+
+
+static void load_block_pixels(const unsigned char *rgba, float (*pixels)[4]) {
+   for(int i = 0; i < 16; ++i) {
+      for(int c = 0; c < 4; ++c) {
+	 pixels[i][c] = rgba[i * 4 + c];
+      }
+   }
+}
+// @!
+
+
+// @@ BC1
+static uint16_t pack_565(const float *color) {
+   int r = std::min(std::max((int)(color[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+   int g = std::min(std::max((int)(color[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+   int b = std::min(std::max((int)(color[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+   return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(uint16_t packed, int *color) {
+   int r = (packed >> 11) & 31;
+   int g = (packed >> 5) & 63;
+   int b = packed & 31;
+   color[0] = (r << 3) | (r >> 2);
+   color[1] = (g << 2) | (g >> 4);
+   color[2] = (b << 3) | (b >> 2);
+}
+
+static const float BC1_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+static float bc1_choose_indices(const float (*pixels)[4], uint16_t c0, uint16_t c1,
+				unsigned char *indices) {
+   int e0[3];
+   int e1[3];
+   unpack_565(c0, e0);
+   unpack_565(c1, e1);
+
+   float palette[3 * 4];
+   for(int c = 0; c < 3; ++c) {
+      palette[c * 4 + 0] = (float)e0[c];
+      palette[c * 4 + 1] = (float)e1[c];
+      palette[c * 4 + 2] = (float)((2 * e0[c] + e1[c] + 1) / 3);
+      palette[c * 4 + 3] = (float)((e0[c] + 2 * e1[c] + 1) / 3);
+   }
+
+   float error = 0.0f;
+   for(int i = 0; i < 16; ++i) {
+      error += nearest_palette_index(palette, 4, 3, pixels[i], &indices[i]);
+   }
+   return error;
+}
+
+static void bc1_encode_color(const float (*pixels)[4], unsigned char *block) {
+   float e0[4];
+   float e1[4];
+   endpoints_along_axis(pixels, 3, e0, e1);
+
+   uint16_t c0 = pack_565(e1);
+   uint16_t c1 = pack_565(e0);
+   unsigned char indices[16];
+   float error = bc1_choose_indices(pixels, c0, c1, indices);
+
+   // one refinement pass from the chosen indices
+   if(least_squares_endpoints(pixels, 3, indices, BC1_WEIGHTS, e0, e1)) {
+      uint16_t refined_c0 = pack_565(e0);
+      uint16_t refined_c1 = pack_565(e1);
+      unsigned char refined_indices[16];
+      float refined_error = bc1_choose_indices(pixels, refined_c0, refined_c1, refined_indices);
+      if(refined_error < error) {
+	 c0 = refined_c0;
+	 c1 = refined_c1;
+	 memcpy(indices, refined_indices, 16);
+      }
+   }
+
+   // four colour mode needs c0 > c1, swapping endpoints flips 0<->1 and 2<->3
+   if(c0 < c1) {
+      std::swap(c0, c1);
+      for(int i = 0; i < 16; ++i) {
+	 indices[i] ^= 1;
+      }
+   } else if(c0 == c1) {
+      memset(indices, 0, 16);
+   }
+
+   block[0] = c0 & 0xff;
+   block[1] = c0 >> 8;
+   block[2] = c1 & 0xff;
+   block[3] = c1 >> 8;
+   uint32_t index_bits = 0;
+   for(int i = 0; i < 16; ++i) {
+      index_bits |= (uint32_t)indices[i] << (2 * i);
+   }
+   memcpy(block + 4, &index_bits, 4);
+}
+
+static void bc1_decode_color(const unsigned char *block, unsigned char *rgba, bool force_four_color) {
+   uint16_t c0 = block[0] | (block[1] << 8);
+   uint16_t c1 = block[2] | (block[3] << 8);
+   int e0[3];
+   int e1[3];
+   unpack_565(c0, e0);
+   unpack_565(c1, e1);
+
+   int palette[4][4];
+   for(int c = 0; c < 3; ++c) {
+      palette[0][c] = e0[c];
+      palette[1][c] = e1[c];
+      if(c0 > c1 || force_four_color) {
+	 palette[2][c] = (2 * e0[c] + e1[c] + 1) / 3;
+	 palette[3][c] = (e0[c] + 2 * e1[c] + 1) / 3;
+      } else {
+	 palette[2][c] = (e0[c] + e1[c]) / 2;
+	 palette[3][c] = 0;
+      }
+   }
+   palette[0][3] = palette[1][3] = palette[2][3] = 255;
+   palette[3][3] = (c0 > c1 || force_four_color) ? 255 : 0;
+
+   uint32_t index_bits;
+   memcpy(&index_bits, block + 4, 4);
+   for(int i = 0; i < 16; ++i) {
+      int index = (index_bits >> (2 * i)) & 3;
+      for(int c = 0; c < 4; ++c) {
+	 rgba[i * 4 + c] = (unsigned char)palette[index][c];
+      }
+   }
+}
+
+void encode_block_bc1(const unsigned char *rgba, unsigned char *block) {
+   float pixels[16][4];
+   load_block_pixels(rgba, pixels);
+   bc1_encode_color(pixels, block);
+}
+
+void decode_block_bc1(const unsigned char *block, unsigned char *rgba) {
+   bc1_decode_color(block, rgba, false);
+}
+// @!
+
+
+// @@ BC3, BC4 style alpha block followed by a four colour BC1 block
+static void bc3_alpha_palette(int a0, int a1, int *palette) {
+   palette[0] = a0;
+   palette[1] = a1;
+   if(a0 > a1) {
+      for(int i = 2; i < 8; ++i) {
+	 palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+      }
+   } else {
+      for(int i = 2; i < 6; ++i) {
+	 palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+      }
+      palette[6] = 0;
+      palette[7] = 255;
+   }
+}
+
+void encode_block_bc3(const unsigned char *rgba, unsigned char *block) {
+   float pixels[16][4];
+   load_block_pixels(rgba, pixels);
+
+   int a0 = 0;
+   int a1 = 255;
+   for(int i = 0; i < 16; ++i) {
+      a0 = std::max(a0, (int)rgba[i * 4 + 3]);
+      a1 = std::min(a1, (int)rgba[i * 4 + 3]);
+   }
+
+   unsigned char indices[16] = {};
+   if(a0 != a1) {
+      int palette[8];
+      bc3_alpha_palette(a0, a1, palette);
+      float palette_soa[8];
+      for(int i = 0; i < 8; ++i) {
+	 palette_soa[i] = (float)palette[i];
+      }
+      for(int i = 0; i < 16; ++i) {
+	 nearest_palette_index(palette_soa, 8, 1, &pixels[i][3], &indices[i]);
+      }
+   }
+
+   block[0] = (unsigned char)a0;
+   block[1] = (unsigned char)a1;
+   uint64_t index_bits = 0;
+   for(int i = 0; i < 16; ++i) {
+      index_bits |= (uint64_t)indices[i] << (3 * i);
+   }
+   for(int i = 0; i < 6; ++i) {
+      block[2 + i] = (unsigned char)(index_bits >> (8 * i));
+   }
+
+   bc1_encode_color(pixels, block + 8);
+}
+
+void decode_block_bc3(const unsigned char *block, unsigned char *rgba) {
+   bc1_decode_color(block + 8, rgba, true);
+
+   int palette[8];
+   bc3_alpha_palette(block[0], block[1], palette);
+   uint64_t index_bits = 0;
+   for(int i = 0; i < 6; ++i) {
+      index_bits |= (uint64_t)block[2 + i] << (8 * i);
+   }
+   for(int i = 0; i < 16; ++i) {
+      rgba[i * 4 + 3] = (unsigned char)palette[(index_bits >> (3 * i)) & 7];
+   }
+}
+// @!
+
+
+// @@ BC7 mode 6: 7 bit RGBA endpoints plus a shared bit each, 16 interpolation steps
+static const int BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct BitWriter {
+   unsigned char *bytes;
+   int position;
+};
+
+static void write_bits(BitWriter *writer, uint32_t value, int count) {
+   for(int i = 0; i < count; ++i) {
+      int bit = writer->position + i;
+      writer->bytes[bit >> 3] |= ((value >> i) & 1) << (bit & 7);
+   }
+   writer->position += count;
+}
+
+static uint32_t read_bits(const unsigned char *bytes, int *position, int count) {
+   uint32_t value = 0;
+   for(int i = 0; i < count; ++i) {
+      int bit = *position + i;
+      value |= (uint32_t)((bytes[bit >> 3] >> (bit & 7)) & 1) << i;
+   }
+   *position += count;
+   return value;
+}
+
+// picks the shared bit that best fits all four channels, quantized holds the 7 bit values
+static void bc7_quantize_endpoint(const float *endpoint, int *quantized, int *p_bit, int *expanded) {
+   float best_error = 1e30f;
+   for(int p = 0; p < 2; ++p) {
+      int candidate[4];
+      float error = 0.0f;
+      for(int c = 0; c < 4; ++c) {
+	 candidate[c] = std::min(std::max((int)floorf((endpoint[c] - p) / 2.0f + 0.5f), 0), 127);
+	 float diff = (float)((candidate[c] << 1) | p) - endpoint[c];
+	 error += diff * diff;
+      }
+      if(error < best_error) {
+	 best_error = error;
+	 *p_bit = p;
+	 for(int c = 0; c < 4; ++c) {
+	    quantized[c] = candidate[c];
+	    expanded[c] = (candidate[c] << 1) | p;
+	 }
+      }
+   }
+}
+
+static float bc7_choose_indices(const float (*pixels)[4], const int *e0, const int *e1,
+				unsigned char *indices) {
+   float palette[4 * 16];
+   for(int i = 0; i < 16; ++i) {
+      for(int c = 0; c < 4; ++c) {
+	 palette[c * 16 + i] = (float)(((64 - BC7_WEIGHTS_4[i]) * e0[c] + BC7_WEIGHTS_4[i] * e1[c] + 32) >> 6);
+      }
+   }
+
+   float error = 0.0f;
+   for(int i = 0; i < 16; ++i) {
+      error += nearest_palette_index(palette, 16, 4, pixels[i], &indices[i]);
+   }
+   return error;
+}
+
+void encode_block_bc7(const unsigned char *rgba, unsigned char *block) {
+   float pixels[16][4];
+   load_block_pixels(rgba, pixels);
+
+   float e0[4];
+   float e1[4];
+   endpoints_along_axis(pixels, 4, e0, e1);
+
+   int q0[4], q1[4], x0[4], x1[4], p0, p1;
+   bc7_quantize_endpoint(e0, q0, &p0, x0);
+   bc7_quantize_endpoint(e1, q1, &p1, x1);
+   unsigned char indices[16];
+   float error = bc7_choose_indices(pixels, x0, x1, indices);
+
+   float weights[16];
+   for(int i = 0; i < 16; ++i) {
+      weights[i] = BC7_WEIGHTS_4[i] / 64.0f;
+   }
+   for(int iteration = 0; iteration < 2; ++iteration) {
+      if(!least_squares_endpoints(pixels, 4, indices, weights, e0, e1)) {
+	 break;
+      }
+      int rq0[4], rq1[4], rx0[4], rx1[4], rp0, rp1;
+      bc7_quantize_endpoint(e0, rq0, &rp0, rx0);
+      bc7_quantize_endpoint(e1, rq1, &rp1, rx1);
+      unsigned char refined_indices[16];
+      float refined_error = bc7_choose_indices(pixels, rx0, rx1, refined_indices);
+      if(refined_error >= error) {
+	 break;
+      }
+      error = refined_error;
+      memcpy(indices, refined_indices, 16);
+      memcpy(q0, rq0, sizeof(q0));
+      memcpy(q1, rq1, sizeof(q1));
+      p0 = rp0;
+      p1 = rp1;
+   }
+
+   // the anchor index is stored with its top bit implied zero
+   if(indices[0] & 8) {
+      std::swap(q0, q1);
+      std::swap(p0, p1);
+      for(int i = 0; i < 16; ++i) {
+	 indices[i] = 15 - indices[i];
+      }
+   }
+
+   memset(block, 0, BC7_BLOCK_BYTES);
+   BitWriter writer{block, 0};
+   write_bits(&writer, 1 << 6, 7);
+   for(int c = 0; c < 4; ++c) {
+      write_bits(&writer, q0[c], 7);
+      write_bits(&writer, q1[c], 7);
+   }
+   write_bits(&writer, p0, 1);
+   write_bits(&writer, p1, 1);
+   write_bits(&writer, indices[0], 3);
+   for(int i = 1; i < 16; ++i) {
+      write_bits(&writer, indices[i], 4);
+   }
+}
+
+bool decode_block_bc7(const unsigned char *block, unsigned char *rgba) {
+   if((block[0] & 0x7f) != (1 << 6)) {
+      memset(rgba, 0, 64);
+      return false;
+   }
+
+   int position = 7;
+   int q0[4];
+   int q1[4];
+   for(int c = 0; c < 4; ++c) {
+      q0[c] = read_bits(block, &position, 7);
+      q1[c] = read_bits(block, &position, 7);
+   }
+   int p0 = read_bits(block, &position, 1);
+   int p1 = read_bits(block, &position, 1);
+
+   for(int i = 0; i < 16; ++i) {
+      int index = read_bits(block, &position, i == 0 ? 3 : 4);
+      int weight = BC7_WEIGHTS_4[index];
+      for(int c = 0; c < 4; ++c) {
+	 int e0 = (q0[c] << 1) | p0;
+	 int e1 = (q1[c] << 1) | p1;
+	 rgba[i * 4 + c] = (unsigned char)(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+      }
+   }
+   return true;
+}
+// @!
+
+
+int block_format_bytes(TextureBlockFormat format) {
+   switch(format) {
+   case TEXTURE_BLOCK_BC1: return BC1_BLOCK_BYTES;
+   case TEXTURE_BLOCK_BC3: return BC3_BLOCK_BYTES;
+   case TEXTURE_BLOCK_BC7: return BC7_BLOCK_BYTES;
+   default: return 0;
+   }
+}
+
+static void encode_block(TextureBlockFormat format, const unsigned char *rgba, unsigned char *block) {
+   switch(format) {
+   case TEXTURE_BLOCK_BC1: encode_block_bc1(rgba, block); break;
+   case TEXTURE_BLOCK_BC3: encode_block_bc3(rgba, block); break;
+   case TEXTURE_BLOCK_BC7: encode_block_bc7(rgba, block); break;
+   default: break;
+   }
+}
+
+static void decode_block(TextureBlockFormat format, const unsigned char *block, unsigned char *rgba) {
+   switch(format) {
+   case TEXTURE_BLOCK_BC1: decode_block_bc1(block, rgba); break;
+   case TEXTURE_BLOCK_BC3: decode_block_bc3(block, rgba); break;
+   case TEXTURE_BLOCK_BC7: decode_block_bc7(block, rgba); break;
+   default: break;
+   }
+}
+
+
+// @@ KTX2 container, see the Khronos KTX 2.0 spec. only the subset cook_texture writes is read back
+static const unsigned char KTX2_IDENTIFIER[12] = {
+   0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+// the spec packs sgd_byte_offset right after kvd_byte_length at byte 60 of the header, natural
+// alignment would pad it to 64 and push the level index from byte 80 to 84
+#pragma pack(push, 4)
+struct Ktx2Header {
+   uint32_t vk_format;
+   uint32_t type_size;
+   uint32_t pixel_width;
+   uint32_t pixel_height;
+   uint32_t pixel_depth;
+   uint32_t layer_count;
+   uint32_t face_count;
+   uint32_t level_count;
+   uint32_t supercompression_scheme;
+   uint32_t dfd_byte_offset;
+   uint32_t dfd_byte_length;
+   uint32_t kvd_byte_offset;
+   uint32_t kvd_byte_length;
+   uint64_t sgd_byte_offset;
+   uint64_t sgd_byte_length;
+};
+#pragma pack(pop)
+static_assert(sizeof(Ktx2Header) == 68, "KTX2 header must be 68 bytes");
+
+struct Ktx2LevelIndex {
+   uint64_t byte_offset;
+   uint64_t byte_length;
+   uint64_t uncompressed_byte_length;
+};
+
+static uint32_t ktx2_vk_format(TextureBlockFormat format, bool srgb) {
+   switch(format) {
+   case TEXTURE_BLOCK_BC1: return srgb ? 132 : 131; // VK_FORMAT_BC1_RGB_{SRGB,UNORM}_BLOCK
+   case TEXTURE_BLOCK_BC3: return srgb ? 138 : 137; // VK_FORMAT_BC3_{SRGB,UNORM}_BLOCK
+   case TEXTURE_BLOCK_BC7: return srgb ? 146 : 145; // VK_FORMAT_BC7_{SRGB,UNORM}_BLOCK
+   default: return 0;
+   }
+}
+
+static bool ktx2_block_format(uint32_t vk_format, TextureBlockFormat *format, bool *srgb) {
+   for(TextureBlockFormat candidate : {TEXTURE_BLOCK_BC1, TEXTURE_BLOCK_BC3, TEXTURE_BLOCK_BC7}) {
+      for(bool candidate_srgb : {false, true}) {
+	 if(ktx2_vk_format(candidate, candidate_srgb) == vk_format) {
+	    *format = candidate;
+	    *srgb = candidate_srgb;
+	    return true;
+	 }
+      }
+   }
+   return false;
+}
+
+static void push_u32(std::vector<unsigned char> &bytes, uint32_t value) {
+   for(int i = 0; i < 4; ++i) {
+      bytes.push_back((unsigned char)(value >> (8 * i)));
+   }
+}
+
+// basic data format descriptor, one 16 byte sample per 64 bit slice of the block
+static std::vector<unsigned char> ktx2_data_format_descriptor(TextureBlockFormat format, bool srgb) {
+   const uint32_t KHR_DF_MODEL_BC1A = 128;
+   const uint32_t KHR_DF_MODEL_BC3 = 130;
+   const uint32_t KHR_DF_MODEL_BC7 = 134;
+   const uint32_t KHR_DF_CHANNEL_COLOR = 0;
+   const uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+
+   uint32_t color_model = KHR_DF_MODEL_BC1A;
+   if(format == TEXTURE_BLOCK_BC3) color_model = KHR_DF_MODEL_BC3;
+   if(format == TEXTURE_BLOCK_BC7) color_model = KHR_DF_MODEL_BC7;
+
+   struct Sample { uint32_t bit_offset; uint32_t bit_length; uint32_t channel; };
+   std::vector<Sample> samples;
+   if(format == TEXTURE_BLOCK_BC1) {
+      samples.push_back({0, 64, KHR_DF_CHANNEL_COLOR});
+   } else if(format == TEXTURE_BLOCK_BC3) {
+      samples.push_back({0, 64, KHR_DF_CHANNEL_ALPHA});
+      samples.push_back({64, 64, KHR_DF_CHANNEL_COLOR});
+   } else {
+      samples.push_back({0, 128, KHR_DF_CHANNEL_COLOR});
+   }
+
+   uint32_t block_size = 24 + 16 * (uint32_t)samples.size();
+   std::vector<unsigned char> bytes;
+   push_u32(bytes, 4 + block_size);
+   push_u32(bytes, 0);                                   // vendor khronos, basic descriptor
+   push_u32(bytes, 2 | (block_size << 16));              // version 1.3
+   push_u32(bytes, color_model | (1 << 8) | ((srgb ? 2 : 1) << 16)); // BT.709, transfer
+   push_u32(bytes, 3 | (3 << 8));                        // 4x4x1x1 texel block
+   push_u32(bytes, (uint32_t)block_format_bytes(format));
+   push_u32(bytes, 0);
+   for(const Sample &sample : samples) {
+      push_u32(bytes, sample.bit_offset | ((sample.bit_length - 1) << 16) | (sample.channel << 24));
+      push_u32(bytes, 0);
+      push_u32(bytes, 0);
+      push_u32(bytes, 0xffffffff);
+   }
+   return bytes;
+}
+
+
+static bool ktx2_write(std::string path, const TextureMipChain *chain) {
+   std::vector<unsigned char> dfd = ktx2_data_format_descriptor(chain->block_format, chain->srgb);
+
+   const char writer_key[] = "KTXwriter";
+   const char writer_value[] = "LearnOpenGL texture_cooker";
+   std::vector<unsigned char> kvd;
+   push_u32(kvd, sizeof(writer_key) + sizeof(writer_value));
+   kvd.insert(kvd.end(), writer_key, writer_key + sizeof(writer_key));
+   kvd.insert(kvd.end(), writer_value, writer_value + sizeof(writer_value));
+   while(kvd.size() % 4) {
+      kvd.push_back(0);
+   }
+
+   Ktx2Header header;
+   memset(&header, 0, sizeof(header));
+   header.vk_format = ktx2_vk_format(chain->block_format, chain->srgb);
+   header.type_size = 1;
+   header.pixel_width = chain->width;
+   header.pixel_height = chain->height;
+   header.face_count = 1;
+   header.level_count = chain->level_count;
+   header.dfd_byte_offset = (uint32_t)(sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header) +
+				       sizeof(Ktx2LevelIndex) * chain->level_count);
+   header.dfd_byte_length = (uint32_t)dfd.size();
+   header.kvd_byte_offset = header.dfd_byte_offset + header.dfd_byte_length;
+   header.kvd_byte_length = (uint32_t)kvd.size();
+
+   // level data goes smallest first, each level aligned to the block size
+   size_t alignment = block_format_bytes(chain->block_format);
+   size_t offset = header.kvd_byte_offset + header.kvd_byte_length;
+   std::vector<Ktx2LevelIndex> level_index(chain->level_count);
+   for(int level = chain->level_count - 1; level >= 0; --level) {
+      offset = (offset + alignment - 1) / alignment * alignment;
+      level_index[level].byte_offset = offset;
+      level_index[level].byte_length = chain->levels[level].size;
+      level_index[level].uncompressed_byte_length = chain->levels[level].size;
+      offset += chain->levels[level].size;
+   }
+
+   std::vector<unsigned char> file_bytes(offset, 0);
+   unsigned char *cursor = file_bytes.data();
+   memcpy(cursor, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+   memcpy(cursor + sizeof(KTX2_IDENTIFIER), &header, sizeof(header));
+   memcpy(cursor + sizeof(KTX2_IDENTIFIER) + sizeof(header), level_index.data(),
+	  sizeof(Ktx2LevelIndex) * level_index.size());
+   memcpy(cursor + header.dfd_byte_offset, dfd.data(), dfd.size());
+   memcpy(cursor + header.kvd_byte_offset, kvd.data(), kvd.size());
+   for(int level = 0; level < chain->level_count; ++level) {
+      memcpy(cursor + level_index[level].byte_offset, chain->data + chain->levels[level].offset,
+	     chain->levels[level].size);
+   }
+
+   return file_write_atomic(path, file_bytes.data(), file_bytes.size());
+}
+
+
+bool ktx2_load(std::string path, TextureMipChain *chain) {
+   chain->heap_data = NULL;
+   chain->data = NULL;
+   if(!file_map_open(path, &chain->mapping)) {
+      return false;
+   }
+
+   const FileMapping &mapping = chain->mapping;
+   size_t header_end = sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header);
+   Ktx2Header header;
+   bool valid = mapping.size >= header_end &&
+      memcmp(mapping.data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+   if(valid) {
+      memcpy(&header, mapping.data + sizeof(KTX2_IDENTIFIER), sizeof(header));
+      valid = header.supercompression_scheme == 0 && header.pixel_width >= 1 && header.pixel_height >= 1 &&
+	 header.pixel_depth == 0 &&
+	 header.layer_count == 0 && header.face_count == 1 && header.level_count >= 1 &&
+	 header.level_count <= (uint32_t)TEXTURE_MAX_MIP_LEVELS &&
+	 header_end + sizeof(Ktx2LevelIndex) * header.level_count <= mapping.size &&
+	 ktx2_block_format(header.vk_format, &chain->block_format, &chain->srgb);
+   }
+   if(!valid) {
+      file_map_close(&chain->mapping);
+      return false;
+   }
+
+   Ktx2LevelIndex level_index[TEXTURE_MAX_MIP_LEVELS];
+   memcpy(level_index, mapping.data + header_end, sizeof(Ktx2LevelIndex) * header.level_count);
+
+   // every level has to be exactly its block count, which also turns away files from before the header
+   // was packed, their level index sits 4 bytes later and reads back as nonsense
+   int block_bytes = block_format_bytes(chain->block_format);
+   uint64_t data_begin = mapping.size;
+   uint64_t data_end = 0;
+   for(uint32_t level = 0; level < header.level_count; ++level) {
+      uint64_t blocks_x = (std::max(1u, header.pixel_width >> level) + 3) / 4;
+      uint64_t blocks_y = (std::max(1u, header.pixel_height >> level) + 3) / 4;
+      uint64_t end = level_index[level].byte_offset + level_index[level].byte_length;
+      if(end > mapping.size || end < level_index[level].byte_offset ||
+	 level_index[level].byte_length != blocks_x * blocks_y * block_bytes) {
+	 file_map_close(&chain->mapping);
+	 return false;
+      }
+      data_begin = std::min(data_begin, level_index[level].byte_offset);
+      data_end = std::max(data_end, end);
+   }
+
+   chain->width = header.pixel_width;
+   chain->height = header.pixel_height;
+   chain->channels = chain->block_format == TEXTURE_BLOCK_BC1 ? 3 : 4;
+   chain->level_count = header.level_count;
+   for(int level = 0; level < chain->level_count; ++level) {
+      chain->levels[level].width = std::max(1, chain->width >> level);
+      chain->levels[level].height = std::max(1, chain->height >> level);
+      chain->levels[level].offset = level_index[level].byte_offset - data_begin;
+      chain->levels[level].size = level_index[level].byte_length;
+   }
+   chain->data = mapping.data + data_begin;
+   chain->data_size = data_end - data_begin;
+   return true;
+}
+// @!
+
+
+// @@ cooking
+static void gather_block(const unsigned char *texels, int width, int height, int block_x, int block_y,
+			 unsigned char *rgba) {
+   for(int y = 0; y < 4; ++y) {
+      int source_y = std::min(block_y * 4 + y, height - 1);
+      for(int x = 0; x < 4; ++x) {
+	 int source_x = std::min(block_x * 4 + x, width - 1);
+	 memcpy(rgba + (y * 4 + x) * 4, texels + ((size_t)source_y * width + source_x) * 4, 4);
+      }
+   }
+}
+
+bool cook_texture(ThreadPool *pool, std::string source_path, std::string out_path,
+		  TextureBlockFormat format, bool srgb, CookStats *stats) {
+   int width = 0;
+   int height = 0;
+   int channels = 0;
+   stbi_set_flip_vertically_on_load_thread(true);
+   unsigned char *pixels = stbi_load(source_path.c_str(), &width, &height, &channels, 4);
+   if(!pixels) {
+      return false;
+   }
+
+   TextureMipChain source;
+   build_mip_chain(pixels, width, height, 4, srgb, &source);
+   stbi_image_free(pixels);
+
+   // @@ compressed layout mirrors the source chain level for level
+   int block_bytes = block_format_bytes(format);
+   TextureMipChain cooked = source;
+   cooked.block_format = format;
+   cooked.channels = format == TEXTURE_BLOCK_BC1 ? 3 : 4;
+   size_t offset = 0;
+   for(int level = 0; level < cooked.level_count; ++level) {
+      TextureMipLevel &mip = cooked.levels[level];
+      mip.offset = offset;
+      mip.size = (size_t)((mip.width + 3) / 4) * ((mip.height + 3) / 4) * block_bytes;
+      offset += mip.size;
+   }
+   cooked.data_size = offset;
+   cooked.heap_data = (unsigned char *)malloc(offset);
+   cooked.data = cooked.heap_data;
+   cooked.mapping.data = NULL;
+   // @!
+
+   auto encode_begin = std::chrono::steady_clock::now();
+   stats->texels_encoded = 0;
+   for(int level = 0; level < cooked.level_count; ++level) {
+      const TextureMipLevel &mip = cooked.levels[level];
+      const unsigned char *texels = source.data + source.levels[level].offset;
+      unsigned char *blocks = cooked.heap_data + mip.offset;
+      int blocks_x = (mip.width + 3) / 4;
+      int blocks_y = (mip.height + 3) / 4;
+
+      thread_pool_parallel_for(pool, blocks_y, 4, [&](int begin, int end) {
+	 unsigned char rgba[64];
+	 for(int block_y = begin; block_y < end; ++block_y) {
+	    for(int block_x = 0; block_x < blocks_x; ++block_x) {
+	       gather_block(texels, mip.width, mip.height, block_x, block_y, rgba);
+	       encode_block(format, rgba, blocks + ((size_t)block_y * blocks_x + block_x) * block_bytes);
+	    }
+	 }
+      });
+      stats->texels_encoded += (long long)mip.width * mip.height;
+   }
+   stats->encode_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - encode_begin).count();
+
+   // @@ round trip level 0 for quality, BC1 carries no alpha so it is left out of the error
+   double squared_error = 0.0;
+   int compared_channels = format == TEXTURE_BLOCK_BC1 ? 3 : 4;
+   int blocks_x = (width + 3) / 4;
+   for(int block_y = 0; block_y < (height + 3) / 4; ++block_y) {
+      for(int block_x = 0; block_x < blocks_x; ++block_x) {
+	 unsigned char original[64];
+	 unsigned char decoded[64];
+	 gather_block(source.data, width, height, block_x, block_y, original);
+	 decode_block(format, cooked.data + ((size_t)block_y * blocks_x + block_x) * block_bytes, decoded);
+	 for(int y = 0; y < 4 && block_y * 4 + y < height; ++y) {
+	    for(int x = 0; x < 4 && block_x * 4 + x < width; ++x) {
+	       for(int c = 0; c < compared_channels; ++c) {
+		  double diff = (double)original[(y * 4 + x) * 4 + c] - decoded[(y * 4 + x) * 4 + c];
+		  squared_error += diff * diff;
+	       }
+	    }
+	 }
+      }
+   }
+   double mse = squared_error / ((double)width * height * compared_channels);
+   stats->psnr_level_0 = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+   // @!
+
+   bool written = ktx2_write(out_path, &cooked);
+   texture_mip_chain_free(&cooked);
+   texture_mip_chain_free(&source);
+   return written;
+}
+// @!
+
+
+// level 0 PSNR a cook must reach for --cook to pass, a few dB under what each encoder gets on the
+// sample photos (BC1 37-40, BC3 38-41, BC7 46-47)
+static double minimum_psnr(TextureBlockFormat format) {
+   switch(format) {
+   case TEXTURE_BLOCK_BC1: return 33.0;
+   case TEXTURE_BLOCK_BC3: return 34.0;
+   case TEXTURE_BLOCK_BC7: return 42.0;
+   default: return 0.0;
+   }
+}
+
+int cook_command(int argc, char **argv) {
+   if(argc < 5) {
+      std::cerr << "usage: " << argv[0] << " --cook <source> <out.ktx2> <bc1|bc3|bc7> [--srgb]\n";
+      return 1;
+   }
+
+   std::string format_name{argv[4]};
+   TextureBlockFormat format = TEXTURE_BLOCK_NONE;
+   if(format_name == "bc1") format = TEXTURE_BLOCK_BC1;
+   if(format_name == "bc3") format = TEXTURE_BLOCK_BC3;
+   if(format_name == "bc7") format = TEXTURE_BLOCK_BC7;
+   if(format == TEXTURE_BLOCK_NONE) {
+      std::cerr << "ERROR: unknown block format " << argv[4] << '\n';
+      return 1;
+   }
+   bool srgb = argc > 5 && std::string{argv[5]} == "--srgb";
+
+   ThreadPool pool;
+   thread_pool_init(&pool, 0);
+   CookStats stats;
+   bool cooked = cook_texture(&pool, argv[2], argv[3], format, srgb, &stats);
+   thread_pool_shutdown(&pool);
+
+   if(!cooked) {
+      std::cerr << "ERROR: failed to cook " << argv[2] << '\n';
+      return 1;
+   }
+   printf("cooked %s -> %s (%s%s): %lld texels in %.3f s, %.2f Mtexel/s, level 0 PSNR %.2f dB\n",
+	  argv[2], argv[3], argv[4], srgb ? " srgb" : "", stats.texels_encoded, stats.encode_seconds,
+	  stats.texels_encoded / stats.encode_seconds / 1e6, stats.psnr_level_0);
+   if(stats.psnr_level_0 < minimum_psnr(format)) {
+      std::cerr << "ERROR: " << argv[4] << " PSNR " << stats.psnr_level_0 << " dB is below the " << minimum_psnr(format)
+		<< " dB minimum\n";
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,56 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <string>
+
+#include "texture_cache.h"
+#include "thread_pool.h"
+
+
+// @@ 4x4 block codecs, pixels are always 16 RGBA texels in row order
+const int BC1_BLOCK_BYTES = 8;
+const int BC3_BLOCK_BYTES = 16;
+const int BC7_BLOCK_BYTES = 16;
+
+void encode_block_bc1(const unsigned char *rgba, unsigned char *block);
+void encode_block_bc3(const unsigned char *rgba, unsigned char *block);
+// mode 6 only, single subset RGBA with 4 bit indices
+void encode_block_bc7(const unsigned char *rgba, unsigned char *block);
+
+void decode_block_bc1(const unsigned char *block, unsigned char *rgba);
+void decode_block_bc3(const unsigned char *block, unsigned char *rgba);
+// returns false for modes other than 6, which the encoder never emits
+bool decode_block_bc7(const unsigned char *block, unsigned char *rgba);
+
+int block_format_bytes(TextureBlockFormat format);
+// @!
+
+
+struct CookStats {
+   double encode_seconds;
+   long long texels_encoded;
+   double psnr_level_0;
+};
+
+// source image -> full mip chain -> block compressed KTX2 at out_path, encoding runs on pool
+bool cook_texture(ThreadPool *pool, std::string source_path, std::string out_path,
+		  TextureBlockFormat format, bool srgb, CookStats *stats);
+
+// maps a KTX2 file written by cook_texture, levels point straight into the mapping
+bool ktx2_load(std::string path, TextureMipChain *chain);
+
+// headless entry point, main --cook <source> <out.ktx2> <bc1|bc3|bc7> [--srgb]
+// exits non-zero when level 0 PSNR is under the minimum for the format, so it can gate a build
+int cook_command(int argc, char **argv);
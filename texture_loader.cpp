@@ -0,0 +1,355 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "texture_loader.h"
+
+#include "gl_resources.h"
+#include "texture_cooker.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+
+// S3TC is still an extension so glad does not carry the enums
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+
+static GLenum compressed_format(const TextureMipChain &chain) {
+   switch(chain.block_format) {
+   case TEXTURE_BLOCK_BC1:
+      return chain.srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+   case TEXTURE_BLOCK_BC3:
+      return chain.srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+   default:
+      return chain.srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+   }
+}
+
+static bool is_ktx2_path(const std::string &path) {
+   return path.size() > 5 && path.compare(path.size() - 5, 5, ".ktx2") == 0;
+}
+
+
+GLenum texture_pixel_format(int channels) {
+   switch(channels) {
+   case 1: return GL_RED;
+   case 2: return GL_RG;
+   case 3: return GL_RGB;
+   default: return GL_RGBA;
+   }
+}
+
+// one and two channel layouts only ever come from linear data, the import keeps sRGB at three or more
+GLenum texture_internal_format(int channels, bool srgb) {
+   switch(channels) {
+   case 1: return GL_R8;
+   case 2: return GL_RG8;
+   case 3: return srgb ? GL_SRGB8 : GL_RGB8;
+   default: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+   }
+}
+
+
+void texture_loader_init(TextureLoader *loader, ThreadPool *pool, TextureBudget *budget,
+			 std::string cache_dir, int upload_slot_count, GLsizeiptr upload_bytes_per_frame) {
+   loader->pool = pool;
+   loader->budget = budget;
+   loader->cache_dir = cache_dir;
+   loader->upload_bytes_per_frame = upload_bytes_per_frame;
+
+   loader->upload_slots.resize(upload_slot_count);
+   // slots get their immutable storage on first use, sized for the image they carry
+   for(PixelUploadSlot &slot : loader->upload_slots) {
+      slot.pbo = 0;
+      slot.capacity = 0;
+      slot.fence = 0;
+   }
+
+   std::error_code error;
+   std::filesystem::create_directories(cache_dir, error);
+}
+
+
+static void submit_texture(TextureLoader *loader, LoaderTexture texture, TextureProducer produce) {
+   int texture_index = (int)loader->textures.size();
+   loader->textures.push_back(texture);
+
+   thread_pool_submit(loader->pool, [loader, texture_index, produce] {
+      DecodedImage image;
+      image.texture_index = texture_index;
+      image.loaded = produce(&image.chain);
+
+      std::lock_guard<std::mutex> lock{loader->decoded_mutex};
+      loader->decoded_images.push_back(image);
+   });
+}
+
+
+// 2D textures start as a white placeholder so they are complete and samplable before the real
+// pixels arrive
+static GLuint request_texture_2d(TextureLoader *loader, std::string debug_name, GLenum wrap_mode, bool srgb,
+				 bool packed, TextureProducer produce) {
+   LoaderTexture texture;
+   texture.path = debug_name;
+   texture.target = GL_TEXTURE_2D;
+   texture.layer = 0;
+   texture.wrap_mode = wrap_mode;
+   texture.srgb = srgb;
+   texture.packed = packed;
+   texture.first_level = 0;
+   texture.last_level = TEXTURE_MAX_MIP_LEVELS - 1;
+   texture.state = TEXTURE_STATE_DECODING;
+
+   // @@ placeholder
+   GLint previous_texture;
+   glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+
+   const unsigned char placeholder_texel[4] = {255, 255, 255, 255};
+   glCreateTextures(GL_TEXTURE_2D, 1, &texture.id);
+   gl_texture_sampling(texture.id, wrap_mode, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+   glBindTexture(GL_TEXTURE_2D, texture.id);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder_texel);
+
+   glBindTexture(GL_TEXTURE_2D, previous_texture);
+   // @!
+
+   submit_texture(loader, texture, produce);
+   return texture.id;
+}
+
+
+GLuint texture_loader_request(TextureLoader *loader, std::string path, GLenum wrap_mode, bool srgb) {
+   std::string cache_dir = loader->cache_dir;
+   return request_texture_2d(loader, path, wrap_mode, srgb, false, [path, cache_dir, srgb](TextureMipChain *chain) {
+      if(is_ktx2_path(path)) {
+	 return ktx2_load(path, chain);
+      }
+      return texture_cache_load(cache_dir, path, srgb, chain);
+   });
+}
+
+
+GLuint texture_loader_request_packed(TextureLoader *loader, std::vector<std::string> channel_paths,
+				     GLenum wrap_mode) {
+   std::string debug_name = "packed";
+   for(const std::string &path : channel_paths) {
+      debug_name += " " + (path.empty() ? std::string{"-"} : path);
+   }
+
+   std::string cache_dir = loader->cache_dir;
+   return request_texture_2d(loader, debug_name, wrap_mode, false, true,
+			     [channel_paths, cache_dir](TextureMipChain *chain) {
+				return texture_cache_load_packed(cache_dir, channel_paths, chain);
+			     });
+}
+
+
+void texture_loader_request_layer(TextureLoader *loader, GLuint array_id, int layer,
+				  std::string debug_name, TextureProducer produce) {
+   texture_loader_request_levels(loader, array_id, layer, -1, TEXTURE_MAX_MIP_LEVELS - 1, debug_name, produce,
+				 NULL);
+}
+
+
+void texture_loader_request_levels(TextureLoader *loader, GLuint array_id, int layer, int first_level,
+				   int last_level, std::string debug_name, TextureProducer produce,
+				   TextureUploaded on_uploaded) {
+   LoaderTexture texture;
+   texture.path = debug_name;
+   texture.id = array_id;
+   texture.target = GL_TEXTURE_2D_ARRAY;
+   texture.layer = layer;
+   texture.wrap_mode = GL_REPEAT;
+   texture.srgb = false;
+   texture.packed = false;
+   texture.first_level = first_level;
+   texture.last_level = last_level;
+   texture.on_uploaded = on_uploaded;
+   texture.state = TEXTURE_STATE_DECODING;
+   submit_texture(loader, texture, produce);
+}
+
+
+void texture_loader_update(TextureLoader *loader) {
+   // @@ retire slots the GPU has finished reading from
+   for(PixelUploadSlot &slot : loader->upload_slots) {
+      if(!slot.fence) {
+	 continue;
+      }
+
+      GLenum wait_result = glClientWaitSync(slot.fence, 0, 0);
+      if(wait_result == GL_ALREADY_SIGNALED || wait_result == GL_CONDITION_SATISFIED) {
+	 glDeleteSync(slot.fence);
+	 slot.fence = 0;
+      }
+   }
+   // @!
+
+
+   GLint previous_texture;
+   glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+   GLsizeiptr bytes_uploaded = 0;
+   for(PixelUploadSlot &slot : loader->upload_slots) {
+      if(slot.fence) {
+	 continue;
+      }
+      if(bytes_uploaded >= loader->upload_bytes_per_frame) {
+	 break;
+      }
+
+      DecodedImage image;
+      {
+	 std::lock_guard<std::mutex> lock{loader->decoded_mutex};
+	 if(loader->decoded_images.empty()) {
+	    break;
+	 }
+	 image = loader->decoded_images.front();
+	 loader->decoded_images.pop_front();
+      }
+
+      LoaderTexture &texture = loader->textures[image.texture_index];
+
+      if(!image.loaded) {
+	 std::cerr << "ERROR: texture failed to load: " << texture.path << '\n';
+	 texture.state = TEXTURE_STATE_FAILED;
+	 TextureUploaded on_uploaded = texture.on_uploaded;
+	 if(on_uploaded) {
+	    on_uploaded(false);
+	 }
+	 continue;
+      }
+      texture.state = TEXTURE_STATE_DECODED;
+
+      // @@ pick the levels to send, arrays only take the levels they have storage for
+      // by default that is the base level down, finer ones were dropped or are not streamed in yet
+      const TextureMipChain &chain = image.chain;
+      int first_level = 0;
+      int last_level = chain.level_count - 1;
+      if(texture.target == GL_TEXTURE_2D_ARRAY) {
+	 GLint array_base_level;
+	 GLint array_max_level;
+	 glGetTextureParameteriv(texture.id, GL_TEXTURE_BASE_LEVEL, &array_base_level);
+	 glGetTextureParameteriv(texture.id, GL_TEXTURE_MAX_LEVEL, &array_max_level);
+	 first_level = texture.first_level < 0 ? array_base_level : texture.first_level;
+	 last_level = std::min(std::min(texture.last_level, (int)array_max_level), last_level);
+      }
+      // @!
+
+      // @@ copy those levels into the PBO, the fence on this slot guarantees the GPU is done with it
+      // this memcpy is what pages the mapped cache file in
+      // 2D uploads take the whole chain, cooked KTX2 chains store their levels smallest first
+      size_t copy_begin = 0;
+      size_t copy_end = chain.data_size;
+      if(texture.target == GL_TEXTURE_2D_ARRAY) {
+	 copy_begin = first_level <= last_level ? chain.levels[first_level].offset : 0;
+	 copy_end = first_level <= last_level ? chain.levels[last_level].offset + chain.levels[last_level].size : 0;
+      }
+      GLsizeiptr image_size = (GLsizeiptr)(copy_end - copy_begin);
+      // immutable storage cannot grow, a bigger image replaces the slot's buffer. the old one is idle,
+      // its fence has passed
+      if(image_size > slot.capacity) {
+	 glDeleteBuffers(1, &slot.pbo);
+	 slot.pbo = gl_create_buffer(image_size, NULL, GL_MAP_WRITE_BIT);
+	 slot.capacity = image_size;
+      }
+
+      if(image_size > 0) {
+	 void *mapped = glMapNamedBufferRange(slot.pbo, 0, image_size,
+					      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+					      GL_MAP_UNSYNCHRONIZED_BIT);
+	 memcpy(mapped, chain.data + copy_begin, image_size);
+	 glUnmapNamedBuffer(slot.pbo);
+      }
+      // the uploads below still source from whatever sits on the unpack target
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+      // @!
+
+      if(texture.target == GL_TEXTURE_2D_ARRAY) {
+	 for(int level = first_level; level <= last_level; ++level) {
+	    const TextureMipLevel &mip = chain.levels[level];
+	    glTextureSubImage3D(texture.id, level, 0, 0, texture.layer, mip.width, mip.height, 1,
+				texture_pixel_format(chain.channels), GL_UNSIGNED_BYTE,
+				(void *)(mip.offset - copy_begin));
+	 }
+      } else {
+	 glTextureParameteri(texture.id, GL_TEXTURE_BASE_LEVEL, 0);
+	 glTextureParameteri(texture.id, GL_TEXTURE_MAX_LEVEL, chain.level_count - 1);
+	 glBindTexture(GL_TEXTURE_2D, texture.id);
+	 for(int level = 0; level < chain.level_count; ++level) {
+	    const TextureMipLevel &mip = chain.levels[level];
+	    if(chain.block_format != TEXTURE_BLOCK_NONE) {
+	       glCompressedTexImage2D(GL_TEXTURE_2D, level, compressed_format(chain), mip.width, mip.height,
+				      0, (GLsizei)mip.size, (void *)mip.offset);
+	    } else {
+	       glTexImage2D(GL_TEXTURE_2D, level, texture_internal_format(chain.channels, chain.srgb),
+			    mip.width, mip.height, 0, texture_pixel_format(chain.channels),
+			    GL_UNSIGNED_BYTE, (void *)mip.offset);
+	    }
+	 }
+	 // grey imports still read back as grey (+ alpha) in every shader, packed maps stay per channel
+	 if(!texture.packed && chain.block_format == TEXTURE_BLOCK_NONE && chain.channels <= 2) {
+	    GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, chain.channels == 2 ? GL_GREEN : GL_ONE};
+	    glTextureParameteriv(texture.id, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	 }
+	 if(loader->budget) {
+	    texture_budget_track(loader->budget, texture.id, GL_TEXTURE_2D, texture.path, true);
+	 }
+      }
+      texture_mip_chain_free(&image.chain);
+
+      slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      texture.state = TEXTURE_STATE_READY;
+      bytes_uploaded += image_size;
+      // copied out first, the callback is free to queue more requests
+      TextureUploaded on_uploaded = texture.on_uploaded;
+      if(on_uploaded) {
+	 on_uploaded(true);
+      }
+   }
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   glBindTexture(GL_TEXTURE_2D, previous_texture);
+}
+
+
+void texture_loader_shutdown(TextureLoader *loader) {
+   // the pool has to be drained first, otherwise a worker could still push a decoded image
+   for(DecodedImage &image : loader->decoded_images) {
+      if(image.loaded) {
+	 texture_mip_chain_free(&image.chain);
+      }
+   }
+   loader->decoded_images.clear();
+
+   for(PixelUploadSlot &slot : loader->upload_slots) {
+      if(slot.fence) {
+	 glDeleteSync(slot.fence);
+      }
+      glDeleteBuffers(1, &slot.pbo);
+   }
+   loader->upload_slots.clear();
+}
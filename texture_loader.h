@@ -0,0 +1,119 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "texture_budget.h"
+#include "texture_cache.h"
+#include "thread_pool.h"
+
+
+enum TextureLoadState {
+   TEXTURE_STATE_DECODING,
+   TEXTURE_STATE_DECODED,
+   TEXTURE_STATE_READY,
+   TEXTURE_STATE_FAILED
+};
+
+// runs on the GL thread right after the upload was issued, or with false if the load failed
+typedef std::function<void(bool uploaded)> TextureUploaded;
+
+// target is GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY, for arrays layer is the slice being filled and only
+// levels first_level..last_level of the chain are uploaded
+struct LoaderTexture {
+   std::string path;
+   GLuint id;
+   GLenum target;
+   int layer;
+   GLenum wrap_mode;
+   bool srgb;
+   bool packed;
+   int first_level;
+   int last_level;
+   TextureUploaded on_uploaded;
+   TextureLoadState state;
+};
+
+// runs on a worker and fills in the chain to upload
+typedef std::function<bool(TextureMipChain *chain)> TextureProducer;
+
+// mip chain handed from a worker back to the GL thread, usually still a mapping of the cache file
+struct DecodedImage {
+   int texture_index;
+   bool loaded;
+   TextureMipChain chain;
+};
+
+// one pixel buffer object, busy until the GPU has finished pulling from it
+struct PixelUploadSlot {
+   GLuint pbo;
+   GLsizeiptr capacity;
+   GLsync fence;
+};
+
+struct TextureLoader {
+   ThreadPool *pool;
+   TextureBudget *budget;
+   std::string cache_dir;
+   std::vector<LoaderTexture> textures;
+   std::vector<PixelUploadSlot> upload_slots;
+
+   std::mutex decoded_mutex;
+   std::deque<DecodedImage> decoded_images;
+
+   GLsizeiptr upload_bytes_per_frame;
+};
+
+
+// decode happens on pool, everything else must be called from the thread owning the GL context
+// budget may be NULL, otherwise every finished upload is (re)accounted in it
+void texture_loader_init(TextureLoader *loader, ThreadPool *pool, TextureBudget *budget,
+			 std::string cache_dir, int upload_slot_count, GLsizeiptr upload_bytes_per_frame);
+
+// returns a usable texture name straight away, it holds a 1x1 placeholder until the upload lands
+// srgb is for colour maps, it only affects how the cached mip chain is filtered
+// .ktx2 paths are expected to come out of the cooker and are uploaded block compressed as is
+GLuint texture_loader_request(TextureLoader *loader, std::string path, GLenum wrap_mode, bool srgb);
+
+// channel_paths go into r, g, b, a in order, see texture_cache_load_packed. always linear and never
+// swizzled, so sample .r/.g/.b for the individual maps
+GLuint texture_loader_request_packed(TextureLoader *loader, std::vector<std::string> channel_paths,
+				     GLenum wrap_mode);
+
+// fills one layer of an array texture that already has storage for every level, the chain the
+// producer returns must match the array size
+void texture_loader_request_layer(TextureLoader *loader, GLuint array_id, int layer,
+				  std::string debug_name, TextureProducer produce);
+
+// same, restricted to a level range that already has storage, used to stream finer levels in later
+// a first_level of -1 starts at the array's current GL_TEXTURE_BASE_LEVEL
+void texture_loader_request_levels(TextureLoader *loader, GLuint array_id, int layer, int first_level,
+				   int last_level, std::string debug_name, TextureProducer produce,
+				   TextureUploaded on_uploaded);
+
+// smallest internal format for a channel layout from texture_minimal_channels
+GLenum texture_internal_format(int channels, bool srgb);
+GLenum texture_pixel_format(int channels);
+
+// call once per frame, retires finished uploads and starts new ones within the byte budget
+void texture_loader_update(TextureLoader *loader);
+
+void texture_loader_shutdown(TextureLoader *loader);
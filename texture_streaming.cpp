@@ -0,0 +1,217 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "texture_streaming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+void texture_streamer_init(TextureStreamer *streamer, TextureLoader *loader, TextureBudget *budget,
+			   int start_size, int drop_delay_frames) {
+   streamer->loader = loader;
+   streamer->budget = budget;
+   streamer->start_size = start_size;
+   streamer->drop_delay_frames = drop_delay_frames;
+   streamer->lod_fade_per_frame = 1.0f / 16.0f;
+   streamer->textures.clear();
+   streamer->texture_index.clear();
+   streamer->levels_streamed_in = 0;
+   streamer->levels_dropped = 0;
+}
+
+
+int texture_streamer_start_level(TextureStreamer *streamer, int width, int height) {
+   int level = 0;
+   while(std::max(width >> level, height >> level) > streamer->start_size && level < TEXTURE_MAX_MIP_LEVELS - 1) {
+      level += 1;
+   }
+   return level;
+}
+
+
+void texture_streamer_register_array(TextureStreamer *streamer, GLuint array_id, int width, int height,
+				     int level_count, int channels, bool srgb,
+				     std::vector<TextureProducer> layer_producers) {
+   StreamedTexture texture;
+   texture.id = array_id;
+   texture.width = width;
+   texture.height = height;
+   texture.layer_count = (int)layer_producers.size();
+   texture.level_count = level_count;
+   texture.floor_level = std::min(texture_streamer_start_level(streamer, width, height), level_count - 1);
+   texture.internal_format = texture_internal_format(channels, srgb);
+   texture.pixel_format = texture_pixel_format(channels);
+   texture.layer_producers = layer_producers;
+   texture.loading_level = -1;
+   texture.layers_pending = 0;
+   texture.failed = false;
+   texture.wanted_level = level_count;
+   texture.frames_unwanted = 0;
+   texture.lod_fade = 0.0f;
+
+   streamer->texture_index[array_id] = (int)streamer->textures.size();
+   streamer->textures.push_back(texture);
+}
+
+
+float texture_streamer_estimate_lod(const glm::mat4 &projection, const glm::mat4 &view, const glm::mat4 &model,
+				    float object_radius, float uv_world_size, int texture_size, int viewport_height) {
+   float scale = std::max(std::max(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))),
+			  glm::length(glm::vec3(model[2])));
+   glm::vec4 view_center = view * model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+   // nearest point of the bounding sphere, objects entirely behind the camera need no detail
+   float depth = -view_center.z - object_radius * scale;
+   if(-view_center.z + object_radius * scale <= 0.0f) {
+      return (float)TEXTURE_MAX_MIP_LEVELS;
+   }
+   depth = std::max(depth, 0.05f);
+
+   float pixels_per_unit = 0.5f * viewport_height * projection[1][1] / depth;
+   float texels_per_unit = texture_size / (uv_world_size * scale);
+   return log2f(std::max(texels_per_unit / pixels_per_unit, 1e-6f));
+}
+
+
+void texture_streamer_want(TextureStreamer *streamer, GLuint id, float lod) {
+   auto found = streamer->texture_index.find(id);
+   if(found == streamer->texture_index.end()) {
+      return;
+   }
+   StreamedTexture &texture = streamer->textures[found->second];
+   int level = (int)std::floor(std::max(lod, 0.0f));
+   texture.wanted_level = std::min(texture.wanted_level, level);
+}
+
+
+// @@ level storage, only the level itself is touched so the rest of the chain stays sampled meanwhile
+// binds the array, the caller restores the previous binding
+static void allocate_level(StreamedTexture *texture, int level, bool empty) {
+   int width = empty ? 0 : std::max(1, texture->width >> level);
+   int height = empty ? 0 : std::max(1, texture->height >> level);
+   int layers = empty ? 0 : texture->layer_count;
+   glBindTexture(GL_TEXTURE_2D_ARRAY, texture->id);
+   glTexImage3D(GL_TEXTURE_2D_ARRAY, level, texture->internal_format, width, height, layers, 0,
+		texture->pixel_format, GL_UNSIGNED_BYTE, NULL);
+}
+
+
+static void level_uploaded(TextureStreamer *streamer, int texture_index, int level, bool uploaded) {
+   StreamedTexture &texture = streamer->textures[texture_index];
+   texture.failed = texture.failed || !uploaded;
+   texture.layers_pending -= 1;
+   if(texture.layers_pending > 0) {
+      return;
+   }
+   texture.loading_level = -1;
+
+   GLint previous_array;
+   glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previous_array);
+
+   // the budget may have dropped the level above while this one was in flight, making it unusable
+   const BudgetedTexture &record = streamer->budget->textures[streamer->budget->texture_index[texture.id]];
+   if(texture.failed || record.base_level != level + 1) {
+      allocate_level(&texture, level, true);
+   } else {
+      glTextureParameteri(texture.id, GL_TEXTURE_BASE_LEVEL, level);
+      // min lod is relative to the base level, starting one level up keeps the old look for a frame
+      texture.lod_fade += 1.0f;
+      glTextureParameterf(texture.id, GL_TEXTURE_MIN_LOD, texture.lod_fade);
+      texture_budget_track(streamer->budget, texture.id, GL_TEXTURE_2D_ARRAY, record.name, true);
+      streamer->levels_streamed_in += 1;
+   }
+
+   glBindTexture(GL_TEXTURE_2D_ARRAY, previous_array);
+}
+
+static void start_level(TextureStreamer *streamer, int texture_index, int level) {
+   StreamedTexture &texture = streamer->textures[texture_index];
+   allocate_level(&texture, level, false);
+
+   texture.loading_level = level;
+   texture.layers_pending = texture.layer_count;
+   for(int layer = 0; layer < texture.layer_count; ++layer) {
+      texture_loader_request_levels(streamer->loader, texture.id, layer, level, level, "streamed level",
+				    texture.layer_producers[layer],
+				    [streamer, texture_index, level](bool uploaded) {
+				       level_uploaded(streamer, texture_index, level, uploaded);
+				    });
+   }
+}
+// @!
+
+
+void texture_streamer_update(TextureStreamer *streamer) {
+   GLint previous_array;
+   glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previous_array);
+
+   for(int i = 0; i < (int)streamer->textures.size(); ++i) {
+      StreamedTexture &texture = streamer->textures[i];
+      auto found = streamer->budget->texture_index.find(texture.id);
+      if(found == streamer->budget->texture_index.end()) {
+	 continue;
+      }
+      const BudgetedTexture &record = streamer->budget->textures[found->second];
+      int resident_level = record.base_level;
+      int wanted_level = std::min(texture.wanted_level, texture.level_count - 1);
+      texture.wanted_level = texture.level_count;
+
+      if(texture.lod_fade > 0.0f) {
+	 texture.lod_fade = std::max(texture.lod_fade - streamer->lod_fade_per_frame, 0.0f);
+	 glTextureParameterf(texture.id, GL_TEXTURE_MIN_LOD, texture.lod_fade);
+      }
+
+      if(wanted_level < resident_level) {
+	 // @@ one finer level at a time, and only if it fits the budget without evicting anything
+	 texture.frames_unwanted = 0;
+	 size_t next_level_bytes = record.level_bytes[resident_level] * 4;
+	 if(texture.loading_level < 0 && !texture.failed &&
+	    streamer->budget->resident_bytes + next_level_bytes <= streamer->budget->budget_bytes) {
+	    start_level(streamer, i, resident_level - 1);
+	 }
+	 // @!
+      } else if(wanted_level > resident_level && resident_level < texture.floor_level && texture.loading_level < 0) {
+	 // @@ nothing needs the top level any more, give it back once it has been unused for a while
+	 texture.frames_unwanted += 1;
+	 if(texture.frames_unwanted >= streamer->drop_delay_frames) {
+	    texture.frames_unwanted = 0;
+	    texture.lod_fade = 0.0f;
+	    glTextureParameterf(texture.id, GL_TEXTURE_MIN_LOD, 0.0f);
+	    if(texture_budget_drop_top_level(streamer->budget, texture.id)) {
+	       streamer->levels_dropped += 1;
+	    }
+	 }
+	 // @!
+      } else {
+	 texture.frames_unwanted = 0;
+      }
+   }
+
+   glBindTexture(GL_TEXTURE_2D_ARRAY, previous_array);
+}
+
+
+void texture_streamer_print(TextureStreamer *streamer) {
+   printf("texture streaming: %d levels streamed in, %d dropped\n", streamer->levels_streamed_in,
+	  streamer->levels_dropped);
+   for(const StreamedTexture &texture : streamer->textures) {
+      auto found = streamer->budget->texture_index.find(texture.id);
+      int resident_level = found != streamer->budget->texture_index.end() ?
+	 streamer->budget->textures[found->second].base_level : -1;
+      printf("   array %u  %dx%d x%d  resident from level %d of %d%s\n", texture.id, texture.width,
+	     texture.height, texture.layer_count, resident_level, texture.level_count,
+	     texture.failed ? "  (failed)" : "");
+   }
+}
@@ -0,0 +1,96 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "texture_budget.h"
+#include "texture_loader.h"
+
+
+// a texture array whose finer levels come and go with what is on screen
+// GL_TEXTURE_BASE_LEVEL is the finest resident level, the budget record holds the live value
+struct StreamedTexture {
+   GLuint id;
+   int width;
+   int height;
+   int layer_count;
+   int level_count;
+   GLenum internal_format;
+   GLenum pixel_format;
+   std::vector<TextureProducer> layer_producers;
+   // coarsest level kept no matter what, the level the texture started from
+   int floor_level;
+
+   // level being streamed in, -1 when idle
+   int loading_level;
+   int layers_pending;
+   bool failed;
+
+   // finest level any object asked for this frame, level_count when nobody asked
+   int wanted_level;
+   int frames_unwanted;
+   // GL_TEXTURE_MIN_LOD, eases a new finer base level in instead of popping
+   float lod_fade;
+};
+
+struct TextureStreamer {
+   TextureLoader *loader;
+   TextureBudget *budget;
+   // textures start with the levels no larger than this resident
+   int start_size;
+   // frames a level has to go unused before it is dropped again
+   int drop_delay_frames;
+   float lod_fade_per_frame;
+
+   std::vector<StreamedTexture> textures;
+   std::unordered_map<GLuint, int> texture_index;
+
+   int levels_streamed_in;
+   int levels_dropped;
+};
+
+
+void texture_streamer_init(TextureStreamer *streamer, TextureLoader *loader, TextureBudget *budget,
+			   int start_size, int drop_delay_frames);
+
+// first level a new texture of this size should start from
+int texture_streamer_start_level(TextureStreamer *streamer, int width, int height);
+
+// array_id must already have storage for start_level and coarser, with GL_TEXTURE_BASE_LEVEL on
+// start_level, and be tracked by the budget. layer_producers rebuild the full chain of each layer
+void texture_streamer_register_array(TextureStreamer *streamer, GLuint array_id, int width, int height,
+				     int level_count, int channels, bool srgb,
+				     std::vector<TextureProducer> layer_producers);
+
+// mip level an object needs, from how many texels of a texture_size texture land on one pixel of a
+// viewport_height tall screen. object_radius bounds the object and uv_world_size is how many world
+// units one repeat of the texture covers, both in model space
+float texture_streamer_estimate_lod(const glm::mat4 &projection, const glm::mat4 &view, const glm::mat4 &model,
+				    float object_radius, float uv_world_size, int texture_size, int viewport_height);
+
+// call for every object drawn with the texture this frame
+void texture_streamer_want(TextureStreamer *streamer, GLuint id, float lod);
+
+// once per frame after texture_loader_update, starts at most one level per texture and drops
+// levels that have not been wanted for drop_delay_frames
+void texture_streamer_update(TextureStreamer *streamer);
+
+void texture_streamer_print(TextureStreamer *streamer);
@@ -0,0 +1,93 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "thread_pool.h"
+
+
+static void worker_main(ThreadPool *pool) {
+   while(true) {
+      std::function<void()> job;
+      {
+	 std::unique_lock<std::mutex> lock{pool->mutex};
+	 pool->job_available.wait(lock, [pool] { return pool->shutting_down || !pool->jobs.empty(); });
+	 if(pool->jobs.empty()) {
+	    return;
+	 }
+	 job = std::move(pool->jobs.front());
+	 pool->jobs.pop_front();
+      }
+
+      job();
+   }
+}
+
+
+void thread_pool_init(ThreadPool *pool, unsigned int thread_count) {
+   if(thread_count == 0) {
+      unsigned int hardware_threads = std::thread::hardware_concurrency();
+      thread_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+   }
+
+   pool->shutting_down = false;
+   for(unsigned int i = 0; i < thread_count; ++i) {
+      pool->workers.emplace_back(worker_main, pool);
+   }
+}
+
+
+void thread_pool_submit(ThreadPool *pool, std::function<void()> job) {
+   {
+      std::lock_guard<std::mutex> lock{pool->mutex};
+      pool->jobs.push_back(std::move(job));
+   }
+   pool->job_available.notify_one();
+}
+
+
+void thread_pool_parallel_for(ThreadPool *pool, int count, int chunk_size,
+			      std::function<void(int begin, int end)> body) {
+   std::mutex done_mutex;
+   std::condition_variable done_condition;
+   int chunks_left = (count + chunk_size - 1) / chunk_size;
+
+   for(int begin = 0; begin < count; begin += chunk_size) {
+      int end = begin + chunk_size < count ? begin + chunk_size : count;
+      thread_pool_submit(pool, [&, begin, end] {
+	 body(begin, end);
+
+	 std::lock_guard<std::mutex> lock{done_mutex};
+	 chunks_left -= 1;
+	 if(chunks_left == 0) {
+	    done_condition.notify_all();
+	 }
+      });
+   }
+
+   std::unique_lock<std::mutex> lock{done_mutex};
+   done_condition.wait(lock, [&] { return chunks_left == 0; });
+}
+
+
+// @@ drains the queue before joining, so every submitted job still runs
+void thread_pool_shutdown(ThreadPool *pool) {
+   {
+      std::lock_guard<std::mutex> lock{pool->mutex};
+      pool->shutting_down = true;
+   }
+   pool->job_available.notify_all();
+
+   for(std::thread &worker : pool->workers) {
+      worker.join();
+   }
+   pool->workers.clear();
+}
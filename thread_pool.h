@@ -0,0 +1,42 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// fixed set of worker threads pulling jobs off a single queue, no GL calls allowed in jobs
+struct ThreadPool {
+   std::vector<std::thread> workers;
+   std::deque<std::function<void()>> jobs;
+   std::mutex mutex;
+   std::condition_variable job_available;
+   bool shutting_down;
+};
+
+
+// thread_count of 0 means one worker per hardware thread, minus the main thread
+void thread_pool_init(ThreadPool *pool, unsigned int thread_count);
+void thread_pool_submit(ThreadPool *pool, std::function<void()> job);
+
+// splits [0, count) into chunks of chunk_size run across the pool, returns when all are done
+// only waits on its own chunks so it is fine to call while unrelated jobs are queued
+void thread_pool_parallel_for(ThreadPool *pool, int count, int chunk_size,
+			      std::function<void(int begin, int end)> body);
+void thread_pool_shutdown(ThreadPool *pool);
@@ -0,0 +1,137 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "vertex_layout.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+// @@ quantization
+VertexQuantization vertex_quantization_from_mesh(const Mesh *mesh) {
+   glm::vec3 low(0.0f);
+   glm::vec3 high(0.0f);
+   size_t vertex_count = mesh->vertices.size() / mesh->vertex_floats;
+   for(size_t i = 0; i < vertex_count; ++i) {
+      const float *position = &mesh->vertices[i * mesh->vertex_floats];
+      glm::vec3 p(position[0], position[1], position[2]);
+      low = i == 0 ? p : glm::min(low, p);
+      high = i == 0 ? p : glm::max(high, p);
+   }
+   // a flat axis still needs a non zero extent to divide by
+   return VertexQuantization{(low + high) * 0.5f, glm::max((high - low) * 0.5f, glm::vec3(1e-6f))};
+}
+
+
+glm::mat4 vertex_dequantize_matrix(const VertexQuantization &quantization) {
+   return glm::scale(glm::translate(glm::mat4(1.0f), quantization.position_center), quantization.position_extent);
+}
+
+
+// round to nearest even, overflow goes to infinity and NaN stays NaN
+uint16_t float_to_half(float value) {
+   uint32_t bits;
+   memcpy(&bits, &value, sizeof(bits));
+   uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+   uint32_t magnitude = bits & 0x7fffffff;
+
+   if(magnitude >= 0x7f800000) {
+      return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+   }
+   if(magnitude >= 0x477ff000) {
+      return sign | 0x7c00;
+   }
+   if(magnitude < 0x38800000) {
+      // half subnormals are multiples of 2^-24, the scale is exact and rint rounds to even.
+      // 1024 comes out as the smallest normal, which is the right encoding too
+      float subnormal;
+      memcpy(&subnormal, &magnitude, sizeof(subnormal));
+      return sign | (uint16_t)rintf(subnormal * 16777216.0f);
+   }
+   uint32_t rounded = magnitude + 0xfff + ((magnitude >> 13) & 1);
+   return sign | (uint16_t)((rounded - 0x38000000) >> 13);
+}
+
+
+int16_t float_to_snorm16(float value) {
+   return (int16_t)lrintf(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+}
+
+
+static uint32_t float_to_snorm10(float value) {
+   return (uint32_t)lrintf(std::min(std::max(value, -1.0f), 1.0f) * 511.0f) & 0x3ff;
+}
+// @!
+
+
+// @@ encodings
+void VertexFloat3::encode(const float *source, const VertexQuantization &, Stored *out) {
+   memcpy(out->value, source, sizeof(out->value));
+}
+
+
+void VertexFloat4::encode(const float *source, const VertexQuantization &, Stored *out) {
+   memcpy(out->value, source, sizeof(out->value));
+}
+
+
+void VertexFloat2::encode(const float *source, const VertexQuantization &, Stored *out) {
+   memcpy(out->value, source, sizeof(out->value));
+}
+
+
+void VertexPositionSnorm16::encode(const float *source, const VertexQuantization &quantization, Stored *out) {
+   for(int axis = 0; axis < 3; ++axis) {
+      float relative = (source[axis] - quantization.position_center[axis]) / quantization.position_extent[axis];
+      out->value[axis] = float_to_snorm16(relative);
+   }
+   out->value[3] = 0;
+}
+
+
+void VertexNormal1010102::encode(const float *source, const VertexQuantization &, Stored *out) {
+   out->value = float_to_snorm10(source[0]) | float_to_snorm10(source[1]) << 10 | float_to_snorm10(source[2]) << 20;
+}
+
+
+void VertexNormalOctahedral::encode(const float *source, const VertexQuantization &, Stored *out) {
+   float sum = fabsf(source[0]) + fabsf(source[1]) + fabsf(source[2]);
+   float x = sum > 0.0f ? source[0] / sum : 0.0f;
+   float y = sum > 0.0f ? source[1] / sum : 0.0f;
+   if(source[2] < 0.0f) {
+      // the lower half folds out over the corners of the square
+      float folded_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+      float folded_y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+      x = folded_x;
+      y = folded_y;
+   }
+   out->value[0] = float_to_snorm16(x);
+   out->value[1] = float_to_snorm16(y);
+}
+
+
+void VertexSnorm16x4::encode(const float *source, const VertexQuantization &, Stored *out) {
+   for(int i = 0; i < 4; ++i) {
+      out->value[i] = float_to_snorm16(source[i]);
+   }
+}
+
+
+void VertexHalf2::encode(const float *source, const VertexQuantization &, Stored *out) {
+   out->value[0] = float_to_half(source[0]);
+   out->value[1] = float_to_half(source[1]);
+}
+// @!
@@ -0,0 +1,254 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "gl_resources.h"
+#include "mesh.h"
+
+
+// @@ quantization, positions are stored relative to the mesh bounds
+// the shader sees positions in [-1, 1], fold vertex_dequantize_matrix into the model matrix to get
+// them back. it may scale unevenly, so it must never reach the normals
+struct VertexQuantization {
+   glm::vec3 position_center;
+   glm::vec3 position_extent;
+};
+
+VertexQuantization vertex_quantization_from_mesh(const Mesh *mesh);
+glm::mat4 vertex_dequantize_matrix(const VertexQuantization &quantization);
+
+uint16_t float_to_half(float value);
+int16_t float_to_snorm16(float value);
+// @!
+
+
+// @@ encodings, each one is a packed storage type plus how GL reads it back
+// every storage is a multiple of four bytes so a vertex never needs padding between attributes
+// source_floats is how many floats of the mesh vertex the encoding consumes
+struct VertexFloat3 {
+   struct Stored {
+      float value[3];
+   };
+   static constexpr int source_floats = 3;
+   static constexpr GLint components = 3;
+   static constexpr GLenum type = GL_FLOAT;
+   static constexpr GLboolean normalized = GL_FALSE;
+   static void encode(const float *source, const VertexQuantization &, Stored *out);
+};
+
+struct VertexFloat4 {
+   struct Stored {
+      float value[4];
+   };
+   static constexpr int source_floats = 4;
+   static constexpr GLint components = 4;
+   static constexpr GLenum type = GL_FLOAT;
+   static constexpr GLboolean normalized = GL_FALSE;
+   static void encode(const float *source, const VertexQuantization &, Stored *out);
+};
+
+struct VertexFloat2 {
+   struct Stored {
+      float value[2];
+   };
+   static constexpr int source_floats = 2;
+   static constexpr GLint components = 2;
+   static constexpr GLenum type = GL_FLOAT;
+   static constexpr GLboolean normalized = GL_FALSE;
+   static void encode(const float *source, const VertexQuantization &, Stored *out);
+};
+
+// 16 bit normalized within the mesh bounds, the fourth short only pads the vertex to 8 bytes
+struct VertexPositionSnorm16 {
+   struct Stored {
+      int16_t value[4];
+   };
+   static constexpr int source_floats = 3;
+   static constexpr GLint components = 3;
+   static constexpr GLenum type = GL_SHORT;
+   static constexpr GLboolean normalized = GL_TRUE;
+   static void encode(const float *source, const VertexQuantization &quantization, Stored *out);
+};
+
+// 10 bits per axis, reads straight back as a vec3 in the shader
+struct VertexNormal1010102 {
+   struct Stored {
+      uint32_t value;
+   };
+   static constexpr int source_floats = 3;
+   static constexpr GLint components = 4;
+   static constexpr GLenum type = GL_INT_2_10_10_10_REV;
+   static constexpr GLboolean normalized = GL_TRUE;
+   static void encode(const float *source, const VertexQuantization &, Stored *out);
+};
+
+// unit vector folded onto an octahedron, two 16 bit components. more precise than 10:10:10:2 at the
+// same size, but the shader has to unfold it with oct_decode from shaders/include/octahedral.glsl
+struct VertexNormalOctahedral {
+   struct Stored {
+      int16_t value[2];
+   };
+   static constexpr int source_floats = 3;
+   static constexpr GLint components = 2;
+   static constexpr GLenum type = GL_SHORT;
+   static constexpr GLboolean normalized = GL_TRUE;
+   static void encode(const float *source, const VertexQuantization &, Stored *out);
+};
+
+// anything already in [-1, 1], unit quaternions for one
+struct VertexSnorm16x4 {
+   struct Stored {
+      int16_t value[4];
+   };
+   static constexpr int source_floats = 4;
+   static constexpr GLint components = 4;
+   static constexpr GLenum type = GL_SHORT;
+   static constexpr GLboolean normalized = GL_TRUE;
+   static void encode(const float *source, const VertexQuantization &, Stored *out);
+};
+
+// exact for texel positions of textures up to 2048 wide, and tiling up to a few repeats
+struct VertexHalf2 {
+   struct Stored {
+      uint16_t value[2];
+   };
+   static constexpr int source_floats = 2;
+   static constexpr GLint components = 2;
+   static constexpr GLenum type = GL_HALF_FLOAT;
+   static constexpr GLboolean normalized = GL_FALSE;
+   static void encode(const float *source, const VertexQuantization &, Stored *out);
+};
+// @!
+
+
+// @@ layouts, VertexLayout<VertexAttribute<0, VertexPositionSnorm16>, VertexAttribute<1, ...>, ...>
+// attributes are packed in the order given and consume the mesh vertex floats in that same order.
+// the packed struct, stride, offsets and GL attribute formats all come from the one list
+template<GLuint Location, typename EncodingType>
+struct VertexAttribute {
+   static constexpr GLuint location = Location;
+   typedef EncodingType Encoding;
+};
+
+template<typename... Attributes>
+struct PackedVertex;
+
+template<typename Last>
+struct PackedVertex<Last> {
+   typename Last::Encoding::Stored value;
+};
+
+template<typename First, typename Second, typename... Rest>
+struct PackedVertex<First, Second, Rest...> {
+   typename First::Encoding::Stored value;
+   PackedVertex<Second, Rest...> rest;
+};
+
+template<typename First, typename... Rest>
+void encode_packed_vertex(const float *source, const VertexQuantization &quantization,
+			  PackedVertex<First, Rest...> *vertex) {
+   First::Encoding::encode(source, quantization, &vertex->value);
+   if constexpr(sizeof...(Rest) > 0) {
+      encode_packed_vertex<Rest...>(source + First::Encoding::source_floats, quantization, &vertex->rest);
+   }
+}
+
+template<typename... Attributes>
+struct VertexLayout {
+   typedef PackedVertex<Attributes...> Vertex;
+
+   static constexpr int attribute_count = sizeof...(Attributes);
+   static constexpr int source_floats = (Attributes::Encoding::source_floats + ...);
+   static constexpr GLsizei stride = (GLsizei)(sizeof(typename Attributes::Encoding::Stored) + ...);
+
+   static constexpr std::array<GLuint, sizeof...(Attributes)> offsets() {
+      const size_t sizes[] = {sizeof(typename Attributes::Encoding::Stored)...};
+      std::array<GLuint, sizeof...(Attributes)> result{};
+      GLuint offset = 0;
+      for(size_t i = 0; i < sizeof...(Attributes); ++i) {
+	 result[i] = offset;
+	 offset += (GLuint)sizes[i];
+      }
+      return result;
+   }
+
+   template<size_t... Index>
+   static constexpr std::array<VertexAttributeFormat, sizeof...(Attributes)> formats(std::index_sequence<Index...>) {
+      return {{{Attributes::location, Attributes::Encoding::components, Attributes::Encoding::type,
+		Attributes::Encoding::normalized, offsets()[Index]}...}};
+   }
+
+   static constexpr std::array<VertexAttributeFormat, sizeof...(Attributes)> attributes =
+      formats(std::index_sequence_for<Attributes...>{});
+
+   static_assert(((sizeof(typename Attributes::Encoding::Stored) % 4 == 0) && ...),
+		 "vertex encodings have to be a multiple of four bytes");
+   static_assert(sizeof(Vertex) == (size_t)stride, "packed vertex picked up padding");
+
+   // source holds source_floats per vertex
+   static void encode(const float *source, size_t vertex_count, const VertexQuantization &quantization,
+		      std::vector<Vertex> *vertices) {
+      vertices->resize(vertex_count);
+      for(size_t i = 0; i < vertex_count; ++i) {
+	 encode_packed_vertex(source + i * source_floats, quantization, &(*vertices)[i]);
+      }
+   }
+
+   static void encode(const Mesh *mesh, const VertexQuantization &quantization, std::vector<Vertex> *vertices) {
+      if(mesh->vertex_floats != source_floats) {
+	 std::cerr << "ERROR: mesh has " << mesh->vertex_floats << " floats per vertex, layout expects "
+		   << source_floats << '\n';
+	 exit(1);
+      }
+      encode(mesh->vertices.data(), mesh->vertices.size() / source_floats, quantization, vertices);
+   }
+
+   // one interleaved buffer on binding 0, index_buffer may be 0
+   static GLuint create_vertex_array(GLuint vertex_buffer, GLuint index_buffer) {
+      return gl_create_vertex_array(vertex_buffer, stride, attributes.data(), attribute_count, index_buffer);
+   }
+
+   // for a second stream next to the mesh, per instance with a divisor of 1
+   static void add_to_vertex_array(GLuint vertex_array, GLuint binding, GLuint buffer, GLuint divisor) {
+      gl_vertex_array_add_buffer(vertex_array, binding, buffer, stride, attributes.data(), attribute_count, divisor);
+   }
+};
+// @!
+
+
+// @@ the layouts the shaders are written against, 8 bytes per light vertex and 16 per object vertex
+// instead of 12 and 32. the mesh cache stores ObjectVertexLayout vertices as they are
+// locations 0-2 are the mesh stream and 3-4 the instance stream, see shaders/object.vert. 5 is taken
+// by MESH_BATCH_DRAW_ID_LOCATION
+typedef VertexLayout<VertexAttribute<0, VertexPositionSnorm16>> LightVertexLayout;
+typedef VertexLayout<VertexAttribute<0, VertexPositionSnorm16>, VertexAttribute<1, VertexNormal1010102>,
+		     VertexAttribute<2, VertexHalf2>> ObjectVertexLayout;
+// per instance, 24 bytes: position and uniform scale, then the rotation quaternion (x, y, z, w)
+typedef VertexLayout<VertexAttribute<3, VertexFloat4>, VertexAttribute<4, VertexSnorm16x4>> InstanceLayout;
+
+// shaders/include/vertex_pulling.glsl decodes these three by hand at fixed word offsets
+static_assert(LightVertexLayout::stride == 8 && ObjectVertexLayout::stride == 16 && InstanceLayout::stride == 24,
+	      "vertex_pulling.glsl reads the old layout");
+// @!
@@ -0,0 +1,498 @@
+/*
+  ====--- [C++ SOURCE FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:source
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#include "virtual_texture.h"
+
+#include "gl_resources.h"
+
+#include "stb_image.h"
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+const uint32_t VIRTUAL_TEXTURE_MAGIC = 0x5854564c; // "LVTX"
+const uint32_t VIRTUAL_TEXTURE_VERSION = 1;
+const int VIRTUAL_TEXTURE_BORDER = 4;
+
+
+// @@ page helpers, pages are keyed level | y | x so one integer names a page at any level
+static int64_t page_key(int level, int x, int y) {
+   return ((int64_t)level << 40) | ((int64_t)y << 20) | (int64_t)x;
+}
+
+static void page_from_key(int64_t key, int *level, int *x, int *y) {
+   *level = (int)(key >> 40);
+   *y = (int)((key >> 20) & 0xfffff);
+   *x = (int)(key & 0xfffff);
+}
+
+static int level_pages(const VirtualTexture *vt, int level) {
+   return std::max(1, vt->pages >> level);
+}
+
+static const unsigned char *tile_data(const VirtualTexture *vt, int level, int x, int y) {
+   size_t tile_bytes = (size_t)vt->tile_texels * vt->tile_texels * 4;
+   size_t index = vt->header.level_first_page[level] + (size_t)y * level_pages(vt, level) + x;
+   return vt->tile_file.data + sizeof(VirtualTextureFileHeader) + index * tile_bytes;
+}
+// @!
+
+
+static void streamer_main(VirtualTexture *vt) {
+   size_t tile_bytes = (size_t)vt->tile_texels * vt->tile_texels * 4;
+   while(true) {
+      int64_t key;
+      {
+	 std::unique_lock<std::mutex> lock{vt->stream_mutex};
+	 vt->stream_wake.wait(lock, [vt] { return vt->stream_quit || !vt->stream_requests.empty(); });
+	 if(vt->stream_quit) {
+	    return;
+	 }
+	 key = vt->stream_requests.front();
+	 vt->stream_requests.pop_front();
+      }
+
+      // touching the mapping is what pulls the tile off disk, keep it off the GL thread
+      int level, x, y;
+      page_from_key(key, &level, &x, &y);
+      const unsigned char *source = tile_data(vt, level, x, y);
+      VirtualTextureTile tile;
+      tile.page_key = key;
+      tile.texels.assign(source, source + tile_bytes);
+
+      std::lock_guard<std::mutex> lock{vt->stream_mutex};
+      vt->stream_completed.push_back(std::move(tile));
+   }
+}
+
+
+// @@ rewrite the indirection entries under one page, every finer page in its footprint falls back
+// to the closest resident ancestor
+static void refresh_indirection(VirtualTexture *vt, int level, int page_x, int page_y) {
+   int level_count = (int)vt->header.level_count;
+
+   for(int l = level; l >= 0; --l) {
+      int pages_l = level_pages(vt, l);
+      int span = 1 << (level - l);
+      int x0 = page_x * span;
+      int y0 = page_y * span;
+      int x1 = std::min(x0 + span, pages_l);
+      int y1 = std::min(y0 + span, pages_l);
+
+      for(int y = y0; y < y1; ++y) {
+	 for(int x = x0; x < x1; ++x) {
+	    unsigned char *entry = &vt->indirection[l][((size_t)y * pages_l + x) * 4];
+	    entry[0] = entry[1] = 0;
+	    entry[2] = (unsigned char)(level_count - 1);
+	    entry[3] = 0;
+	    for(int k = l; k < level_count; ++k) {
+	       int slot = vt->resident_slot[k][(size_t)(y >> (k - l)) * level_pages(vt, k) + (x >> (k - l))];
+	       if(slot >= 0) {
+		  entry[0] = (unsigned char)(slot % vt->slots_per_side);
+		  entry[1] = (unsigned char)(slot / vt->slots_per_side);
+		  entry[2] = (unsigned char)k;
+		  entry[3] = 255;
+		  break;
+	       }
+	    }
+	 }
+      }
+
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, pages_l);
+      glTextureSubImage2D(vt->indirection_texture, l, x0, y0, x1 - x0, y1 - y0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,
+			  &vt->indirection[l][((size_t)y0 * pages_l + x0) * 4]);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+   }
+}
+// @!
+
+
+// @@ picks a free slot, else the least recently used one not seen this frame, -1 if all are busy
+static int acquire_slot(VirtualTexture *vt) {
+   int chosen = -1;
+   uint64_t oldest = UINT64_MAX;
+   for(size_t i = 0; i < vt->slots.size(); ++i) {
+      const VirtualTextureSlot &slot = vt->slots[i];
+      if(slot.page_key < 0) {
+	 return (int)i;
+      }
+      if(!slot.pinned && slot.last_used_frame < vt->frame && slot.last_used_frame < oldest) {
+	 oldest = slot.last_used_frame;
+	 chosen = (int)i;
+      }
+   }
+
+   if(chosen >= 0) {
+      int level, x, y;
+      page_from_key(vt->slots[chosen].page_key, &level, &x, &y);
+      vt->resident_slot[level][(size_t)y * level_pages(vt, level) + x] = -1;
+      vt->slots[chosen].page_key = -1;
+      refresh_indirection(vt, level, x, y);
+   }
+   return chosen;
+}
+
+static void place_tile(VirtualTexture *vt, int slot, int64_t key, const unsigned char *texels) {
+   int level, x, y;
+   page_from_key(key, &level, &x, &y);
+
+   glTextureSubImage2D(vt->physical_texture, 0, (slot % vt->slots_per_side) * vt->tile_texels,
+		       (slot / vt->slots_per_side) * vt->tile_texels, vt->tile_texels, vt->tile_texels,
+		       GL_RGBA, GL_UNSIGNED_BYTE, texels);
+
+   vt->slots[slot].page_key = key;
+   vt->slots[slot].last_used_frame = vt->frame;
+   vt->resident_slot[level][(size_t)y * level_pages(vt, level) + x] = slot;
+   refresh_indirection(vt, level, x, y);
+}
+// @!
+
+
+bool virtual_texture_open(VirtualTexture *vt, std::string path, int slots_per_side,
+			  int screen_width, int screen_height, int feedback_downscale) {
+   // @@ tile file
+   if(!file_map_open(path, &vt->tile_file)) {
+      std::cerr << "ERROR: could not open virtual texture " << path << '\n';
+      return false;
+   }
+
+   bool valid = vt->tile_file.size >= sizeof(VirtualTextureFileHeader);
+   if(valid) {
+      memcpy(&vt->header, vt->tile_file.data, sizeof(vt->header));
+      valid = vt->header.magic == VIRTUAL_TEXTURE_MAGIC && vt->header.version == VIRTUAL_TEXTURE_VERSION &&
+	 vt->header.level_count >= 1 && vt->header.level_count <= 16 && vt->header.page_texels > 0 &&
+	 (vt->header.page_texels & (vt->header.page_texels - 1)) == 0 &&
+	 (vt->header.size & (vt->header.size - 1)) == 0 && vt->header.size >= vt->header.page_texels &&
+	 vt->header.border <= vt->header.page_texels;
+   }
+   // one level per halving of the page grid, down to a single page
+   if(valid) {
+      valid = vt->header.size / vt->header.page_texels == 1u << (vt->header.level_count - 1);
+   }
+   if(valid) {
+      vt->tile_texels = vt->header.page_texels + 2 * vt->header.border;
+      vt->pages = vt->header.size / vt->header.page_texels;
+   }
+   // every level's tiles have to end before the next level starts and inside the file
+   for(int level = 0; valid && level < (int)vt->header.level_count; ++level) {
+      uint64_t tile_bytes = (uint64_t)vt->tile_texels * vt->tile_texels * 4;
+      uint64_t pages_l = level_pages(vt, level);
+      uint64_t level_end = (uint64_t)vt->header.level_first_page[level] + pages_l * pages_l;
+      bool last = level + 1 == (int)vt->header.level_count;
+      valid = (last || level_end <= vt->header.level_first_page[level + 1]) &&
+	 level_end <= (vt->tile_file.size - sizeof(vt->header)) / tile_bytes;
+   }
+   if(!valid) {
+      std::cerr << "ERROR: bad virtual texture file " << path << '\n';
+      file_map_close(&vt->tile_file);
+      return false;
+   }
+   // @!
+
+   int level_count = vt->header.level_count;
+   vt->slots_per_side = slots_per_side;
+   vt->slots.assign(slots_per_side * slots_per_side, VirtualTextureSlot{-1, 0, false});
+   vt->resident_slot.resize(level_count);
+   vt->indirection.resize(level_count);
+   for(int level = 0; level < level_count; ++level) {
+      int pages_l = level_pages(vt, level);
+      vt->resident_slot[level].assign((size_t)pages_l * pages_l, -1);
+      vt->indirection[level].assign((size_t)pages_l * pages_l * 4, 0);
+   }
+   vt->frame = 1;
+   vt->max_requests_per_frame = 32;
+   vt->max_uploads_per_frame = 8;
+
+   // @@ physical cache and indirection textures, fixed size for the whole run so storage is immutable
+   int physical_size = slots_per_side * vt->tile_texels;
+   vt->physical_texture = gl_create_texture(GL_TEXTURE_2D, GL_SRGB8_ALPHA8, physical_size, physical_size, 1, 1);
+   gl_texture_sampling(vt->physical_texture, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR);
+
+   vt->indirection_texture = gl_create_texture(GL_TEXTURE_2D, GL_RGBA8UI, vt->pages, vt->pages, 1, level_count);
+   gl_texture_sampling(vt->indirection_texture, GL_CLAMP_TO_EDGE, GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST);
+   for(int level = 0; level < level_count; ++level) {
+      int pages_l = level_pages(vt, level);
+      glTextureSubImage2D(vt->indirection_texture, level, 0, 0, pages_l, pages_l, GL_RGBA_INTEGER,
+			  GL_UNSIGNED_BYTE, vt->indirection[level].data());
+   }
+
+   // the single coarsest page stays resident forever so every lookup has something to fall back on
+   place_tile(vt, 0, page_key(level_count - 1, 0, 0), tile_data(vt, level_count - 1, 0, 0));
+   vt->slots[0].pinned = true;
+   // @!
+
+   // @@ feedback target, integer texels of (page x, page y, level, requested)
+   vt->feedback_downscale = feedback_downscale;
+   vt->feedback_width = std::max(1, screen_width / feedback_downscale);
+   vt->feedback_height = std::max(1, screen_height / feedback_downscale);
+
+   vt->feedback_texture = gl_create_texture(GL_TEXTURE_2D, GL_RGBA16UI, vt->feedback_width, vt->feedback_height,
+					    1, 1);
+   gl_texture_sampling(vt->feedback_texture, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+
+   glCreateRenderbuffers(1, &vt->feedback_depth);
+   glNamedRenderbufferStorage(vt->feedback_depth, GL_DEPTH_COMPONENT24, vt->feedback_width, vt->feedback_height);
+
+   glCreateFramebuffers(1, &vt->feedback_framebuffer);
+   glNamedFramebufferTexture(vt->feedback_framebuffer, GL_COLOR_ATTACHMENT0, vt->feedback_texture, 0);
+   glNamedFramebufferRenderbuffer(vt->feedback_framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+				  vt->feedback_depth);
+   glNamedFramebufferReadBuffer(vt->feedback_framebuffer, GL_COLOR_ATTACHMENT0);
+   if(glCheckNamedFramebufferStatus(vt->feedback_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      printf("@DEV_WARNING: virtual texture feedback framebuffer incomplete.\n");
+   }
+
+   vt->feedback_pbo = gl_create_buffer((GLsizeiptr)vt->feedback_width * vt->feedback_height * 8, NULL,
+				       GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+   vt->feedback_fence = 0;
+   // @!
+
+   vt->stream_quit = false;
+   vt->streamer = std::thread(streamer_main, vt);
+   return true;
+}
+
+
+void virtual_texture_begin_feedback(VirtualTexture *vt, GLStateCache *state) {
+   gl_state_bind_framebuffer(state, vt->feedback_framebuffer);
+   gl_state_viewport(state, 0, 0, vt->feedback_width, vt->feedback_height);
+   const GLuint no_request[4] = {0, 0, 0, 0};
+   glClearBufferuiv(GL_COLOR, 0, no_request);
+   glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+
+void virtual_texture_end_feedback(VirtualTexture *vt, GLStateCache *state, int screen_width, int screen_height) {
+   // only one readback in flight, frames in between simply skip feedback
+   if(!vt->feedback_fence) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, vt->feedback_pbo);
+      glReadPixels(0, 0, vt->feedback_width, vt->feedback_height, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, 0);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      vt->feedback_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   }
+
+   gl_state_bind_framebuffer(state, 0);
+   gl_state_viewport(state, 0, 0, screen_width, screen_height);
+}
+
+
+void virtual_texture_update(VirtualTexture *vt) {
+   // @@ consume feedback once the GPU has written it, misses go out coarsest first
+   if(vt->feedback_fence) {
+      GLenum wait_result = glClientWaitSync(vt->feedback_fence, 0, 0);
+      if(wait_result == GL_ALREADY_SIGNALED || wait_result == GL_CONDITION_SATISFIED) {
+	 glDeleteSync(vt->feedback_fence);
+	 vt->feedback_fence = 0;
+
+	 std::unordered_set<int64_t> seen;
+	 const GLushort *texels = (const GLushort *)glMapNamedBufferRange(
+	    vt->feedback_pbo, 0, (GLsizeiptr)vt->feedback_width * vt->feedback_height * 8, GL_MAP_READ_BIT);
+	 if(texels) {
+	    for(int i = 0; i < vt->feedback_width * vt->feedback_height; ++i) {
+	       const GLushort *texel = texels + i * 4;
+	       if(texel[3] == 0 || texel[2] >= vt->header.level_count) {
+		  continue;
+	       }
+	       int pages_l = level_pages(vt, texel[2]);
+	       if(texel[0] < pages_l && texel[1] < pages_l) {
+		  seen.insert(page_key(texel[2], texel[0], texel[1]));
+	       }
+	    }
+	    glUnmapNamedBuffer(vt->feedback_pbo);
+	 }
+
+	 std::vector<int64_t> misses;
+	 for(int64_t key : seen) {
+	    int level, x, y;
+	    page_from_key(key, &level, &x, &y);
+	    int slot = vt->resident_slot[level][(size_t)y * level_pages(vt, level) + x];
+	    if(slot >= 0) {
+	       vt->slots[slot].last_used_frame = vt->frame;
+	    } else if(!vt->pending_pages.count(key)) {
+	       misses.push_back(key);
+	    }
+	 }
+	 std::sort(misses.begin(), misses.end(), [](int64_t a, int64_t b) { return a > b; });
+	 if((int)misses.size() > vt->max_requests_per_frame) {
+	    misses.resize(vt->max_requests_per_frame);
+	 }
+
+	 if(!misses.empty()) {
+	    std::lock_guard<std::mutex> lock{vt->stream_mutex};
+	    for(int64_t key : misses) {
+	       vt->stream_requests.push_back(key);
+	       vt->pending_pages.insert(key);
+	    }
+	 }
+	 vt->stream_wake.notify_one();
+      }
+   }
+   // @!
+
+   // @@ land streamed tiles within the per frame budget
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   for(int upload = 0; upload < vt->max_uploads_per_frame; ++upload) {
+      VirtualTextureTile tile;
+      {
+	 std::lock_guard<std::mutex> lock{vt->stream_mutex};
+	 if(vt->stream_completed.empty()) {
+	    break;
+	 }
+	 tile = std::move(vt->stream_completed.front());
+	 vt->stream_completed.pop_front();
+      }
+      vt->pending_pages.erase(tile.page_key);
+
+      int slot = acquire_slot(vt);
+      if(slot < 0) {
+	 break;
+      }
+      place_tile(vt, slot, tile.page_key, tile.texels.data());
+   }
+   // @!
+
+   vt->frame += 1;
+}
+
+
+void virtual_texture_set_uniforms(VirtualTexture *vt, ShaderProgram *program, int indirection_unit,
+				  int physical_unit) {
+   set_uniform(shader_uniform_sampler(program, "vt_indirection"), indirection_unit);
+   set_uniform(shader_uniform_sampler(program, "vt_physical"), physical_unit);
+   set_uniform(shader_uniform_float(program, "vt_pages"), (float)vt->pages);
+   set_uniform(shader_uniform_float(program, "vt_page_texels"), (float)vt->header.page_texels);
+   set_uniform(shader_uniform_float(program, "vt_border"), (float)vt->header.border);
+   set_uniform(shader_uniform_float(program, "vt_physical_size"), (float)(vt->slots_per_side * vt->tile_texels));
+   set_uniform(shader_uniform_float(program, "vt_max_level"), (float)(vt->header.level_count - 1));
+   set_uniform(shader_uniform_float(program, "vt_feedback_bias"), log2f((float)vt->feedback_downscale));
+}
+
+
+void virtual_texture_bind(VirtualTexture *vt, GLStateCache *state, int indirection_unit, int physical_unit) {
+   gl_state_bind_texture(state, indirection_unit, GL_TEXTURE_2D, vt->indirection_texture);
+   gl_state_bind_texture(state, physical_unit, GL_TEXTURE_2D, vt->physical_texture);
+}
+
+
+void virtual_texture_close(VirtualTexture *vt) {
+   {
+      std::lock_guard<std::mutex> lock{vt->stream_mutex};
+      vt->stream_quit = true;
+   }
+   vt->stream_wake.notify_all();
+   vt->streamer.join();
+
+   if(vt->feedback_fence) {
+      glDeleteSync(vt->feedback_fence);
+   }
+   glDeleteBuffers(1, &vt->feedback_pbo);
+   glDeleteFramebuffers(1, &vt->feedback_framebuffer);
+   glDeleteRenderbuffers(1, &vt->feedback_depth);
+   glDeleteTextures(1, &vt->feedback_texture);
+   glDeleteTextures(1, &vt->indirection_texture);
+   glDeleteTextures(1, &vt->physical_texture);
+   file_map_close(&vt->tile_file);
+}
+
+
+// @@ offline tiler
+int vt_build_command(int argc, char **argv) {
+   if(argc < 4) {
+      std::cerr << "usage: " << argv[0] << " --build-vt <source> <out.vtex> [page_texels]\n";
+      return 1;
+   }
+   int page_texels = argc > 4 ? atoi(argv[4]) : 128;
+
+   int size = 0;
+   int height = 0;
+   int channels = 0;
+   stbi_set_flip_vertically_on_load_thread(true);
+   unsigned char *pixels = stbi_load(argv[2], &size, &height, &channels, 4);
+   if(!pixels) {
+      std::cerr << "ERROR: could not load " << argv[2] << '\n';
+      return 1;
+   }
+   bool power_of_two = size > 0 && (size & (size - 1)) == 0;
+   bool page_power_of_two = page_texels > 0 && (page_texels & (page_texels - 1)) == 0;
+   if(size != height || !power_of_two || !page_power_of_two || size < page_texels) {
+      std::cerr << "ERROR: virtual textures must be square powers of two of at least one page\n";
+      stbi_image_free(pixels);
+      return 1;
+   }
+
+   TextureMipChain chain;
+   build_mip_chain(pixels, size, size, 4, true, &chain);
+   stbi_image_free(pixels);
+
+   VirtualTextureFileHeader header;
+   memset(&header, 0, sizeof(header));
+   header.magic = VIRTUAL_TEXTURE_MAGIC;
+   header.version = VIRTUAL_TEXTURE_VERSION;
+   header.size = size;
+   header.page_texels = page_texels;
+   header.border = VIRTUAL_TEXTURE_BORDER;
+
+   int pages = size / page_texels;
+   int tile_count = 0;
+   while(true) {
+      int pages_l = std::max(1, pages >> header.level_count);
+      header.level_first_page[header.level_count] = tile_count;
+      tile_count += pages_l * pages_l;
+      header.level_count += 1;
+      if(pages_l == 1) {
+	 break;
+      }
+   }
+
+   int tile_texels = page_texels + 2 * VIRTUAL_TEXTURE_BORDER;
+   size_t tile_bytes = (size_t)tile_texels * tile_texels * 4;
+   std::vector<unsigned char> file_bytes(sizeof(header) + tile_count * tile_bytes);
+   memcpy(file_bytes.data(), &header, sizeof(header));
+
+   for(uint32_t level = 0; level < header.level_count; ++level) {
+      int pages_l = std::max(1, pages >> level);
+      const TextureMipLevel &mip = chain.levels[level];
+      const unsigned char *texels = chain.data + mip.offset;
+
+      for(int page_y = 0; page_y < pages_l; ++page_y) {
+	 for(int page_x = 0; page_x < pages_l; ++page_x) {
+	    unsigned char *tile = file_bytes.data() + sizeof(header) +
+	       (header.level_first_page[level] + (size_t)page_y * pages_l + page_x) * tile_bytes;
+	    for(int y = 0; y < tile_texels; ++y) {
+	       int source_y = std::min(std::max(page_y * page_texels + y - VIRTUAL_TEXTURE_BORDER, 0), mip.height - 1);
+	       for(int x = 0; x < tile_texels; ++x) {
+		  int source_x = std::min(std::max(page_x * page_texels + x - VIRTUAL_TEXTURE_BORDER, 0), mip.width - 1);
+		  memcpy(tile + ((size_t)y * tile_texels + x) * 4,
+			 texels + ((size_t)source_y * mip.width + source_x) * 4, 4);
+	       }
+	    }
+	 }
+      }
+   }
+   texture_mip_chain_free(&chain);
+
+   if(!file_write_atomic(argv[3], file_bytes.data(), file_bytes.size())) {
+      std::cerr << "ERROR: could not write " << argv[3] << '\n';
+      return 1;
+   }
+   printf("built %s: %dx%d, %d levels, %d tiles of %d texels (+%d border)\n", argv[3], size, size,
+	  header.level_count, tile_count, page_texels, VIRTUAL_TEXTURE_BORDER);
+   return 0;
+}
+// @!
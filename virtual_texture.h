@@ -0,0 +1,123 @@
+/*
+  ====--- [C++ HEADER FILE] HEADER ---====
+  ----------------------------------------
+
+  @MARK:header
+
+  Creator: James Spratt.
+  Notice: (C) Copyright 2021, James Spratt, All rights reserved.
+
+  ----------------------------------------
+*/
+
+
+#pragma once
+
+#include <GLAD/glad/glad.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "file_map.h"
+#include "gl_state.h"
+#include "shader.h"
+
+
+// @@ on disk tile file (.vtex), built offline by vt_build_command
+// a square power of two image cut into page_texels sized pages per mip level, every tile stored
+// with border texels of its neighbours so bilinear filtering never reads across slots
+struct VirtualTextureFileHeader {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t size;
+   uint32_t page_texels;
+   uint32_t border;
+   uint32_t level_count;
+   uint32_t level_first_page[16];
+};
+// @!
+
+
+// one physical slot in the cache texture, page_key is -1 while free
+struct VirtualTextureSlot {
+   int64_t page_key;
+   uint64_t last_used_frame;
+   bool pinned;
+};
+
+struct VirtualTextureTile {
+   int64_t page_key;
+   std::vector<unsigned char> texels;
+};
+
+struct VirtualTexture {
+   FileMapping tile_file;
+   VirtualTextureFileHeader header;
+   int tile_texels;
+   int pages;
+
+   // @@ GPU side, physical is slots_per_side^2 tiles, indirection has one texel per page per level
+   GLuint physical_texture;
+   GLuint indirection_texture;
+   int slots_per_side;
+   std::vector<VirtualTextureSlot> slots;
+   // @!
+
+   // @@ CPU mirror of residency and of the indirection texture, one array per level
+   std::vector<std::vector<int>> resident_slot;
+   std::vector<std::vector<unsigned char>> indirection;
+   std::unordered_set<int64_t> pending_pages;
+   // @!
+
+   // @@ feedback pass, rendered small and read back a few frames late through a PBO
+   GLuint feedback_framebuffer;
+   GLuint feedback_texture;
+   GLuint feedback_depth;
+   GLuint feedback_pbo;
+   GLsync feedback_fence;
+   int feedback_width;
+   int feedback_height;
+   int feedback_downscale;
+   // @!
+
+   // @@ streaming thread, the only thread that touches tile file pages on a miss
+   std::thread streamer;
+   std::mutex stream_mutex;
+   std::condition_variable stream_wake;
+   std::deque<int64_t> stream_requests;
+   std::deque<VirtualTextureTile> stream_completed;
+   bool stream_quit;
+   // @!
+
+   uint64_t frame;
+   int max_requests_per_frame;
+   int max_uploads_per_frame;
+};
+
+
+// slots_per_side bounds VRAM use: slots_per_side^2 tiles of (page_texels + 2 * border)^2 texels
+bool virtual_texture_open(VirtualTexture *vt, std::string path, int slots_per_side,
+			  int screen_width, int screen_height, int feedback_downscale);
+
+// render the scene with the feedback program between these two, then draw normally
+void virtual_texture_begin_feedback(VirtualTexture *vt, GLStateCache *state);
+void virtual_texture_end_feedback(VirtualTexture *vt, GLStateCache *state, int screen_width, int screen_height);
+
+// once per frame: reads back old feedback, queues misses, uploads streamed tiles, updates indirection
+void virtual_texture_update(VirtualTexture *vt);
+
+// program must be current, sets the vt_* uniforms and sampler units
+void virtual_texture_set_uniforms(VirtualTexture *vt, ShaderProgram *program, int indirection_unit,
+				  int physical_unit);
+void virtual_texture_bind(VirtualTexture *vt, GLStateCache *state, int indirection_unit, int physical_unit);
+
+void virtual_texture_close(VirtualTexture *vt);
+
+// headless entry point, main --build-vt <source> <out.vtex> [page_texels]
+int vt_build_command(int argc, char **argv);